@@ -4,11 +4,31 @@
 #include <string.h>
 #include <assert.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <locale.h>
+#include <dirent.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 #ifdef LINUX
 #include <ncurses.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
 #include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
 #define BACKSPACE 127
 #define CTRL(c) ((c) & 037)
 #endif
@@ -19,7 +39,11 @@
 
 #include <ncurses.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
 #include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
 #endif
 
 
@@ -29,22 +53,177 @@
 #include <ncurses/ncurses.h>
 #define BACKSPACE 8
 #define CTRL(x) ((x) & 0x1f)
+#define fseeko _fseeki64
 #endif
 
+#include "vite.h"
+
 #define ENTER 10
+#define TAB 9
 
 
 #define ESC 27
 #define true 1
 #define false 0
 
+// 파일 압축 형식
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_ZSTD 2
+
+// 문법 강조 종류
+#define SYNTAX_NONE 0
+#define SYNTAX_C 1
+#define SYNTAX_JSON 2
+#define SYNTAX_LOG 3
+
+// 렉서 상태 (줄의 시작에서의 상태를 캐싱함)
+#define LEX_NORMAL 0
+#define LEX_BLOCK_COMMENT 1
+
+// 이보다 긴 줄은 강조하지 않음
+#define LEX_MAX_LINE_LENGTH 10000
+
+// 색상 (COLOR_PAIR 번호)
+#define COLOR_HIGHLIGHT 1
+#define COLOR_KEYWORD 2
+#define COLOR_STRING 3
+#define COLOR_COMMENT 4
+#define COLOR_NUMBER 5
+#define COLOR_PREPROCESSOR 6
+#define COLOR_LOG_ERROR 7
+#define COLOR_LOG_WARNING 8
+#define COLOR_LOG_INFO 9
+#define COLOR_LOG_DEBUG 10
+
+// 정규식 AST 노드 종류
+#define REGEX_SET 0
+#define REGEX_CONCAT 1
+#define REGEX_ALTERNATE 2
+#define REGEX_STAR 3
+#define REGEX_PLUS 4
+#define REGEX_QUESTION 5
+#define REGEX_EMPTY 6
+
+// 정규식 NFA 상태 종류
+#define NFA_SET 0
+#define NFA_SPLIT 1
+#define NFA_EPSILON 2
+#define NFA_MATCH 3
+
+// 지연 생성 DFA의 최대 상태 수 (넘으면 캐시를 비움)
+#define DFA_MAX_STATES 1024
+#define DFA_UNKNOWN -1
+#define DFA_DEAD -2
+
+// 정규식 검색에서 줄의 한 위치마다 기억하는 forward DFA 상태 수 (같은 위치에 같은 상태로 오면 다시 읽지 않음)
+#define REGEX_SCAN_WAYS 4
+
+// 검색할 때 문서를 복사해두는 청크의 크기
+#define SEARCH_CHUNK_SIZE 65536
+// 쓰레드마다 동시에 들고 있을 수 있는 청크 수
+#define SEARCH_CHUNKS_PER_THREAD 4
+
+// 한 번에 적용하는 편집에서 줄이 이보다 많이 나뉘거나 합쳐지면 줄 캐시를 다시 만듦
+#define LINE_EDITS_BEFORE_REBUILD 64
+
+// 줄 연산 종류
+#define LINE_SORT 0
+#define LINE_UNIQUE 1
+#define LINE_KEEP 2
+#define LINE_DROP 3
+// 줄 연산에서 작업 하나가 맡는 줄 수 (해시, 필터)
+#define LINE_JOB_SIZE 65536
+
+// 저장할 때 길이가 바뀐 줄부터 파일 끝까지 다시 써야 하는 양이 이보다 크면 파일 전체를 새로 씀
+#define SAVE_TAIL_LIMIT (64LL * 1024 * 1024)
+#define DIRTY_RANGE_MAX 1024
+
+// 디스크의 파일과 비교한 줄의 상태, 화면 오른쪽 끝 칸에 표시함
+#define DIFF_SAME 0
+#define DIFF_CHANGED 1
+#define DIFF_ADDED 2
+#define DIFF_STALE 3      // 고친 줄, 해시를 다시 구해서 짝지어진 디스크의 줄과 비교해야 함
+#define DIFF_STATE_MASK 3
+#define DIFF_DELETED 4    // 이 줄 아래에서 디스크의 줄이 지워짐
+#define DIFF_MAX_COST 1024 // 마이어스 diff에서 구간의 편집 거리가 이보다 크면 구간 전체를 바뀐 것으로 봄
+#define DIFF_HASH_START 14695981039346656037ULL // FNV-1a 64비트
+#define DIFF_HASH_PRIME 1099511628211ULL
+
+// 헥스 보기, 파일 앞부분에 NUL 바이트가 있으면 바이너리 파일로 보고 헥스 보기로 엶
+#define HEX_ROW_BYTES 16
+#define HEX_DETECT_SIZE 8192
+
+// 괄호 짝 찾기에서 깊이를 요약하는 줄 묶음의 크기 (바이트, 줄 경계에서 나눔)
+#define BRACKET_BLOCK_SIZE 65536
+
+// 트라이그램 색인: 이보다 큰 파일만 색인하고, 이 정도 크기의 줄 묶음(블록)마다 비트맵을 만듦
+#define TRIGRAM_MIN_FILE_SIZE (16 * 1024 * 1024)
+#define TRIGRAM_BLOCK_SIZE 262144
+#define TRIGRAM_HASH_BITS 16
+#define TRIGRAM_BITS (1 << TRIGRAM_HASH_BITS)
+#define TRIGRAM_MAGIC "VITETRI2"
+
+// 세션 사이드카, 이보다 큰 파일은 닫을 때 줄 색인과 화면 위치를 저장해두고 다시 열 때 되살림
+#define SESSION_MIN_FILE_SIZE (1024 * 1024)
+#define SESSION_MAGIC "VITESES1"
+#define SESSION_SAMPLE_SIZE 4096 // 크기와 수정 시간이 같아도 내용이 바뀐 경우를 거르기 위해 해시하는 양 (앞, 가운데, 끝)
+#define SEARCH_HISTORY_SIZE 16
+
+// 자동 저장, 입력이 이만큼 멈추거나 편집이 이만큼 쌓이면 문서를 사이드카에 씀 (vite -a 초[,편집 수] 파일이름, 0초면 끔)
+#define AUTOSAVE_IDLE_MS 2000
+#define AUTOSAVE_EDIT_LIMIT 300
+#define AUTOSAVE_SLICE_SIZE 65536        // 키 입력 사이에 한 번에 복사하는 양 (1ms보다 짧게)
+#define AUTOSAVE_BACKOFF 20              // 지난 자동 저장에 걸린 시간의 이 배만큼 다음 자동 저장을 미룸 (큰 파일, 느린 디스크)
+#define AUTOSAVE_MAX_DELAY_MS 60000
+#define AUTOSAVE_POLL_MS 100             // 쓰는 중일 때 끝났는지 확인하는 간격
+
+// 이동 키가 밀려있으면 화면은 이 간격(60Hz)에 한 번만 그림
+#define RENDER_FRAME_MS 16
+
+// 보이지 않는 버퍼 중 최근에 쓴 이만큼은 화면 캐시를 남겨둠 (메모리가 모자라면 모두 버림)
+#define BUFFER_CACHED_MAX 2
+// 남은 메모리가 전체의 1/n보다 적으면 메모리가 모자란 것으로 봄
+#define BUFFER_LOW_MEMORY_RATIO 8
+
+// 디렉터리 검색, 큰 파일은 이 크기의 조각으로 나눠서 쓰레드 풀에서 동시에 찾음
+#define PROJECT_CHUNK_SIZE (8 * 1024 * 1024)
+#define PROJECT_MAX_HITS 100000
+#define PROJECT_MAX_DEPTH 32 // 심볼릭 링크가 돌아도 여기서 멈춤
+#define PROJECT_PREVIEW_LENGTH 160
+#define PROJECT_PREVIEW_CONTEXT 40 // 긴 줄에서는 찾은 곳의 이만큼 앞부터 보여줌
+#define PROJECT_POLL_MS 50 // 찾는 동안 결과 목록을 다시 그리는 간격
+
+// 파일을 읽을 때 사용하는 청크의 크기와 개수
+#define READ_CHUNK_SIZE 65536
+#define READ_CHUNK_COUNT 4
+
+// 노드를 한 번에 할당하는 개수
+#define NODE_SLAB_SIZE 8192
+
+// UTF-8 글자 하나의 최대 바이트 수
+#define UTF8_MAX_LENGTH 4
+
+// 탭 간격 (vite -t 4 파일이름 으로 바꿀 수 있음)
+#define DEFAULT_TAB_SIZE 8
+#define MAX_TAB_SIZE 16
+
 typedef struct Node
-{
+{ // 글자 한 바이트마다 하나씩이라 포인터 둘을 합치면 바이트당 24바이트를 씀 (readme의 남은 것 참고)
     struct Node *prev;
     struct Node *next;
-    int data;
+    unsigned char data; // 파일의 바이트를 그대로 가짐 (UTF-8은 여러 노드에 나뉨)
 } Node;
 
+typedef struct NodePool
+{ // 노드를 하나씩 malloc하지 않고 슬랩 단위로 잘라 씀, 지운 노드는 freeList로 다시 씀
+    Node **slabs;
+    int slabCount;
+    int slabCapacity;
+    int slabUsed;   // 마지막 슬랩에서 잘라 쓴 노드 수
+    Node *freeList; // next로 연결됨
+} NodePool;
+
 typedef struct Position
 {
     int x;
@@ -57,6 +236,7 @@ typedef struct PNode
     struct PNode *prev;
     struct PNode *next;
     Position *position;
+    int length; // 정규식은 찾은 결과마다 길이가 다름
 } PNode;
 
 typedef struct WindowSize
@@ -72,39 +252,686 @@ typedef struct DocumentInfo
     Node *frameLastNode;
     int frameX;
     int frameY;
+    bool isWrapMode;
+    int frameRow;   // 자동 줄 바꿈 모드에서 첫 줄 중 화면에 가려진 줄 수
+    int cursorLine; // 자동 줄 바꿈 모드에서의 커서의 줄과 칸 (칸은 바이트 단위)
+    int cursorColumn;
+    int cursorDisplayColumn; // 자동 줄 바꿈 모드에서 커서가 화면상 줄의 몇번째 칸에 있는지
 } DocumentInfo;
 
+typedef struct DirtyRange
+{ // 저장한 뒤로 고친 줄들 [first, last]
+    int first;
+    int last;
+} DirtyRange;
+
 typedef struct fileInfo
 {
     char *filename;
     char *filetype;
+    char innerFiletype[16]; // 압축 확장자 앞의 확장자 (a.log.gz의 log), filetype이 가리킴
     bool isFileReading;
     bool isFileSaving;
     bool isUpdated;
     bool isNewFile;
+    bool isReadOnly;         // 끝까지 읽지 못한 파일, 원래 파일을 덮어쓰지 않고 다른 이름으로 저장해야만 씀
+    int compression; // 저장할 때도 같은 형식으로 다시 압축함
+    long long diskSize;      // 읽거나 저장했을 때의 파일 크기와 수정 시간, 다르면 다른 곳에서 고친 것으로 봄
+    long long diskTime;
+    int resizedLine;         // 저장한 뒤로 길이가 바뀐 가장 앞 줄 (없으면 INT_MAX), 여기부터 파일 끝까지 다시 씀
+    DirtyRange *dirtyRanges; // resizedLine 앞에서 내용만 고친 줄들, 줄 번호 순서
+    int dirtyCount;
 } FileInfo;
 
-Node *head;
-Node *tail;
-Position *position;
-WindowSize *windowSize;
-DocumentInfo *documentInfo;
-FileInfo *fileInfo;
+typedef struct ReadChunk
+{
+    char data[READ_CHUNK_SIZE];
+    int length;
+} ReadChunk;
+
+typedef struct FileReader
+{ // 압축 해제 쓰레드와 문서에 넣는 메인 쓰레드가 청크를 주고받기 위한 구조체
+    FILE *file;
+    gzFile gzFile;
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstdStream;
+    ZSTD_inBuffer zstdInput;
+    char zstdInputData[READ_CHUNK_SIZE];
+    size_t zstdRemaining; // 0이 아니면 프레임이 덜 끝난 것
+#endif
+    int compression;
+    pthread_t thread;
+    bool isThreadStarted;
+    ReadChunk chunks[READ_CHUNK_COUNT];
+    int readIndex;
+    int writeIndex;
+    int filledCount;
+    bool isDone;
+    bool isFailed;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} FileReader;
+
+typedef struct RegexNode
+{
+    int type;
+    unsigned char set[32]; // REGEX_SET이 받아들이는 바이트의 비트맵
+    struct RegexNode *left;
+    struct RegexNode *right;
+} RegexNode;
+
+typedef struct NfaState
+{
+    int type;
+    int set; // Regex의 sets에서의 인덱스
+    int out;
+    int out1;
+} NfaState;
+
+typedef struct DfaState
+{
+    int *nfaStates; // 정렬된 NFA 상태 집합
+    int count;
+    bool isMatch;
+    int next[256];
+} DfaState;
+
+typedef struct Dfa
+{ // NFA 상태 집합을 필요할 때만 DFA 상태로 만듦
+    NfaState *nfa;
+    unsigned char (*sets)[32];
+    int nfaStart;
+    bool isUnanchored; // 매 위치에서 새로 매칭을 시작함
+    DfaState *states;
+    int stateCount;
+    int start;
+    int *table; // 상태 집합 -> DFA 상태 해시 테이블
+    int *stack;
+    int *scratch;
+    int *marks;
+    int mark;
+    int flushCount;
+} Dfa;
+
+typedef struct Regex
+{
+    NfaState *nfa;
+    int nfaCount;
+    int nfaCapacity;
+    unsigned char (*sets)[32];
+    int setCount;
+    int forwardStart;
+    int reverseStart;
+    bool isStartAnchored; // ^
+    bool isEndAnchored;   // $
+    char prefix[100];     // 매칭은 항상 이 문자열로 시작함 (사전 필터)
+    int prefixLength;
+    bool isCaseInsensitive; // prefix는 소문자로 바뀌어 있음
+    Dfa forward;          // 시작 위치에서 가장 긴 매칭의 끝을 찾음
+    Dfa reverse;          // 줄 끝에서 거꾸로 가며 매칭이 시작할 수 있는 위치를 찾음
+    int *scanStates;      // 이 줄에서 앞선 시작 위치의 forward가 각 위치에 왔을 때의 상태, 위치마다 REGEX_SCAN_WAYS개 (-1은 없음)
+    int *scanEnds;        // 그 상태로 그 위치부터 이어 갔을 때 가장 긴 매칭의 끝 (없으면 -1)
+    int *scanPath;        // 지금 스캔이 위치마다 기록한 칸
+    int scanCapacity;
+    int scanFlushCount;   // forward의 캐시를 비우면 상태 번호가 바뀌므로 기록을 버림
+} Regex;
+
+typedef struct TextChunk
+{ // 검색을 위해 문서를 줄 단위로 연속된 메모리에 복사한 것
+    char *text;
+    int length;
+    int capacity;
+    int firstLine;
+    Node **nodes; // text의 각 글자에 해당하는 노드, 결과를 찾을 때 리스트를 다시 따라가지 않게 함
+} TextChunk;
+
+typedef struct SearchInfo
+{
+    bool isRegex;
+    bool isCaseInsensitive;
+    bool isWholeWord;
+    char *recentWords[SEARCH_HISTORY_SIZE]; // 최근 검색어, 0이 가장 최근 (찾기에서 위/아래 화살표로 불러옴)
+    int recentCount;
+} SearchInfo;
+
+typedef struct SearchJob
+{ // 청크 하나를 검색하는 작업, 결과는 청크마다 따로 모았다가 문서 순서대로 합침
+    TextChunk chunk;
+    PNode *results;
+    bool isDone;
+    char *word;      // 대소문자 무시 모드에서는 소문자로 바뀐 단어
+    Regex **regexes; // DFA 캐시는 쓰레드마다 따로 있어야 함
+    bool isCaseInsensitive;
+    bool isWholeWord;
+} SearchJob;
+
+typedef struct TrigramBlock
+{ // 연속된 줄들의 묶음, 블록에 나오는 트라이그램을 해시해서 비트맵으로 가짐
+    Node *start;         // 블록의 첫 줄 바로 앞의 노드 (ENTER 또는 head)
+    int lineCount;
+    int length;          // 파일을 읽을 때 블록을 나누기 위한 글자 수
+    unsigned char *bits;
+    bool isIndexed;      // 비트맵이 다 만들어짐 (쓰레드 풀에서 만듦)
+    bool isDirty;        // 편집된 뒤로 비트맵이 정확하지 않음, 검색할 때 다시 만듦
+    char *text;          // 파일을 읽는 동안 해시할 텍스트를 모아둠
+    int textLength;
+    int textCapacity;
+} TrigramBlock;
+
+typedef struct TrigramInfo
+{
+    bool isEnabled;
+    bool isFromSidecar;
+    bool isBuilt;         // 사이드카 파일 저장까지 끝남, 그 전에는 비트맵을 바꾸지 않고 바꿀 것은 retired에 모아둠
+    TrigramBlock **blocks;
+    int blockCount;
+    int capacity;
+    int loadingLines;     // 사이드카대로 블록을 나눌 때 현재 블록에 들어간 줄 수
+    int loadingBlock;
+    void **retired;
+    int retiredCount;
+    int retiredCapacity;
+    char *sidecarPath;
+} TrigramInfo;
+
+typedef struct TrigramSidecar
+{ // 사이드카 파일을 쓰는 작업에 넘겨주는 블록들의 복사본
+    char *path;
+    long long fileSize;
+    long long fileTime;
+    int blockCount;
+    int *lineCounts;
+    unsigned char **bits;
+    TrigramBlock **blocks;
+    bool *isBuilt; // 작업이 끝나면 표시할 문서의 trigramInfo->isBuilt (작업 쓰레드는 문서를 고르지 않음)
+} TrigramSidecar;
+
+typedef struct DiffInfo
+{ // 디스크의 파일과 줄 해시로 비교한 결과, 편집할 때는 고친 줄만 짝지어진 디스크의 줄과 다시 비교함
+    bool isEnabled;
+    unsigned long long *diskHashes; // 디스크 파일의 줄 해시
+    int diskCount;
+    int diskCapacity;
+    int *diskLines;            // 버퍼의 각 줄과 짝지어진 디스크의 줄, 추가된 줄이면 -1 (순서대로 증가함)
+    unsigned char *lineStates; // DIFF_SAME, DIFF_CHANGED, DIFF_ADDED, DIFF_STALE과 DIFF_DELETED 비트
+    int lineCount;
+    int capacity;
+} DiffInfo;
+
+typedef struct DiffRun
+{ // 선형 공간 마이어스 diff를 돌리는 동안의 상태 (a는 디스크, b는 버퍼)
+    unsigned long long *a;
+    unsigned long long *b;
+    int *matches;  // 버퍼의 줄과 같은 디스크의 줄, 없으면 -1
+    int *forward;  // 대각선마다 앞에서부터 가장 멀리 간 x
+    int *backward; // 대각선마다 뒤에서부터 가장 멀리 간 y
+} DiffRun;
+
+typedef struct DiffHunk
+{ // 버퍼의 [line, line + lineCount)가 디스크의 [diskLine, diskLine + diskCount)를 대신함
+    int line;
+    int lineCount;
+    int diskLine;
+    int diskCount;
+} DiffHunk;
+
+typedef struct HexInfo
+{ // 바이너리 파일을 mmap해서 화면에 보이는 페이지만 읽고 바이트 단위로 덮어씀, 문서(연결 리스트)는 만들지 않음
+    bool isEnabled;
+    bool isForced;           // vite -x 파일이름
+    unsigned char *data;     // MAP_PRIVATE이므로 고친 페이지만 복사되고 디스크에는 저장할 때 씀
+    long long size;
+    long long top;           // 화면 첫 줄의 오프셋 (HEX_ROW_BYTES의 배수)
+    long long cursor;
+    bool isLowNibble;        // 16진수 칸에서 다음에 칠 자리가 아래 4비트인지
+    bool isAsciiColumn;      // 아스키 칸에서 글자로 덮어쓰는 중인지
+    long long *undoOffsets;  // 되돌리기용 (오프셋, 원래 바이트)
+    unsigned char *undoBytes;
+    int undoCount;
+    int undoCapacity;
+    long long *dirtyOffsets; // 저장한 뒤로 고친 오프셋 (중복될 수 있음, 저장할 때 정렬함)
+    int dirtyCount;
+    int dirtyCapacity;
+} HexInfo;
+
+typedef struct BracketBlock
+{ // 연속된 줄들의 묶음, 블록을 지나는 동안 괄호 깊이가 어떻게 바뀌는지 요약함 ((, [, {는 +1, ), ], }는 -1)
+    Node *start;   // 블록의 첫 줄 바로 앞의 노드 (ENTER 또는 head)
+    int lineCount;
+    int depth;     // 블록 시작을 0으로 본 블록 끝의 깊이
+    int minDepth;  // 블록 안에서 가장 얕은 깊이 (0 이하)
+    bool isDirty;  // 편집된 뒤로 요약이 정확하지 않음, 괄호를 찾을 때 다시 셈
+} BracketBlock;
+
+typedef struct BracketInfo
+{ // 괄호 짝 찾기용 색인, 처음 찾을 때 만들고 편집하면 고친 블록만 다시 셈
+    bool isBuilt;
+    BracketBlock *blocks;
+    int blockCount;
+    int capacity;
+    int *treeDepths;    // 블록 요약에 대한 세그먼트 트리 (1부터 시작, 잎은 treeSize부터)
+    int *treeMinDepths;
+    int treeSize;
+    bool isTreeDirty;   // 블록이 합쳐지거나 새로 나뉜 경우 트리를 다시 만듦
+    int cursorLine;     // 화면을 그릴 때 찾은 커서의 괄호와 짝, 없으면 -1
+    int cursorColumn;
+    int matchLine;
+    int matchColumn;
+} BracketInfo;
+
+typedef struct SessionInfo
+{ // 큰 파일을 다시 열 때 줄 색인, 화면 위치, 최근 검색어를 되살리는 사이드카 (dir/.name.session)
+    bool isEnabled;
+    bool isSkipped;        // vite -n 파일이름, 사이드카를 읽지도 쓰지도 않음
+    bool isRestored;       // 사이드카의 줄 색인을 채워뒀으므로 읽는 동안 줄 길이와 칸 수를 세지 않음
+    char *path;
+    int frameY;            // 사이드카에 저장된 화면 위치, 없으면 -1
+    int frameX;
+    int cursorLine;
+    int cursorColumn;
+    Node *frameStart;      // 읽는 동안 찾은 frameY, cursorLine 줄의 시작 노드
+    Node *cursorStart;
+} SessionInfo;
+
+typedef struct SessionStamp
+{ // 세션 사이드카가 가리키는 파일의 크기, 수정 시간, 표본 해시
+    long long fileSize;
+    long long fileTime;
+    unsigned long long sample;
+} SessionStamp;
+
+typedef struct AutosaveJob
+{ // 쓰레드 풀에서 다 복사한 스냅숏을 사이드카에 씀
+    char *path;
+    char *text;
+    long long length;
+    double elapsed;
+    bool isFailed;
+    bool isDone;
+} AutosaveJob;
+
+typedef struct AutosaveInfo
+{ // 저장하지 않은 편집을 사이드카(dir/.name.autosave)에 씀, 입력을 막지 않도록 키 입력 사이에 조금씩 복사하고 쓰기는 쓰레드 풀에서 함
+    int idleMs;            // 0이면 자동 저장을 하지 않음
+    int editLimit;
+    char *path;
+    long long editCount;   // 문서를 바꿀 때마다 늘어남
+    long long savedCount;  // 마지막으로 쓴 (또는 Ctrl-S로 저장한) 때의 editCount
+    double lastEditTime;
+    double lastSaveTime;   // 마지막 자동 저장의 복사를 시작한 시각
+    double cost;           // 마지막 자동 저장의 복사와 쓰기에 걸린 시간
+    bool isInterrupted;    // 복사하다 편집이 들어왔으면 다음에는 편집 수와 상관없이 입력이 멈출 때까지 기다림
+    char *text;            // 복사 중인 스냅숏, 없으면 NULL
+    long long length;
+    long long capacity;
+    Node *next;            // 다음에 복사할 노드
+    long long snapshotCount; // 복사를 시작한 때의 editCount, 달라지면 스냅숏을 버림
+    double copyTime;
+    AutosaveJob *job;      // 쓰는 중인 스냅숏, 없으면 NULL
+} AutosaveInfo;
+
+typedef struct Edit
+{ // 문서의 (line, column)에서 oldLength 글자를 지우고 text를 넣음
+    int line;
+    int column;
+    int oldLength;
+    char *text;
+    int length;
+} Edit;
+
+typedef struct EditBatch
+{ // 한 번에 적용하고 되돌리는 편집 묶음, 편집들은 문서 순서대로 정렬되어 있고 겹치지 않음
+    Edit *edits;
+    int count;
+    int capacity;
+    bool isTyping; // 이어서 친 글자들은 하나로 합쳐서 되돌림
+} EditBatch;
+
+typedef struct UndoInfo
+{
+    EditBatch **batches;
+    int count;
+    int capacity;
+} UndoInfo;
+
+typedef struct SelectionInfo
+{ // 선택 영역과 클립보드
+    bool isSelecting;
+    bool isBlock;   // 사각형 선택, 블록의 줄마다 커서가 있는 것처럼 편집함
+    int markLine;   // 선택을 시작한 위치
+    int markColumn;
+    int markDisplay;
+    Node *markNode; // 선택을 시작한 위치의 앞 노드 (선택 중에 문서가 바뀌면 선택을 끝냄)
+    int startLine;  // 화면을 그릴 때 계산한 선택 영역 [start, end)
+    int startColumn;
+    int endLine;
+    int endColumn;
+    int leftDisplay;  // 사각형 선택의 화면상 칸 범위 [left, right)
+    int rightDisplay;
+    char pending[UTF8_MAX_LENGTH]; // 사각형 선택에서 입력 중인 여러 바이트짜리 글자
+    int pendingLength;
+    Node *clipboardFirst; // 복사한 구간의 첫 노드, 문서가 바뀌기 전까지는 바이트를 복사하지 않고 가리키기만 함
+    char *clipboardText;  // 바이트로 가지고 있는 클립보드 내용
+    int clipboardLength;
+    int clipboardFirstLine; // 클립보드 구간이 걸친 줄, 이 줄들을 고치는 편집이 오기 전까지는 노드를 가리킴
+    int clipboardLastLine;
+} SelectionInfo;
+
+typedef struct LineSpan
+{ // 줄 연산에서 한 줄의 노드 구간과 비교용으로 복사해둔 바이트의 위치
+    Node *first; // 빈 줄이면 NULL
+    Node *last;
+    int offset;
+    int length;
+    unsigned int hash;
+} LineSpan;
+
+typedef struct LineOperation
+{ // 줄들에 대한 정렬, 중복 제거, 필터
+    int type;
+    int count;
+    LineSpan *spans;
+    char *text;     // 줄들을 줄바꿈으로 이어 붙인 원래 내용, 비교에 쓰고 되돌리기에 그대로 넘겨줌
+    int textLength;
+    char *word;     // 필터할 단어 (대소문자 무시 모드에서는 소문자로 바꿔 둠)
+    Regex **regexes; // DFA 캐시는 쓰레드마다 따로 있어야 함
+    bool isCaseInsensitive;
+    bool isWholeWord;
+    bool *isKept;
+} LineOperation;
+
+typedef struct LineJob
+{ // 줄 연산을 쓰레드 풀에서 나눠서 하는 작업, 정렬에서는 order의 [start, middle)과 [middle, end)를 merged에 합침
+    LineOperation *operation;
+    int start;
+    int middle;
+    int end;
+    int *order;
+    int *merged;
+    bool isDone;
+} LineJob;
+
+typedef struct FilterInput
+{ // 외부 명령의 표준 입력에 쓰는 쓰레드에 넘겨줌
+    int fd;
+    char *text;
+    int length;
+} FilterInput;
+
+typedef struct Task
+{
+    void (*function)(void *arg, int worker);
+    void *arg;
+} Task;
+
+typedef struct ThreadPool
+{
+    pthread_t *threads;
+    int threadCount;
+    Task *tasks; // 원형 큐
+    int taskCapacity;
+    int taskHead;
+    int taskCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t taskCond; // 작업이 추가됨
+    pthread_cond_t doneCond; // 작업이 끝남
+} ThreadPool;
+
+typedef struct Utf8Decoder
+{ // 바이트를 하나씩 받아서 글자의 칸 수를 세는 상태 (파일을 청크로 읽을 때 글자가 청크 경계에 걸칠 수 있음)
+    unsigned char bytes[UTF8_MAX_LENGTH];
+    int length;
+} Utf8Decoder;
+
+typedef struct ColumnBreak
+{ // 칸 수가 바이트 수와 다를 수 있는 글자 (탭, 아스키가 아닌 글자)
+    int column;  // 글자가 시작하는 바이트 위치
+    int display; // 글자가 시작하는 화면상의 칸
+    unsigned char length;
+    unsigned char width;
+} ColumnBreak;
+
+typedef struct ColumnMap
+{ // 한 줄의 특수 글자 위치, 사이의 글자는 바이트 하나가 한 칸이므로 이분 탐색으로 칸과 바이트 위치를 바꿈
+    ColumnBreak *breaks;
+    int count;
+    int capacity;
+} ColumnMap;
+
+typedef struct LayoutInfo
+{ // 자동 줄 바꿈 모드에서 각 줄이 화면에서 몇 줄을 차지하는지 계산하기 위한 정보
+    int *lineLengths;   // 줄의 바이트 수
+    int *lineWidths;    // 줄이 화면에서 차지하는 칸 수
+    ColumnMap **columnMaps; // NULL이면 탭과 아스키가 아닌 글자가 없는 줄, unmeasuredColumnMap이면 아직 만들지 않음
+    int tabSize;
+    Utf8Decoder decoder; // 파일을 읽는 중인 마지막 줄의 디코딩 상태
+    int lineCount;
+    int capacity;
+    int *rowTree;       // 각 줄의 화면 줄 수에 대한 펜윅 트리 (1부터 시작)
+    int rowTreeWidth;   // rowTree를 만들 때의 화면 너비, 다르면 다시 만듦
+    bool isRowTreeDirty; // 줄이 추가/삭제된 경우
+} LayoutInfo;
 
-Node* enterHead;
-Node* enterTail;
-Node* currentLine;
+typedef struct SyntaxInfo
+{
+    int type;
+    unsigned char *lineStates; // 각 줄의 시작에서의 렉서 상태
+    int lineCount;
+    int capacity;
+    int validLines;    // [0, validLines) 줄의 상태는 정확함
+    int oldValidLines; // [validLines, oldValidLines) 줄의 상태는 수정 전 문서 기준으로 정확함
+    int editedLine;    // 이 줄 이후에서 상태가 같아지면 수렴한 것으로 봄
+    char *text;        // 렉싱할 줄을 복사해두는 버퍼
+    unsigned char *colors;
+    int textCapacity;
+} SyntaxInfo;
+
+typedef struct Editor
+{ // 문서 하나의 모든 상태, useEditor로 고르면 아래의 전역 변수들이 이 문서를 가리킴
+    Node *head;
+    Node *tail;
+    NodePool *nodePool;
+    Position *position;
+    DocumentInfo *documentInfo;
+    FileInfo *fileInfo;
+    SyntaxInfo *syntaxInfo;
+    LayoutInfo *layoutInfo;
+    SearchInfo *searchInfo;
+    UndoInfo *undoInfo;
+    SelectionInfo *selectionInfo;
+    TrigramInfo *trigramInfo;
+    DiffInfo *diffInfo;
+    HexInfo *hexInfo;
+    BracketInfo *bracketInfo;
+    SessionInfo *sessionInfo;
+    AutosaveInfo *autosaveInfo;
+} Editor;
+
+typedef struct Buffer
+{ // 열려있는 파일 하나
+    Editor *editor;
+    int windowY;          // 마지막으로 그린 화면 높이, 다른 버퍼에서 창 크기가 바뀌었으면 돌아올 때 맞춤
+    long long lastUsed;   // 버퍼를 떠난 순서, 캐시를 버릴 때 오래된 것부터 버림
+    bool isCacheReleased; // 화면과 괄호 캐시를 버렸음, 다음에 그릴 때 필요한 줄만 다시 만듦
+} Buffer;
+
+typedef struct BufferInfo
+{ // 버퍼 목록, 고른 버퍼의 Editor를 useEditor로 고르므로 바꾸는 데 문서 크기만큼의 시간이 들지 않음
+    Buffer *buffers;
+    int count;
+    int capacity;
+    int current;
+    long long clock;
+} BufferInfo;
+
+typedef struct RenderInfo
+{ // 키를 누르고 있어서 입력이 밀리면 이동은 바로 하고 그리기는 건너뜀, 키를 떼면 바로 멈춤
+    bool isDeferrable;   // 메인 루프가 이동 키를 처리하는 동안만 true
+    bool isFramePending; // 건너뛴 화면이 있음, 입력이 비면 그림
+    double lastFrameTime;
+} RenderInfo;
+
+typedef struct ProjectHit
+{ // 디렉터리 검색에서 찾은 곳 하나
+    int file;      // ProjectInfo의 paths 번호
+    int line;      // 작업 안에서는 조각의 첫 줄부터 센 줄, 합칠 때 파일의 첫 줄부터로 바꿈
+    int column;    // 줄에서의 바이트 위치
+    char *preview; // 찾은 곳 주변의 줄 내용 (제어 문자와 잘못된 UTF-8은 바꿔둠)
+} ProjectHit;
+
+typedef struct ProjectJob
+{ // 파일 하나 또는 큰 파일의 [offset, offset + length) 조각을 찾는 작업, length가 -1이면 파일 끝까지
+    struct ProjectInfo *search;
+    char *path;
+    int file;
+    long long offset;
+    long long length;
+    ProjectHit *hits;
+    int hitCount;
+    int hitCapacity;
+    int lineCount;           // 조각 안의 줄바꿈 수, 다음 조각의 줄 번호를 맞춤
+    long long searchedBytes;
+    bool isDone;
+} ProjectJob;
+
+typedef struct ProjectDirectory
+{ // 따라가는 중인 디렉터리 하나, 이름 순서대로 하나씩 꺼냄
+    char *path;
+    char **names;
+    int count;
+    int next;
+    int depth;
+} ProjectDirectory;
+
+typedef struct ProjectInfo
+{ // 마지막 디렉터리 검색, 결과 목록을 닫았다가 Ctrl-G로 다시 열 수 있음
+    char *directory;
+    char *typedWord;
+    char *word;          // 대소문자 무시 모드에서는 소문자로 바꿔 둠
+    int wordLength;
+    bool isCaseInsensitive;
+    bool isWholeWord;
+    bool isCanceled;     // 작업 쓰레드는 시작할 때 보고 건너뜀
+    ProjectDirectory walk[PROJECT_MAX_DEPTH + 1]; // 따라가는 중인 디렉터리들, 결과 목록을 그리는 사이에 조금씩 따라감
+    int walkCount;
+    char **paths;
+    int pathCount;
+    int pathCapacity;
+    ProjectJob **jobs;   // 작업 쓰레드가 가리키고 있으므로 작업은 따로 할당함
+    int jobCount;
+    int jobCapacity;
+    int mergedJobs;      // 앞에서부터 결과를 합친 작업 수 (결과는 파일 순서대로 보여줌)
+    int lineBase;        // 합치는 중인 파일에서 앞 조각들의 줄 수
+    ProjectHit *hits;
+    int hitCount;
+    int hitCapacity;
+    long long searchedBytes;
+    double startTime;
+    double elapsed;      // 다 찾았으면 걸린 시간, 아니면 -1
+    int selected;
+    int top;
+} ProjectInfo;
+
+// 문서의 상태는 쓰레드마다 useEditor로 고른 문서를 가리킴 (쓰레드마다 다른 문서를 동시에 다룰 수 있음)
+// 화면을 그리는 함수는 터미널과 windowSize, renderInfo를 같이 쓰므로 프런트엔드 쓰레드에서만 부름
+_Thread_local Editor *currentEditor;
+_Thread_local Node *head;
+_Thread_local Node *tail;
+_Thread_local NodePool *nodePool;
+_Thread_local Position *position;
+_Thread_local DocumentInfo *documentInfo;
+_Thread_local FileInfo *fileInfo;
+_Thread_local SyntaxInfo *syntaxInfo;
+_Thread_local LayoutInfo *layoutInfo;
+_Thread_local SearchInfo *searchInfo;
+_Thread_local UndoInfo *undoInfo;
+_Thread_local SelectionInfo *selectionInfo;
+_Thread_local TrigramInfo *trigramInfo;
+_Thread_local DiffInfo *diffInfo;
+_Thread_local HexInfo *hexInfo;
+_Thread_local BracketInfo *bracketInfo;
+_Thread_local SessionInfo *sessionInfo;
+_Thread_local AutosaveInfo *autosaveInfo;
+
+// 모든 문서가 같이 씀
+WindowSize *windowSize;
+ColumnMap unmeasuredColumnMap; // 특수 글자 위치를 아직 만들지 않은 줄을 표시함
+ThreadPool *threadPool;
+RenderInfo *renderInfo;
+pthread_once_t sharedStateOnce = PTHREAD_ONCE_INIT;
+
+// 프런트엔드(화면을 그리는 쓰레드)의 상태, 다른 쓰레드에서는 비어 있음
+_Thread_local BufferInfo *bufferInfo;
+_Thread_local ProjectInfo *projectInfo;
 // just print;
 void print(void);
+void showHelp(void);
+void initRenderInfo(void);
+bool isInputPending(void);
+bool skipFrame(void);
 
 // initalize
+void initNodePool(void);
 void initLinkedList(void);
 void initCurses(void);
 void initWindowSize(void);
 void initDocumentInfo(void);
 void initFileInfo(void);
+void initSyntaxInfo(void);
+void initLayoutInfo(void);
+void initSearchInfo(void);
+void initUndoInfo(void);
+void initSelectionInfo(void);
+void initTrigramInfo(void);
+void initDiffInfo(void);
+void initHexInfo(void);
+void initBracketInfo(void);
+void initSessionInfo(void);
+void initAutosaveInfo(void);
+
+// editor context (문서마다의 상태)
+void initSharedState(void);
+Editor *newEditor(void);
+void storeEditor(void);
+void useEditor(Editor *editor);
+
+// buffers (Ctrl-E로 여러 파일을 열고 Ctrl-N으로 바꿈, 같은 파일은 한 번만 읽음)
+void initBufferInfo(void);
+int addBuffer(Editor *editor);
+int findBuffer(char *filename);
+void leaveBuffer(char **clipboardText, int *clipboardLength);
+void enterBuffer(int index, char *clipboardText, int clipboardLength);
+void switchBuffer(int index);
+void releaseIdleCaches(void);
+void releaseBufferCaches(Buffer *buffer);
+bool isMemoryLow(void);
+void openBuffer(void);
+void bufferMenu(void);
+void fitFrameToWindow(int oldY);
+bool openBufferFile(char *filename);
+
+// project search (Ctrl-G, 디렉터리 아래의 파일들을 mmap해서 쓰레드 풀에서 찾고 결과를 오는 대로 목록에 보여줌)
+void searchProject(void);
+void startProjectSearch(char *directory, char *word);
+void openProjectDirectory(ProjectInfo *search, char *path, int depth);
+bool walkProjectDirectory(ProjectInfo *search, double duration);
+int compareNames(const void *a, const void *b);
+void addProjectFile(ProjectInfo *search, char *path, long long size);
+void runProjectJob(void *arg, int worker);
+void searchProjectText(ProjectJob *job, char *text, long long size);
+void addProjectHit(ProjectJob *job, char *text, long long size, long long lineStart, char *found, int line);
+void mergeProjectJobs(void);
+void freeProjectInfo(void);
+void showProjectResults(void);
+void printProjectResults(void);
+void openProjectHit(ProjectHit *hit);
+int countNewlines(char *text, int length);
+int fitTextWidth(char *text, int length, int width);
+char *readWholeFile(FILE *file, char *filename, int *length, bool *isFailed);
 
 // linked list
+Node *newNode(unsigned char data);
+void freeNode(Node *node);
 void insert(int data);
 void delete(void);
 
@@ -113,6 +940,82 @@ int current_row_length(void);
 int prev_row_length(void);
 int next_row_length(void);
 
+// line caches (줄 단위로 캐싱하는 정보들을 함께 갱신함)
+void lineChanged(int line, int delta);
+void lineSplit(int line, int column);
+void lineJoined(int line);
+int currentColumn(void);
+int currentDisplayColumn(int line);
+int currentLineIndex(void);
+
+// utf-8 (문서는 바이트로 저장하고, 화면에 그릴 때와 커서를 옮길 때만 글자 단위로 봄)
+int utf8Length(unsigned char lead);
+int decodeUtf8(unsigned char *bytes, int length, int *codepoint);
+bool isInRanges(int codepoint, int (*ranges)[2], int count);
+int charWidth(int codepoint);
+int nodeCharLength(Node *node, int display, int *width);
+int prevCharLength(Node *node);
+int tabWidth(int display);
+int feedUtf8(Utf8Decoder *decoder, unsigned char byte, int display);
+int flushUtf8(Utf8Decoder *decoder);
+int textWidth(char *text, int length);
+int prevTextCharLength(char *text, int length);
+bool isPlainText(char *text, int length);
+Node *lineStartOf(Node *node);
+ColumnBreak *breakBefore(ColumnMap *map, int column);
+int displayOfColumn(int line, Node *lineStart, int column);
+int columnOfDisplay(int line, Node *lineStart, int displayColumn, int *reached);
+int wrapColumnOfDisplay(int line, Node *lineStart, int displayColumn);
+int charLengthBefore(int line, Node *lineStart, int column);
+void printChar(int row, int column, Node *node, int length, int attribute);
+void scrollToDisplayColumn(int displayColumn);
+
+// wrap layout
+int wrapWidth(void);
+void layoutAppendLine(void);
+void layoutLineChanged(int line, int delta);
+void layoutLineSplit(int line, int column);
+void layoutLineJoined(int line);
+void layoutSetLineWidth(int line, int width);
+void layoutMeasureLine(int line, Node *lineStart);
+bool layoutIsPlainLine(int line);
+ColumnMap *layoutColumnMap(int line, Node *lineStart);
+void layoutFreeColumnMap(int line);
+int layoutLineRows(int line);
+void updateLayout(void);
+int layoutRowOfLine(int line);
+int layoutLineOfRow(int row, int *subRow);
+
+// wrap mode
+void toggleWrapMode(void);
+void resetFrameLastNode(void);
+void wrapSetCursor(int line, int column);
+void wrapSetFrameTop(int row);
+void wrapScrollToCursor(void);
+void wrapArrowUp(void);
+void wrapArrowDown(void);
+void wrapArrowRight(void);
+void wrapArrowLeft(void);
+void wrapPageUp(void);
+void wrapPageDown(void);
+void wrapBackspace(void);
+void wrapEnter(void);
+void wrapCommonKey(int key);
+void printWrapped(void);
+
+// syntax highlight
+int syntaxTypeFromFiletype(char *filetype);
+void resetSyntaxStates(void);
+void syntaxLineEdited(int line);
+void syntaxLineInserted(int line);
+void syntaxLineDeleted(int line);
+void storeLineState(int line, int state);
+int syntaxStateAt(int line, Node *lineStart);
+int lexLine(Node *lineStart, int state, int colorLength, Node **lineEnd);
+int lexC(char *text, int length, int state, unsigned char *colors);
+int lexJson(char *text, int length, int state, unsigned char *colors);
+int lexLog(char *text, int length, int state, unsigned char *colors);
+
 // key
 void backspace(void);
 void enter(void);
@@ -125,20 +1028,251 @@ void end(void);
 void pageUp(void);
 void pageDown(void);
 void commonKey(int key);
+void resize(void);
 
 // ctrl Functions
 void save(void);
 void quit(void);
 void find(void);
+void replace(void);
+bool undoEdits(void);
+void undo(void);
+
+// edit batch (여러 곳을 한 번의 선형 탐색으로 고치고 되돌림)
+EditBatch *createEditBatch(void);
+void addEdit(EditBatch *batch, int line, int column, int oldLength, char *text, int length);
+void freeEditBatch(EditBatch *batch);
+EditBatch *applyEdits(EditBatch *batch);
+void rebuildLineCaches(void);
+void moveCursorTo(int line, int column);
+void moveCursorToLine(int line, Node *lineStart, int column);
+Node *findLineStart(int line);
+void pushUndo(EditBatch *batch);
+void recordInsert(int key);
+void recordBackspace(void);
+bool readPrompt(char *message, char *buffer, int size);
+void printReplaceMessageBar(int currentResultIndex, int resultCount);
+
+// insert file, filter (다른 파일이나 외부 명령의 출력을 한 번의 편집으로 넣음)
+void insertFile(void);
+void filterLines(void);
+void *writeFilterInput(void *arg);
+
+// line operations (줄의 노드 구간을 새 순서로 다시 이어서 줄 내용을 복사하지 않음)
+void lineOperationMenu(void);
+void runLineOperation(int type, char *word);
+int compareLines(LineOperation *operation, int a, int b);
+void sortLineRange(LineOperation *operation, int *order, int *temp, int start, int end);
+void mergeLineRanges(LineOperation *operation, int *from, int *to, int start, int middle, int end);
+int *sortLines(LineOperation *operation);
+int uniqueLines(LineOperation *operation, int *result);
+bool lineContains(LineOperation *operation, char *text, int length, Regex *regex, char *isStart);
+void runLineSortJob(void *arg, int worker);
+void runLineMergeJob(void *arg, int worker);
+void runLineHashJob(void *arg, int worker);
+void runLineFilterJob(void *arg, int worker);
+void runLineJobs(LineOperation *operation, void (*function)(void *arg, int worker));
+
+// selection (Ctrl-B로 선택을 시작하고 Ctrl-C 복사, Ctrl-X 잘라내기, Ctrl-V 붙여넣기)
+void toggleSelection(bool isBlock);
+void updateSelectionRange(void);
+bool isSelected(int line, int column, int display);
+int selectionLength(void);
+void copySelection(void);
+void cutSelection(void);
+void paste(void);
+char *clipboardBytes(void);
+void detachClipboard(void);
+void detachClipboardAt(int first, int last);
+void clipboardLineSplit(int line);
+void clipboardLineJoined(int line);
+void beforeEdit(void);
+void printMessage(char *message);
+void spliceText(int line, int column, int oldLength, char *text, int length);
+int documentLineCount(void);
+int copyLine(int line, char *text, int capacity);
+char *blockText(int *length);
+void applyBlockEdits(char *text, int length, bool isBackspace);
+bool blockKey(int key);
 
 // in order to save
+bool saveDocument(char *filename, long long *writtenBytes, bool *isInPlace);
 void saveFileAsFilename(char *filename);
+bool writeWholeFile(char *filename);
+bool saveInPlace(long long *writtenBytes);
+void markLinesDirty(int first, int last);
+void markLineResized(int line);
+void resetDirtyLines(void);
+int compressionFromFilename(char *filename);
+
+// in order to read
+FILE *openTextFile(char *filename, int *compression);
+bool loadText(FILE *pFile, char *filename, int compression, long long *totalBytes, double *elapsed);
+bool loadFile(char *filename);
+void readFile(char *filename);
+int detectCompression(FILE *file);
+int readChunk(FileReader *reader, char *buffer);
+void *decompressFile(void *arg);
+FileReader *openFileReader(FILE *file, char *filename, int compression);
+ReadChunk *nextReadChunk(FileReader *reader);
+void releaseReadChunk(FileReader *reader);
+bool closeFileReader(FileReader *reader);
+void loadChunk(char *buffer, int length);
+double currentTimeMs(void);
+
+// hex view (NUL 바이트가 있는 파일은 mmap해서 오프셋, 16진수, 아스키 칸으로 보여주고 바이트를 덮어씀)
+bool hasNulBytes(FILE *file);
+bool openHexView(FILE *file);
+void printHex(void);
+int hexColumn(int index, bool isAscii);
+void moveHexCursor(void);
+bool hexKey(int key);
+void writeHexByte(long long offset, unsigned char byte, bool isRecorded);
+void undoHexByte(void);
+void saveHexView(void);
+int compareOffsets(const void *a, const void *b);
 
 // in order to find
 void highlight(PNode *p, char *word, int wordLength);
 void printFindMessageBar(char *word, int currentResultIndex, int resultCount);
 int countFindResult(PNode *wordListHead);
-PNode *findWordsInDocument(char *word);
+PNode *searchDocument(char *word, void (*onFirstResult)(PNode *result, char *word));
+void showFirstResult(PNode *result, char *word);
+void runSearchJob(void *arg, int worker);
+void searchLiteralChunk(SearchJob *job, char *word, int wordLength);
+void searchRegexChunk(SearchJob *job, Regex *regex);
+PNode *createResultList(void);
+void appendResult(PNode *listHead, Node *node, int x, int y, int length);
+
+// text chunk
+bool fillTextChunk(TextChunk *chunk, Node **from, int *line, int endLine);
+char *findBytes(char *text, int length, char *word, int wordLength);
+int foldCase(int ch);
+bool equalsFolded(char *text, char *word, int length);
+char *findBytesFolded(char *text, int length, char *word, int wordLength);
+bool isWordCharacter(int ch);
+bool isWholeWordAt(char *text, int length, int start, int end);
+
+// regex search
+RegexNode *newRegexNode(int type, RegexNode *left, RegexNode *right);
+void freeRegexNode(RegexNode *node);
+RegexNode *parseRegexAlternate(char **pattern, bool *isValid);
+RegexNode *parseRegexConcat(char **pattern, bool *isValid);
+RegexNode *parseRegexRepeat(char **pattern, bool *isValid);
+RegexNode *parseRegexAtom(char **pattern, bool *isValid);
+bool addRegexEscape(unsigned char *set, char c);
+void regexPrefix(RegexNode *node, Regex *regex, bool *isDone);
+int addNfaState(Regex *regex, int type, int set, int out, int out1);
+int compileRegexNode(Regex *regex, RegexNode *node, bool isReversed, int *end);
+Regex *compileRegex(char *pattern, bool isCaseInsensitive);
+void freeRegex(Regex *regex);
+void initDfa(Dfa *dfa, Regex *regex, int start, bool isUnanchored);
+void freeDfa(Dfa *dfa);
+void flushDfa(Dfa *dfa);
+int addDfaState(Dfa *dfa, int *nfaStates, int count);
+void addNfaClosure(Dfa *dfa, int state, int *nfaStates, int *count);
+int compareInt(const void *a, const void *b);
+int dfaStart(Dfa *dfa);
+int dfaStep(Dfa *dfa, int state, unsigned char ch);
+int regexLongestMatch(Regex *regex, char *text, int start, int length);
+bool searchRegexLine(Regex *regex, char *text, int length, char *isStart, PNode *listHead, Node **nodes, int line, bool isWholeWord);
+
+// trigram index
+char *sidecarPath(char *filename, char *suffix);
+bool writeFileAtomically(char *path, void (*write)(FILE *file, void *arg), void *arg, bool isSynced);
+bool getFileStamp(char *filename, long long *fileSize, long long *fileTime);
+unsigned int trigramHash(unsigned int trigram);
+void hashTrigrams(char *text, int length, unsigned char *bits);
+bool hasTrigrams(unsigned char *bits, char *word, int wordLength);
+TrigramBlock *nextTrigramCandidate(int *blockIndex, int *blockFirstLine, char *word, int wordLength);
+TrigramBlock *newTrigramBlock(Node *start);
+void addTrigramBlock(TrigramBlock *block);
+void retireTrigramMemory(void *memory);
+bool isTrigramIndexBuilt(void);
+void startTrigramIndex(char *filename);
+void finishTrigramIndex(char *filename);
+void trigramAppendText(char *text, int length);
+void trigramAppendLine(Node *lineEnd, int lineLength);
+void runTrigramHash(void *arg, int worker);
+void runTrigramSidecar(void *arg, int worker);
+bool writeTrigramSidecar(TrigramSidecar *sidecar);
+void writeTrigramContents(FILE *file, void *arg);
+bool readTrigramSidecar(char *path, long long fileSize, long long fileTime);
+void resetTrigramBlocks(void);
+int trigramBlockOfLine(int line, int *firstLine);
+void trigramLineChanged(int line);
+void trigramLineSplit(int line);
+void trigramLineJoined(int line);
+void refreshTrigramBlock(TrigramBlock *block);
+void saveTrigramSidecar(char *filename);
+
+// session sidecar (큰 파일을 닫을 때 줄 색인과 화면 위치, 최근 검색어를 저장하고 다시 열 때 되살림)
+bool sampleFile(char *filename, long long fileSize, unsigned long long *sample);
+void startSession(char *filename);
+bool readSessionSidecar(char *path, long long fileSize, long long fileTime, unsigned long long sample);
+void restoreSession(bool isFailed);
+void saveSession(void);
+void writeSessionContents(FILE *file, void *arg);
+void addRecentWord(char *word);
+
+// autosave (입력이 멈추거나 편집이 쌓이면 문서를 조금씩 복사해서 쓰레드 풀에서 사이드카에 씀, Ctrl-S로 저장하면 지움)
+bool hasNewerAutosave(char *filename);
+void noteEdit(void);
+int autosaveTimeout(void);
+void autosaveTick(void);
+void copyAutosaveSlice(void);
+void runAutosaveJob(void *arg, int worker);
+void writeAutosaveContents(FILE *file, void *arg);
+bool finishAutosaveJob(bool isWaiting);
+void discardAutosave(void);
+
+// diff against disk (Ctrl-D, 줄 해시에 선형 공간 마이어스 diff를 돌리고 편집한 줄만 다시 비교함)
+void diffView(void);
+bool readDiskHashes(char *filename);
+unsigned long long hashLine(Node *lineStart, Node **lineEnd);
+unsigned long long *bufferHashes(void);
+void ensureDiffCapacity(int lineCount);
+void runDiff(unsigned long long *hashes);
+void diffRange(DiffRun *run, int left, int top, int right, int bottom);
+bool diffMiddleSnake(DiffRun *run, int left, int top, int right, int bottom, int *snake);
+void resetDiffBaseline(void);
+int diffLineState(int line, Node *lineStart);
+void refreshDiffStates(void);
+int collectDiffHunks(DiffHunk **hunks);
+void printDiffMarkers(void);
+void diffLineChanged(int line);
+void diffLineSplit(int line, int column);
+void diffLineJoined(int line);
+
+// bracket matching (Ctrl-], 줄 묶음마다 괄호 깊이를 요약하고 세그먼트 트리로 짝이 있는 블록을 찾음)
+int bracketDelta(unsigned char data);
+unsigned char bracketPartner(unsigned char data);
+void buildBracketIndex(void);
+BracketBlock *addBracketBlock(Node *start);
+void resetBracketIndex(void);
+void refreshBracketBlock(BracketBlock *block);
+void refreshBracketTree(void);
+void updateBracketTree(int index);
+int findBracketBlockForward(int node, int left, int right, int from, int *depth);
+int findBracketBlockBackward(int node, int left, int right, int to, int *depth);
+Node *scanBrackets(Node *from, Node *stop, bool isForward, int *depth, int *line);
+bool findMatchingBracket(Node *node, int line, int *matchLine, int *matchColumn, Node **matchLineStart);
+bool cursorBracket(Node **node, int *line, int *column);
+void updateBracketMatch(void);
+bool isMatchedBracket(int line, int column);
+void jumpToMatchingBracket(void);
+int bracketBlockOfLine(int line, int *firstLine);
+void bracketLineChanged(int line);
+void bracketLineSplit(int line);
+void bracketLineJoined(int line);
+
+// thread pool
+void initThreadPool(void);
+void *runWorker(void *arg);
+void submitTask(void (*function)(void *arg, int worker), void *arg);
+void markTaskDone(bool *isDone);
+bool isTaskDone(bool *isDone);
+void waitTask(bool *isDone);
 
 // move page frame
 void moveFirstFrameRight(void);
@@ -146,6 +1280,16 @@ void moveLastFrameLeft(void);
 void moveFirstFrameLeft(void);
 void moveLastFrameRight(void);
 
+void initNodePool(void)
+{
+    nodePool = (NodePool *)malloc(sizeof(NodePool));
+    nodePool->slabCapacity = 16;
+    nodePool->slabs = (Node **)malloc(sizeof(Node *) * nodePool->slabCapacity);
+    nodePool->slabCount = 0;
+    nodePool->slabUsed = NODE_SLAB_SIZE;
+    nodePool->freeList = NULL;
+}
+
 void initLinkedList(void)
 {
     head = (Node *)malloc(sizeof(Node));
@@ -164,15 +1308,28 @@ void initLinkedList(void)
     tail->prev = head;
 }
 
+#ifndef VITE_LIBRARY // 화면을 그리거나 키를 받는 함수는 라이브러리(make libvite.a)에 넣지 않음
 void initCurses(void)
 {
+    setlocale(LC_ALL, ""); // 터미널의 UTF-8 설정을 따라 여러 바이트 글자를 그림
     initscr(); 
     keypad(stdscr, TRUE);    
     start_color();
-    init_pair(1, COLOR_BLACK, COLOR_WHITE);
+    use_default_colors();
+    init_pair(COLOR_HIGHLIGHT, COLOR_BLACK, COLOR_WHITE);
+    init_pair(COLOR_KEYWORD, COLOR_YELLOW, -1);
+    init_pair(COLOR_STRING, COLOR_GREEN, -1);
+    init_pair(COLOR_COMMENT, COLOR_CYAN, -1);
+    init_pair(COLOR_NUMBER, COLOR_MAGENTA, -1);
+    init_pair(COLOR_PREPROCESSOR, COLOR_BLUE, -1);
+    init_pair(COLOR_LOG_ERROR, COLOR_RED, -1);
+    init_pair(COLOR_LOG_WARNING, COLOR_YELLOW, -1);
+    init_pair(COLOR_LOG_INFO, COLOR_GREEN, -1);
+    init_pair(COLOR_LOG_DEBUG, COLOR_BLUE, -1);
     noecho();
     move(0, 0);
 }
+#endif
 
 void initWindowSize(void)
 {   
@@ -222,6 +1379,11 @@ void initDocumentInfo(void)
 
     documentInfo->frameX = 0;
     documentInfo->frameY = 0;
+    documentInfo->isWrapMode = false;
+    documentInfo->frameRow = 0;
+    documentInfo->cursorLine = 0;
+    documentInfo->cursorColumn = 0;
+    documentInfo->cursorDisplayColumn = 0;
 }
 
 void initFileInfo(void)
@@ -234,14 +1396,303 @@ void initFileInfo(void)
     fileInfo->isFileSaving = false;
     fileInfo->isUpdated = false;
     fileInfo->isNewFile = true;
+    fileInfo->isReadOnly = false;
+    fileInfo->compression = COMPRESSION_NONE;
+    fileInfo->diskSize = -1;
+    fileInfo->diskTime = -1;
+    fileInfo->resizedLine = INT_MAX;
+    fileInfo->dirtyRanges = (DirtyRange *)malloc(sizeof(DirtyRange) * DIRTY_RANGE_MAX);
+    fileInfo->dirtyCount = 0;
+}
+
+void initSyntaxInfo(void)
+{
+    syntaxInfo = (SyntaxInfo *)malloc(sizeof(SyntaxInfo));
+    syntaxInfo->type = SYNTAX_NONE;
+    syntaxInfo->lineStates = NULL;
+    syntaxInfo->lineCount = 0;
+    syntaxInfo->capacity = 0;
+    syntaxInfo->text = NULL;
+    syntaxInfo->colors = NULL;
+    syntaxInfo->textCapacity = 0;
+    resetSyntaxStates();
+}
+
+void initLayoutInfo(void)
+{
+    layoutInfo = (LayoutInfo *)malloc(sizeof(LayoutInfo));
+    layoutInfo->capacity = 1024;
+    layoutInfo->lineLengths = (int *)malloc(sizeof(int) * layoutInfo->capacity);
+    layoutInfo->lineWidths = (int *)malloc(sizeof(int) * layoutInfo->capacity);
+    layoutInfo->columnMaps = (ColumnMap **)malloc(sizeof(ColumnMap *) * layoutInfo->capacity);
+    layoutInfo->rowTree = NULL;
+    layoutInfo->lineLengths[0] = 0;
+    layoutInfo->lineWidths[0] = 0;
+    layoutInfo->columnMaps[0] = NULL;
+    layoutInfo->tabSize = DEFAULT_TAB_SIZE;
+    layoutInfo->decoder.length = 0;
+    layoutInfo->lineCount = 1;
+    layoutInfo->rowTreeWidth = 0;
+    layoutInfo->isRowTreeDirty = true;
+}
+
+void initSearchInfo(void)
+{
+    searchInfo = (SearchInfo *)malloc(sizeof(SearchInfo));
+    searchInfo->isRegex = false;
+    searchInfo->isCaseInsensitive = false;
+    searchInfo->isWholeWord = false;
+    searchInfo->recentCount = 0;
+}
+
+void initUndoInfo(void)
+{
+    undoInfo = (UndoInfo *)malloc(sizeof(UndoInfo));
+    undoInfo->capacity = 64;
+    undoInfo->batches = (EditBatch **)malloc(sizeof(EditBatch *) * undoInfo->capacity);
+    undoInfo->count = 0;
+}
+
+void initSelectionInfo(void)
+{
+    selectionInfo = (SelectionInfo *)malloc(sizeof(SelectionInfo));
+    selectionInfo->isSelecting = false;
+    selectionInfo->isBlock = false;
+    selectionInfo->clipboardFirst = NULL;
+    selectionInfo->clipboardText = NULL;
+    selectionInfo->clipboardLength = 0;
+    selectionInfo->clipboardFirstLine = 0;
+    selectionInfo->clipboardLastLine = -1;
+}
+
+void initTrigramInfo(void)
+{
+    trigramInfo = (TrigramInfo *)malloc(sizeof(TrigramInfo));
+    trigramInfo->isEnabled = false;
+    trigramInfo->isFromSidecar = false;
+    trigramInfo->isBuilt = false;
+    trigramInfo->capacity = 16;
+    trigramInfo->blocks = (TrigramBlock **)malloc(sizeof(TrigramBlock *) * trigramInfo->capacity);
+    trigramInfo->blockCount = 0;
+    trigramInfo->loadingLines = 0;
+    trigramInfo->loadingBlock = 0;
+    trigramInfo->retiredCapacity = 16;
+    trigramInfo->retired = (void **)malloc(sizeof(void *) * trigramInfo->retiredCapacity);
+    trigramInfo->retiredCount = 0;
+    trigramInfo->sidecarPath = NULL;
+}
+
+void initDiffInfo(void)
+{
+    diffInfo = (DiffInfo *)malloc(sizeof(DiffInfo));
+    diffInfo->isEnabled = false;
+    diffInfo->diskHashes = NULL;
+    diffInfo->diskCount = 0;
+    diffInfo->diskCapacity = 0;
+    diffInfo->diskLines = NULL;
+    diffInfo->lineStates = NULL;
+    diffInfo->lineCount = 0;
+    diffInfo->capacity = 0;
+}
+
+void initHexInfo(void)
+{
+    hexInfo = (HexInfo *)malloc(sizeof(HexInfo));
+    hexInfo->isEnabled = false;
+    hexInfo->isForced = false;
+    hexInfo->data = NULL;
+    hexInfo->size = 0;
+    hexInfo->top = 0;
+    hexInfo->cursor = 0;
+    hexInfo->isLowNibble = false;
+    hexInfo->isAsciiColumn = false;
+    hexInfo->undoCapacity = 64;
+    hexInfo->undoOffsets = (long long *)malloc(sizeof(long long) * hexInfo->undoCapacity);
+    hexInfo->undoBytes = (unsigned char *)malloc(hexInfo->undoCapacity);
+    hexInfo->undoCount = 0;
+    hexInfo->dirtyCapacity = 64;
+    hexInfo->dirtyOffsets = (long long *)malloc(sizeof(long long) * hexInfo->dirtyCapacity);
+    hexInfo->dirtyCount = 0;
+}
+
+void initBracketInfo(void)
+{
+    bracketInfo = (BracketInfo *)malloc(sizeof(BracketInfo));
+    bracketInfo->isBuilt = false;
+    bracketInfo->capacity = 16;
+    bracketInfo->blocks = (BracketBlock *)malloc(sizeof(BracketBlock) * bracketInfo->capacity);
+    bracketInfo->blockCount = 0;
+    bracketInfo->treeDepths = NULL;
+    bracketInfo->treeMinDepths = NULL;
+    bracketInfo->treeSize = 0;
+    bracketInfo->isTreeDirty = true;
+    bracketInfo->cursorLine = -1;
+    bracketInfo->matchLine = -1;
+}
+
+void initSessionInfo(void)
+{
+    sessionInfo = (SessionInfo *)malloc(sizeof(SessionInfo));
+    sessionInfo->isEnabled = false;
+    sessionInfo->isSkipped = false;
+    sessionInfo->isRestored = false;
+    sessionInfo->path = NULL;
+    sessionInfo->frameY = -1;
+    sessionInfo->frameX = 0;
+    sessionInfo->cursorLine = -1;
+    sessionInfo->cursorColumn = 0;
+    sessionInfo->frameStart = NULL;
+    sessionInfo->cursorStart = NULL;
+}
+
+void initAutosaveInfo(void)
+{
+    autosaveInfo = (AutosaveInfo *)malloc(sizeof(AutosaveInfo));
+    autosaveInfo->idleMs = AUTOSAVE_IDLE_MS;
+    autosaveInfo->editLimit = AUTOSAVE_EDIT_LIMIT;
+    autosaveInfo->path = NULL;
+    autosaveInfo->editCount = 0;
+    autosaveInfo->savedCount = 0;
+    autosaveInfo->lastEditTime = 0;
+    autosaveInfo->lastSaveTime = 0;
+    autosaveInfo->cost = 0;
+    autosaveInfo->isInterrupted = false;
+    autosaveInfo->text = NULL;
+    autosaveInfo->length = 0;
+    autosaveInfo->capacity = 0;
+    autosaveInfo->next = NULL;
+    autosaveInfo->snapshotCount = 0;
+    autosaveInfo->copyTime = 0;
+    autosaveInfo->job = NULL;
+}
+
+void initSharedState(void)
+{ // 모든 문서가 같이 쓰는 화면 크기와 쓰레드 풀, 화면 없이 라이브러리로 쓰는 경우에는 80x24로 봄
+    if (windowSize == NULL)
+    {
+        windowSize = (WindowSize *)malloc(sizeof(WindowSize));
+        windowSize->x = 80;
+        windowSize->y = 24;
+    }
+    initRenderInfo();
+    initThreadPool();
+}
+
+void initRenderInfo(void)
+{
+    renderInfo = (RenderInfo *)malloc(sizeof(RenderInfo));
+    renderInfo->isDeferrable = false;
+    renderInfo->isFramePending = false;
+    renderInfo->lastFrameTime = 0;
+}
+
+Editor *newEditor(void)
+{ // 빈 문서를 만듦, 부른 쓰레드는 새 문서를 고른 상태가 됨
+    pthread_once(&sharedStateOnce, initSharedState);
+    storeEditor();
+    currentEditor = (Editor *)malloc(sizeof(Editor));
+    initNodePool();
+    initLinkedList();
+    initDocumentInfo();
+    initFileInfo();
+    initSyntaxInfo();
+    initLayoutInfo();
+    initSearchInfo();
+    initUndoInfo();
+    initSelectionInfo();
+    initTrigramInfo();
+    initDiffInfo();
+    initHexInfo();
+    initBracketInfo();
+    initSessionInfo();
+    initAutosaveInfo();
+    storeEditor();
+    return currentEditor;
+}
+
+void storeEditor(void)
+{ // 전역 변수를 고른 문서에 돌려놓음 (찾기는 position을 바꿔 끼우기도 함)
+    if (currentEditor == NULL)
+        return;
+    currentEditor->head = head;
+    currentEditor->tail = tail;
+    currentEditor->nodePool = nodePool;
+    currentEditor->position = position;
+    currentEditor->documentInfo = documentInfo;
+    currentEditor->fileInfo = fileInfo;
+    currentEditor->syntaxInfo = syntaxInfo;
+    currentEditor->layoutInfo = layoutInfo;
+    currentEditor->searchInfo = searchInfo;
+    currentEditor->undoInfo = undoInfo;
+    currentEditor->selectionInfo = selectionInfo;
+    currentEditor->trigramInfo = trigramInfo;
+    currentEditor->diffInfo = diffInfo;
+    currentEditor->hexInfo = hexInfo;
+    currentEditor->bracketInfo = bracketInfo;
+    currentEditor->sessionInfo = sessionInfo;
+    currentEditor->autosaveInfo = autosaveInfo;
+}
+
+void useEditor(Editor *editor)
+{ // 이 쓰레드에서 다룰 문서를 고름, 한 문서는 한 번에 한 쓰레드만 골라야 함
+    storeEditor();
+    currentEditor = editor;
+    head = editor->head;
+    tail = editor->tail;
+    nodePool = editor->nodePool;
+    position = editor->position;
+    documentInfo = editor->documentInfo;
+    fileInfo = editor->fileInfo;
+    syntaxInfo = editor->syntaxInfo;
+    layoutInfo = editor->layoutInfo;
+    searchInfo = editor->searchInfo;
+    undoInfo = editor->undoInfo;
+    selectionInfo = editor->selectionInfo;
+    trigramInfo = editor->trigramInfo;
+    diffInfo = editor->diffInfo;
+    hexInfo = editor->hexInfo;
+    bracketInfo = editor->bracketInfo;
+    sessionInfo = editor->sessionInfo;
+    autosaveInfo = editor->autosaveInfo;
+}
+
+Node *newNode(unsigned char data)
+{ // malloc 헤더가 없으므로 글자 하나에 노드 크기만큼만 씀
+    Node *node;
+    if (nodePool->freeList != NULL)
+    {
+        node = nodePool->freeList;
+        nodePool->freeList = node->next;
+    }
+    else
+    {
+        if (nodePool->slabUsed == NODE_SLAB_SIZE)
+        {
+            if (nodePool->slabCount == nodePool->slabCapacity)
+            {
+                nodePool->slabCapacity *= 2;
+                nodePool->slabs = (Node **)realloc(nodePool->slabs, sizeof(Node *) * nodePool->slabCapacity);
+            }
+            nodePool->slabs[nodePool->slabCount++] = (Node *)malloc(sizeof(Node) * NODE_SLAB_SIZE);
+            nodePool->slabUsed = 0;
+        }
+        node = nodePool->slabs[nodePool->slabCount - 1] + nodePool->slabUsed++;
+    }
+    node->data = data;
+    return node;
+}
+
+void freeNode(Node *node)
+{
+    node->next = nodePool->freeList;
+    nodePool->freeList = node;
 }
 
 void insert(int data)
 {
-    Node *new_node = (Node *)malloc(sizeof(Node));
+    Node *new_node = newNode(data);
     Node *p = position->current;
 
-    new_node->data = data;
     new_node->next = p->next;
     new_node->prev = p;
 
@@ -257,7 +1708,7 @@ void delete()
     position->current->prev->next = position->current->next;
     position->current->next->prev = prev;
 
-    free(position->current);
+    freeNode(position->current);
     position->current = prev;
 }
 
@@ -322,907 +1773,8510 @@ int next_row_length(void)
     return count;
 }
 
-void print(void)
-{
-    if (fileInfo->isFileReading)
-        return;
-    clear();
-    
-    Node *p = documentInfo->frameFirstNode;
-        
-    int colCount = 0;
-    int rowCount = 0;
+void lineChanged(int line, int delta)
+{ // line에 delta만큼 글자가 추가/삭제됨
+    syntaxLineEdited(line);
+    layoutLineChanged(line, delta);
+    trigramLineChanged(line);
+    diffLineChanged(line);
+    bracketLineChanged(line);
+    if (delta != 0)
+        markLineResized(line);
+    else
+        markLinesDirty(line, line);
+}
 
-    
-    while (p->next != documentInfo->frameLastNode && p->next != tail)
+void lineSplit(int line, int column)
+{ // line의 column 위치에서 줄이 나뉨
+    syntaxLineInserted(line);
+    layoutLineSplit(line, column);
+    trigramLineSplit(line);
+    diffLineSplit(line, column);
+    bracketLineSplit(line);
+    clipboardLineSplit(line);
+    markLineResized(line);
+}
+
+void lineJoined(int line)
+{ // line이 윗줄과 합쳐짐
+    syntaxLineDeleted(line);
+    layoutLineJoined(line);
+    trigramLineJoined(line);
+    diffLineJoined(line);
+    bracketLineJoined(line);
+    clipboardLineJoined(line);
+    markLineResized(line - 1);
+}
+
+int currentColumn(void)
+{ // 커서가 줄의 몇번째 칸에 있는지 구함
+    int column = 0;
+    Node *p = position->current;
+    while (p->data != ENTER && p != head)
     {
-        if (p->next->data == ENTER)
-        {
-            colCount = 0;
-            rowCount++;
-        }
-        else
-        {
-            if (colCount >= documentInfo->frameX && colCount < documentInfo->frameX + windowSize->x - 1)
-            { // 커서가 frame안에 있어야지만 출력함
-                mvaddch(rowCount, colCount - documentInfo->frameX, p->next->data);
-            }
-            colCount += 1;
-        }
-        p = p->next;
+        p = p->prev;
+        column++;
     }
- 
-    attron(COLOR_PAIR(1));
+    return column;
+}
 
+int currentDisplayColumn(int line)
+{ // 커서가 줄의 몇번째 칸(화면 기준)에 있는지 구함
+    Node *lineStart = position->current;
+    int column = 0;
+    while (lineStart->data != ENTER && lineStart != head)
+    {
+        lineStart = lineStart->prev;
+        column++;
+    }
+    return displayOfColumn(line, lineStart, column);
+}
 
-    char leftMessage[100];
-    char rightMessage[100];
+int currentLineIndex(void)
+{ // 커서가 문서의 몇번째 줄에 있는지 구함
+    if (documentInfo->isWrapMode)
+        return documentInfo->cursorLine;
+    return documentInfo->frameY + position->y;
+}
 
-    if (fileInfo->isUpdated)
+// 화면에서 두 칸을 차지하는 글자 (한글, 한자, 가나, 전각 문자, 이모지)
+int wideRanges[][2] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC}, {0x23F0, 0x23F0},
+    {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615}, {0x2648, 0x2653}, {0x267F, 0x267F},
+    {0x2693, 0x2693}, {0x26A1, 0x26A1}, {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5},
+    {0x26CE, 0x26CE}, {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B}, {0x2728, 0x2728},
+    {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755}, {0x2757, 0x2757}, {0x2795, 0x2797},
+    {0x27B0, 0x27B0}, {0x27BF, 0x27BF}, {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55},
+    {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+    {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6F},
+    {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4}, {0x17000, 0x18AFF}, {0x1B000, 0x1B2FF},
+    {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202},
+    {0x1F210, 0x1F23B}, {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F64F},
+    {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F90C, 0x1F9FF}, {0x1FA70, 0x1FAFF}, {0x20000, 0x2FFFD},
+    {0x30000, 0x3FFFD},
+};
+
+// 앞 글자에 붙어서 칸을 차지하지 않는 글자 (결합 문자, 한글 자모의 중성/종성, 폭 없는 공백)
+int zeroWidthRanges[][2] = {
+    {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A}, {0x064B, 0x065F},
+    {0x0670, 0x0670}, {0x06D6, 0x06DC}, {0x0E31, 0x0E31}, {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E},
+    {0x1160, 0x11FF}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x20D0, 0x20FF},
+    {0xD7B0, 0xD7FF}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F},
+};
+
+int utf8Length(unsigned char lead)
+{ // 첫 바이트로 글자의 바이트 수를 구함, 글자의 첫 바이트가 될 수 없으면 0
+    if (lead < 0x80)
+        return 1;
+    if (lead >= 0xC2 && lead <= 0xDF)
+        return 2;
+    if (lead >= 0xE0 && lead <= 0xEF)
+        return 3;
+    if (lead >= 0xF0 && lead <= 0xF4)
+        return 4;
+    return 0;
+}
+
+int decodeUtf8(unsigned char *bytes, int length, int *codepoint)
+{ // 글자 하나를 디코딩해서 바이트 수를 돌려줌, 잘못된 바이트는 한 바이트짜리 글자로 보고 codepoint는 -1
+    int count = utf8Length(bytes[0]);
+    if (count == 1)
     {
-        sprintf(leftMessage, "[%c %s] - %d lines",
-                '*', fileInfo->filename, documentInfo->lineCount);
+        *codepoint = bytes[0];
+        return 1;
     }
-    else
+    *codepoint = -1;
+    if (count == 0 || count > length)
+        return 1;
+    int value = bytes[0] & (0xFF >> (count + 1));
+    for (int i = 1; i < count; i++)
     {
-        sprintf(leftMessage, "[%s] - %d lines",
-                fileInfo->filename, documentInfo->lineCount);
+        if ((bytes[i] & 0xC0) != 0x80)
+            return 1;
+        value = (value << 6) | (bytes[i] & 0x3F);
     }
+    if ((count == 3 && value < 0x800) || (count == 4 && (value < 0x10000 || value > 0x10FFFF)) ||
+        (value >= 0xD800 && value <= 0xDFFF)) // 너무 긴 표현, 서로게이트
+        return 1;
+    *codepoint = value;
+    return count;
+}
 
-    sprintf(rightMessage, "%s | %d/%d",
-            fileInfo->filetype,
-            position->y + 1 + documentInfo->frameY,
-            position->x + documentInfo->frameX);
-    
-    mvprintw(windowSize->y - 2, 0, "%s", leftMessage);
-    mvprintw(windowSize->y - 2, windowSize->x - strlen(rightMessage), "%s", rightMessage);
-
-    for (int i = strlen(leftMessage); i < windowSize->x - strlen(rightMessage); ++i)
+bool isInRanges(int codepoint, int (*ranges)[2], int count)
+{ // 정렬된 구간들에서 이분 탐색
+    int low = 0;
+    int high = count - 1;
+    while (low <= high)
     {
-        mvaddch(windowSize->y - 2, i, ' ');
+        int middle = (low + high) / 2;
+        if (codepoint < ranges[middle][0])
+            high = middle - 1;
+        else if (codepoint > ranges[middle][1])
+            low = middle + 1;
+        else
+            return true;
     }
-    attroff(COLOR_PAIR(1));
-
-    mvprintw(windowSize->y - 1, 0, "HELP: Ctrl-S = save | Ctrl-Q = quit | Ctrl-F = find");
+    return false;
+}
 
+int charWidth(int codepoint)
+{ // 글자가 화면에서 차지하는 칸 수, 잘못된 바이트(-1)는 ?로 그려서 한 칸
+    if (codepoint < 0x300)
+        return 1;
+    if (isInRanges(codepoint, zeroWidthRanges, sizeof(zeroWidthRanges) / sizeof(zeroWidthRanges[0])))
+        return 0;
+    if (isInRanges(codepoint, wideRanges, sizeof(wideRanges) / sizeof(wideRanges[0])))
+        return 2;
+    return 1;
+}
 
-    // 글이 없는 경우에는 ~표시를 하기
-    for (int i = 0; i < windowSize->y - documentInfo->lineCount - 2; i++)
+int nodeCharLength(Node *node, int display, int *width)
+{ // node에서 시작하는 글자의 바이트 수와 칸 수를 구함, display는 글자가 시작하는 화면상의 칸 (탭의 칸 수를 정함)
+    if (node->data < 0x80)
     {
-        mvprintw(windowSize->y - 3 - i, 0, "~");
+        *width = node->data == TAB ? tabWidth(display) : 1;
+        return 1;
     }
-    move(position->y, position->x);
-
-
+    unsigned char bytes[UTF8_MAX_LENGTH];
+    int length = 0;
+    for (Node *p = node; length < UTF8_MAX_LENGTH && p != tail; p = p->next)
+        bytes[length++] = p->data;
+    int codepoint;
+    int count = decodeUtf8(bytes, length, &codepoint);
+    *width = charWidth(codepoint);
+    return count;
 }
 
-void moveFirstFrameRight(void)
-{
-    if (fileInfo->isFileReading)
-        return;
-    documentInfo->frameFirstNode = documentInfo->frameFirstNode->next;
-    while (documentInfo->frameFirstNode->data != ENTER)
+int prevCharLength(Node *node)
+{ // node에서 끝나는 글자의 바이트 수 (왼쪽 화살표, 백스페이스)
+    if (node->data < 0x80)
+        return 1;
+    Node *start = node;
+    for (int count = 1; count <= UTF8_MAX_LENGTH && start != head && start->data != ENTER; count++)
     {
-        documentInfo->frameFirstNode = documentInfo->frameFirstNode->next;
+        if ((start->data & 0xC0) != 0x80)
+        { // 연속 바이트가 아니면 글자가 여기서 시작해야 함
+            int width;
+            return nodeCharLength(start, 0, &width) == count ? count : 1;
+        }
+        start = start->prev;
     }
+    return 1;
 }
 
-void moveFirstFrameLeft(void)
-{
-    if (fileInfo->isFileReading)
-        return;
-    documentInfo->frameFirstNode = documentInfo->frameFirstNode->prev;
-    while (documentInfo->frameFirstNode->data != ENTER && documentInfo->frameFirstNode != head)
+int tabWidth(int display)
+{ // 탭은 다음 탭 위치까지 칸을 차지함
+    return layoutInfo->tabSize - display % layoutInfo->tabSize;
+}
+
+int feedUtf8(Utf8Decoder *decoder, unsigned char byte, int display)
+{ // 바이트를 하나씩 넣어서 완성된 글자의 칸 수를 돌려줌 (nodeCharLength와 같은 규칙), display는 줄에서 지금까지 센 칸 수
+    int width = 0;
+    if (decoder->length > 0 && (byte & 0xC0) != 0x80)
+    { // 끝나지 않은 글자는 바이트마다 잘못된 글자로 봄
+        width = decoder->length;
+        decoder->length = 0;
+    }
+    if (decoder->length == 0)
     {
-        documentInfo->frameFirstNode = documentInfo->frameFirstNode->prev;
+        if (byte == TAB)
+            return width + tabWidth(display + width);
+        if (byte < 0x80 || utf8Length(byte) == 0)
+            return width + 1;
+        decoder->bytes[decoder->length++] = byte;
+        return width;
+    }
+    decoder->bytes[decoder->length++] = byte;
+    if (decoder->length == utf8Length(decoder->bytes[0]))
+    {
+        int codepoint;
+        if (decodeUtf8(decoder->bytes, decoder->length, &codepoint) == decoder->length)
+            width += charWidth(codepoint);
+        else
+            width += decoder->length;
+        decoder->length = 0;
     }
+    return width;
 }
 
-void moveLastFrameRight(void)
+int flushUtf8(Utf8Decoder *decoder)
+{ // 줄이 끝날 때 남은 바이트는 잘못된 글자로 셈
+    int width = decoder->length;
+    decoder->length = 0;
+    return width;
+}
+
+int textWidth(char *text, int length)
 {
-    if (fileInfo->isFileReading)
-        return;
-    documentInfo->frameLastNode = documentInfo->frameLastNode->next;
-    while (documentInfo->frameLastNode->data != ENTER && documentInfo->frameLastNode != tail)
+    Utf8Decoder decoder;
+    decoder.length = 0;
+    int width = 0;
+    for (int i = 0; i < length; i++)
+        width += feedUtf8(&decoder, text[i], width);
+    return width + flushUtf8(&decoder);
+}
+
+int fitTextWidth(char *text, int length, int width)
+{ // text 앞에서 width 칸 안에 들어가는 바이트 수, 글자 중간에서 자르지 않음
+    Utf8Decoder decoder;
+    decoder.length = 0;
+    int display = 0;
+    int fitted = 0;
+    for (int i = 0; i < length; i++)
     {
-        documentInfo->frameLastNode = documentInfo->frameLastNode->next;
+        display += feedUtf8(&decoder, text[i], display);
+        if (display > width)
+            break;
+        if (decoder.length == 0)
+            fitted = i + 1;
     }
+    return fitted;
 }
 
-void moveLastFrameLeft(void)
-{
-    if (fileInfo->isFileReading)
-        return;
-    documentInfo->frameLastNode = documentInfo->frameLastNode->prev;
-    while (documentInfo->frameLastNode->data != ENTER)
+int countNewlines(char *text, int length)
+{ // SSE2가 있으면 16바이트씩 비교해서 셈
+    int count = 0;
+    int i = 0;
+#ifdef __SSE2__
+    __m128i newlines = _mm_set1_epi8(ENTER);
+    for (; i + 16 <= length; i += 16)
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)(text + i)), newlines)));
+#endif
+    for (; i < length; i++)
+        count += text[i] == ENTER;
+    return count;
+}
+
+int prevTextCharLength(char *text, int length)
+{ // 입력 중인 문자열의 마지막 글자의 바이트 수 (찾기, 프롬프트에서 백스페이스)
+    int count = 1;
+    while (count < length && count < UTF8_MAX_LENGTH && ((unsigned char)text[length - count] & 0xC0) == 0x80)
+        count++;
+    return count;
+}
+
+bool isPlainText(char *text, int length)
+{ // 탭과 아스키가 아닌 바이트가 없으면 디코딩하지 않고 바이트 수를 칸 수로 씀, SSE2가 있으면 16바이트씩 확인함
+    int i = 0;
+#ifdef __SSE2__
+    __m128i tabs = _mm_set1_epi8(TAB);
+    __m128i bits = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16)
     {
-        documentInfo->frameLastNode = documentInfo->frameLastNode->prev;
+        __m128i chunk = _mm_loadu_si128((__m128i *)(text + i));
+        bits = _mm_or_si128(bits, _mm_or_si128(chunk, _mm_cmpeq_epi8(chunk, tabs)));
+    }
+    if (_mm_movemask_epi8(bits) != 0)
+        return false;
+#endif
+    for (; i < length; i++)
+    {
+        if ((unsigned char)text[i] >= 0x80 || text[i] == TAB)
+            return false;
     }
+    return true;
 }
 
-void backspace(void)
-{
-    if (position->current == head)
-        return;
-    int prl = prev_row_length();
-    int crl = current_row_length();
-    if (position->x == 0 && position->y == 0)
-    { // 페이지의 제일 처음인 경우 (문서 처음 x)
-        if (crl > 0 && documentInfo->frameX > 0)
-        { // 커서가 frame의 제일 처음인 경우
-            documentInfo->frameX--;
-        }
-        else
+Node *lineStartOf(Node *node)
+{ // node가 있는 줄의 앞 줄바꿈(또는 head)
+    while (node->data != ENTER && node != head)
+        node = node->prev;
+    return node;
+}
+
+ColumnBreak *breakBefore(ColumnMap *map, int column)
+{ // column 앞에서 시작하는 마지막 특수 글자, 없으면 NULL
+    int low = 0;
+    int high = map->count - 1;
+    ColumnBreak *found = NULL;
+    while (low <= high)
+    {
+        int middle = (low + high) / 2;
+        if (map->breaks[middle].column < column)
         {
-            position->y = 0;
-            position->x = prl;
-            moveFirstFrameLeft();
-            moveLastFrameLeft();
-            documentInfo->frameY--;
-            documentInfo->lineCount--;
+            found = &map->breaks[middle];
+            low = middle + 1;
         }
+        else
+            high = middle - 1;
     }
-    else if (position->x == 0)
-    { // 위 경우를 제외하고 커서가 제일 처음인 경우
+    return found;
+}
 
-        if (crl > 0 && documentInfo->frameX > 0)
-        { // 커서가 frame의 제일 처음인 경우
-            documentInfo->frameX--;
-        }
-        else
-        { // 커서가 진짜 라인의 제일 처음인 경우
-            if (documentInfo->frameLastNode == tail && documentInfo->frameY != 0)
-            { // 페이지가 제일 아래로 내려가 있는 경우
-                moveFirstFrameLeft();
-                documentInfo->frameY--;
-                position->x = prl;
+int displayOfColumn(int line, Node *lineStart, int column)
+{ // 줄의 column번째 바이트 위치가 화면상의 몇번째 칸인지 구함, 특수 글자 사이는 바이트 하나가 한 칸임
+    ColumnMap *map = layoutColumnMap(line, lineStart);
+    if (map == NULL)
+        return column;
+    ColumnBreak *found = breakBefore(map, column);
+    if (found == NULL)
+        return column;
+    if (column < found->column + found->length) // 글자 중간
+        return found->display;
+    return found->display + found->width + column - (found->column + found->length);
+}
+
+int columnOfDisplay(int line, Node *lineStart, int displayColumn, int *reached)
+{ // 화면상 displayColumn 칸을 넘지 않는 마지막 글자 경계의 바이트 위치, reached는 그 경계의 화면상 칸
+    int length = layoutInfo->lineLengths[line];
+    ColumnMap *map = layoutColumnMap(line, lineStart);
+    int column = 0;      // 마지막으로 지난 특수 글자의 끝
+    int display = 0;
+    int next = length;   // 다음 특수 글자의 시작
+    if (map != NULL)
+    { // 끝나는 칸이 displayColumn 이하인 마지막 특수 글자를 이분 탐색
+        int low = 0;
+        int high = map->count - 1;
+        int found = -1;
+        while (low <= high)
+        {
+            int middle = (low + high) / 2;
+            if (map->breaks[middle].display + map->breaks[middle].width <= displayColumn)
+            {
+                found = middle;
+                low = middle + 1;
             }
             else
-            { // 페이지가 제일 아래가 아닌 경우
-                position->y--;
-                position->x = prl;
-                moveLastFrameRight();
-            }
-            if (prl + 1 > windowSize->x)
-            { // 이전 줄이 윈도우 x크기보다 긴 경우
-                documentInfo->frameX = prl - windowSize->x + 1;
-                position->x = windowSize->x - 1;
-            }
-            documentInfo->lineCount--;
+                high = middle - 1;
         }
+        if (found >= 0)
+        {
+            column = map->breaks[found].column + map->breaks[found].length;
+            display = map->breaks[found].display + map->breaks[found].width;
+        }
+        if (found + 1 < map->count)
+            next = map->breaks[found + 1].column;
     }
-    else
+    int result = column + displayColumn - display;
+    if (result > next)
+        result = next;
+    *reached = display + result - column;
+    return result;
+}
+
+int wrapColumnOfDisplay(int line, Node *lineStart, int displayColumn)
+{ // 자동 줄 바꿈 모드에서 화면상의 칸을 같은 화면 줄에 있는 바이트 위치로 바꿈
+    int reached;
+    int column = columnOfDisplay(line, lineStart, displayColumn, &reached);
+    if (reached / wrapWidth() < displayColumn / wrapWidth() && column < layoutInfo->lineLengths[line])
+    { // 윗 화면 줄 끝에서 넘친 글자(넓은 글자, 탭) 다음으로 감
+        ColumnBreak *found = breakBefore(layoutColumnMap(line, lineStart), column + 1);
+        column += found->length;
+    }
+    return column;
+}
+
+int charLengthBefore(int line, Node *lineStart, int column)
+{ // 줄의 column 바로 앞에서 끝나는 글자의 바이트 수
+    ColumnMap *map = layoutColumnMap(line, lineStart);
+    ColumnBreak *found = map != NULL ? breakBefore(map, column) : NULL;
+    if (found != NULL && found->column + found->length == column)
+        return found->length;
+    return 1;
+}
+
+#ifndef VITE_LIBRARY
+void printChar(int row, int column, Node *node, int length, int attribute)
+{ // node에서 시작하는 length 바이트짜리 글자를 그림, 잘못된 바이트는 ?로 그림
+    if (length == 1)
     {
-        position->x--;
+        mvaddch(row, column, (node->data < 0x80 ? node->data : '?') | attribute);
+        return;
     }
-    move(position->y, position->x);
-    delete ();
-    print();
+    char bytes[UTF8_MAX_LENGTH];
+    for (int i = 0; i < length; i++)
+    {
+        bytes[i] = node->data;
+        node = node->next;
+    }
+    attron(attribute);
+    mvaddnstr(row, column, bytes, length);
+    attroff(attribute);
+}
+#endif
+
+void scrollToDisplayColumn(int displayColumn)
+{ // 커서가 화면상의 displayColumn 칸에 보이도록 frameX와 position->x를 맞춤
+    if (displayColumn < documentInfo->frameX)
+        documentInfo->frameX = displayColumn;
+    else if (displayColumn > documentInfo->frameX + windowSize->x - 2)
+        documentInfo->frameX = displayColumn - (windowSize->x - 2);
+    position->x = displayColumn - documentInfo->frameX;
 }
 
-void enter(void)
+int wrapWidth(void)
 {
-    insert(ENTER);
-    documentInfo->lineCount++;
-    documentInfo->frameX = 0;
-    position->x = 0;
-    if (documentInfo->lineCount >= windowSize->y - 1) // 문서의 라인 수가 화면 크기보다 클 경우
+    return windowSize->x - 1;
+}
+
+void layoutAppendLine(void)
+{ // 파일을 읽을 때 문서 끝에 줄을 추가함
+    if (layoutInfo->lineCount == layoutInfo->capacity)
     {
-        if (position->y == windowSize->y - 3)
-        { // 커서가 화면의 제일 밑인 경우
-            move(position->y, 0);
-            moveFirstFrameRight();
-            moveLastFrameRight();
-            documentInfo->frameY++;
-        }
-        else
-        {
-            move(++position->y, 0);
-            moveLastFrameLeft();
-        }
-    }
-    else
-    { // 이외의 경우
-        move(++position->y, 0);
+        layoutInfo->capacity *= 2;
+        layoutInfo->lineLengths = (int *)realloc(layoutInfo->lineLengths, sizeof(int) * layoutInfo->capacity);
+        layoutInfo->lineWidths = (int *)realloc(layoutInfo->lineWidths, sizeof(int) * layoutInfo->capacity);
+        layoutInfo->columnMaps = (ColumnMap **)realloc(layoutInfo->columnMaps, sizeof(ColumnMap *) * layoutInfo->capacity);
     }
+    layoutInfo->lineLengths[layoutInfo->lineCount] = 0;
+    layoutInfo->columnMaps[layoutInfo->lineCount] = NULL;
+    layoutInfo->lineWidths[layoutInfo->lineCount++] = 0;
+    layoutInfo->isRowTreeDirty = true;
+}
 
-    print();
+int layoutLineRows(int line)
+{ // 줄 끝에 커서를 놓을 수 있도록 길이가 너비의 배수이면 한 줄 더 차지함
+    return layoutInfo->lineWidths[line] / wrapWidth() + 1;
 }
 
-void arrowUp(void)
-{
-    if (position->y == 0 && documentInfo->frameY == 0)
+void layoutLineChanged(int line, int delta)
+{ // 바뀐 글자가 아스키라고 보고 칸 수도 같이 바꿈, 아니면 편집한 쪽에서 layoutMeasureLine으로 다시 셈
+    if (line < 0 || line >= layoutInfo->lineCount)
         return;
-
-    int prl = prev_row_length();
-    if (prl > position->x + documentInfo->frameX)
-    { // 윗줄이 커서의 x값보다 긴 경우
-        for (int i = 0; i < prl + 1; i++)
-        {
-            position->current = position->current->prev;
-        }
-        position->y--;
-    }
-    else
-    { // 윗줄이 커서의 x값보다 짧은 경우
-
-        for (int i = 0; i < position->x + documentInfo->frameX + 1; i++)
-        {
-            position->current = position->current->prev;
-        }
-
-        if (prl < documentInfo->frameX)
-        {
-            documentInfo->frameX = prl;
-            position->x = 0;
-        }
-        else
-        {
-            position->x = prl - documentInfo->frameX;
-        }
-        position->y--;
-    }
-    if (position->y < 0)
+    layoutInfo->lineLengths[line] += delta;
+    layoutSetLineWidth(line, layoutInfo->lineWidths[line] + delta);
+    if (layoutInfo->columnMaps[line] != NULL)
     {
-        position->y = 0;
-        moveFirstFrameLeft();
-        moveLastFrameLeft();
-        documentInfo->frameY--;
+        layoutFreeColumnMap(line);
+        layoutInfo->columnMaps[line] = &unmeasuredColumnMap;
     }
-    move(position->y, position->x);
-    print();
 }
 
-void arrowDown(void)
+void layoutSetLineWidth(int line, int width)
 {
-
-    if (position->y + documentInfo->frameY == documentInfo->lineCount - 1)
+    if (line < 0 || line >= layoutInfo->lineCount)
         return;
-    int crl = current_row_length();
-    int nrl = next_row_length();
-    if (nrl > position->x + documentInfo->frameX)
-    { // 아래 줄이 커서의 x값보다 긴 경우
-        for (int i = 0; i < crl + 1; i++)
-        {
-            position->current = position->current->next;
-        }
-        position->y++;
-    }
-    else
-    { // 아래 줄이 커서의 x값보다 짧은 경우
-        for (int i = 0; i < crl - (position->x + documentInfo->frameX) + nrl + 1; i++)
-        {
-            position->current = position->current->next;
-        }
+    int oldRows = layoutLineRows(line);
+    layoutInfo->lineWidths[line] = width;
+    int rowDelta = layoutLineRows(line) - oldRows;
 
-        if (nrl < documentInfo->frameX)
-        {
-            documentInfo->frameX = nrl;
-            position->x = 0;
-        }
-        else
-        {
-            position->y++;
-            position->x = nrl - documentInfo->frameX;
-        }
-    }
-    if (position->y > windowSize->y - 3)
+    if (rowDelta != 0 && !layoutInfo->isRowTreeDirty && layoutInfo->rowTreeWidth == wrapWidth())
     {
-        position->y--;
-        moveFirstFrameRight();
-        moveLastFrameRight();
-        documentInfo->frameY++;
+        for (int i = line + 1; i <= layoutInfo->lineCount; i += i & -i)
+            layoutInfo->rowTree[i] += rowDelta;
     }
-    move(position->y, position->x);
-    print();
 }
 
-void arrowRight(void)
+void layoutLineSplit(int line, int column)
 {
-    if (position->current->next == tail)
+    if (line < 0 || line >= layoutInfo->lineCount)
         return;
-    position->current = position->current->next;
-
-    if (position->current->data == ENTER)
+    if (layoutInfo->lineCount == layoutInfo->capacity)
     {
-        documentInfo->frameX = 0;
-        position->y++;
-        position->x = 0;
+        layoutInfo->capacity *= 2;
+        layoutInfo->lineLengths = (int *)realloc(layoutInfo->lineLengths, sizeof(int) * layoutInfo->capacity);
+        layoutInfo->lineWidths = (int *)realloc(layoutInfo->lineWidths, sizeof(int) * layoutInfo->capacity);
+        layoutInfo->columnMaps = (ColumnMap **)realloc(layoutInfo->columnMaps, sizeof(ColumnMap *) * layoutInfo->capacity);
     }
-    else if (position->x == windowSize->x - 2)
+    memmove(layoutInfo->lineLengths + line + 2, layoutInfo->lineLengths + line + 1,
+            sizeof(int) * (layoutInfo->lineCount - line - 1));
+    memmove(layoutInfo->lineWidths + line + 2, layoutInfo->lineWidths + line + 1,
+            sizeof(int) * (layoutInfo->lineCount - line - 1));
+    memmove(layoutInfo->columnMaps + line + 2, layoutInfo->columnMaps + line + 1,
+            sizeof(ColumnMap *) * (layoutInfo->lineCount - line - 1));
+    layoutInfo->lineLengths[line + 1] = layoutInfo->lineLengths[line] - column;
+    layoutInfo->lineLengths[line] = column;
+    // 탭과 아스키가 아닌 글자가 없는 줄이면 정확함, 아니면 편집한 쪽에서 두 줄을 다시 셈
+    int width = layoutInfo->lineWidths[line];
+    layoutInfo->lineWidths[line + 1] = width > column ? width - column : 0;
+    layoutInfo->lineWidths[line] = width < column ? width : column;
+    if (layoutInfo->columnMaps[line] != NULL)
     {
-        documentInfo->frameX++;
+        layoutFreeColumnMap(line);
+        layoutInfo->columnMaps[line] = &unmeasuredColumnMap;
     }
-    else
+    layoutInfo->columnMaps[line + 1] = layoutInfo->columnMaps[line];
+    layoutInfo->lineCount++;
+    layoutInfo->isRowTreeDirty = true;
+}
+
+void layoutLineJoined(int line)
+{ // 두 줄 중 하나라도 탭이나 아스키가 아닌 글자가 있으면 편집한 쪽에서 다시 셈
+    if (line <= 0 || line >= layoutInfo->lineCount)
+        return;
+    layoutInfo->lineLengths[line - 1] += layoutInfo->lineLengths[line];
+    layoutInfo->lineWidths[line - 1] += layoutInfo->lineWidths[line];
+    if (layoutInfo->columnMaps[line - 1] != NULL || layoutInfo->columnMaps[line] != NULL)
     {
-        position->x++;
+        layoutFreeColumnMap(line - 1);
+        layoutFreeColumnMap(line);
+        layoutInfo->columnMaps[line - 1] = &unmeasuredColumnMap;
     }
-    if (position->y == windowSize->y - 2)
+    memmove(layoutInfo->lineLengths + line, layoutInfo->lineLengths + line + 1,
+            sizeof(int) * (layoutInfo->lineCount - line - 1));
+    memmove(layoutInfo->lineWidths + line, layoutInfo->lineWidths + line + 1,
+            sizeof(int) * (layoutInfo->lineCount - line - 1));
+    memmove(layoutInfo->columnMaps + line, layoutInfo->columnMaps + line + 1,
+            sizeof(ColumnMap *) * (layoutInfo->lineCount - line - 1));
+    layoutInfo->lineCount--;
+    layoutInfo->isRowTreeDirty = true;
+}
+
+void layoutMeasureLine(int line, Node *lineStart)
+{ // 줄을 처음부터 디코딩해서 칸 수를 다시 세고 특수 글자 위치를 기록함 (탭이나 아스키가 아닌 글자가 있는 줄을 고친 경우)
+    layoutFreeColumnMap(line);
+    ColumnMap *map = NULL;
+    int display = 0;
+    int column = 0;
+    Node *p = lineStart->next;
+    while (p != tail && p->data != ENTER)
     {
-        position->y--;
-        move(position->y, position->x);
-        moveFirstFrameRight();
-        moveLastFrameRight();
+        int width;
+        int length = nodeCharLength(p, display, &width);
+        if (p->data >= 0x80 || p->data == TAB)
+        {
+            if (map == NULL)
+            {
+                map = (ColumnMap *)malloc(sizeof(ColumnMap));
+                map->capacity = 16;
+                map->count = 0;
+                map->breaks = (ColumnBreak *)malloc(sizeof(ColumnBreak) * map->capacity);
+            }
+            if (map->count == map->capacity)
+            {
+                map->capacity *= 2;
+                map->breaks = (ColumnBreak *)realloc(map->breaks, sizeof(ColumnBreak) * map->capacity);
+            }
+            ColumnBreak *entry = &map->breaks[map->count++];
+            entry->column = column;
+            entry->display = display;
+            entry->length = length;
+            entry->width = width;
+        }
+        display += width;
+        column += length;
+        for (int i = 0; i < length; i++)
+            p = p->next;
     }
-    move(position->y, position->x);
-    print();
+    layoutInfo->columnMaps[line] = map;
+    layoutSetLineWidth(line, display);
 }
 
-void arrowLeft(void)
+bool layoutIsPlainLine(int line)
+{ // 탭과 아스키가 아닌 글자가 없으면 바이트 위치가 곧 화면상의 칸임
+    return layoutInfo->columnMaps[line] == NULL;
+}
+
+ColumnMap *layoutColumnMap(int line, Node *lineStart)
+{ // 줄의 특수 글자 위치, 처음 쓸 때 만듦
+    if (layoutInfo->columnMaps[line] == &unmeasuredColumnMap)
+        layoutMeasureLine(line, lineStart);
+    return layoutInfo->columnMaps[line];
+}
+
+void layoutFreeColumnMap(int line)
 {
-    if (position->current == head)
+    ColumnMap *map = layoutInfo->columnMaps[line];
+    if (map == NULL || map == &unmeasuredColumnMap)
         return;
-    if (position->current->data == ENTER)
-    { // 라인의 제일 첫번째에서 왼쪽 화살표를 누른 경우
-        int prl = prev_row_length();
+    free(map->breaks);
+    free(map);
+    layoutInfo->columnMaps[line] = NULL;
+}
 
-        if (prl > windowSize->x - 1)
-        {
-            documentInfo->frameX = prl - windowSize->x - 1;
-            position->x = windowSize->x - 1;
-        }
-        else
-        {
-            position->x = prl;
-        }
+void updateLayout(void)
+{ // 화면 너비가 바뀌었거나 줄이 추가/삭제된 경우에만 트리를 다시 만듦 (문서는 다시 읽지 않음)
+    if (!layoutInfo->isRowTreeDirty && layoutInfo->rowTreeWidth == wrapWidth())
+        return;
 
-        if (position->current == documentInfo->frameFirstNode)
-        { // 페이지의 제일 첫 부분인 경우
-            moveFirstFrameLeft();
-            moveLastFrameLeft();
-        }
-        else
+    int n = layoutInfo->lineCount;
+    layoutInfo->rowTree = (int *)realloc(layoutInfo->rowTree, sizeof(int) * (layoutInfo->capacity + 1));
+    layoutInfo->rowTree[0] = 0;
+    for (int i = 1; i <= n; i++)
+        layoutInfo->rowTree[i] = layoutLineRows(i - 1);
+    for (int i = 1; i <= n; i++)
+    {
+        int parent = i + (i & -i);
+        if (parent <= n)
+            layoutInfo->rowTree[parent] += layoutInfo->rowTree[i];
+    }
+    layoutInfo->rowTreeWidth = wrapWidth();
+    layoutInfo->isRowTreeDirty = false;
+}
+
+int layoutRowOfLine(int line)
+{ // line이 시작하는 화면상의 줄 번호 (문서 처음부터)
+    int row = 0;
+    for (int i = line; i > 0; i -= i & -i)
+        row += layoutInfo->rowTree[i];
+    return row;
+}
+
+int layoutLineOfRow(int row, int *subRow)
+{ // 화면상의 줄 번호가 몇번째 줄의 몇번째 화면 줄인지 구함
+    int n = layoutInfo->lineCount;
+    int step = 1;
+    while (step * 2 <= n)
+        step *= 2;
+
+    int line = 0;
+    for (; step > 0; step /= 2)
+    {
+        if (line + step <= n && layoutInfo->rowTree[line + step] <= row)
         {
-            position->y--;
+            line += step;
+            row -= layoutInfo->rowTree[line];
         }
     }
-    else
-    {
-        position->x--;
+    if (line >= n)
+    { // 문서 끝을 넘어간 경우 마지막 줄의 마지막 화면 줄
+        line = n - 1;
+        row = layoutLineRows(line) - 1;
     }
-    move(position->y, position->x);
-    position->current = position->current->prev;
-    print();
+    *subRow = row;
+    return line;
 }
 
-void home(void)
+int syntaxTypeFromFiletype(char *filetype)
 {
-    documentInfo->frameX = 0;
+    if (strcmp(filetype, "c") == 0 || strcmp(filetype, "h") == 0 ||
+        strcmp(filetype, "cpp") == 0 || strcmp(filetype, "hpp") == 0 || strcmp(filetype, "cc") == 0)
+        return SYNTAX_C;
+    if (strcmp(filetype, "json") == 0)
+        return SYNTAX_JSON;
+    if (strcmp(filetype, "log") == 0)
+        return SYNTAX_LOG;
+    return SYNTAX_NONE;
+}
 
-    while (position->current->data != ENTER && position->current != head)
+void resetSyntaxStates(void)
+{ // 문서 전체가 바뀐 경우 (파일 읽기 등) 상태 캐시를 처음부터 다시 만듦
+    if (syntaxInfo->capacity < documentInfo->lineCount)
     {
-        position->current = position->current->prev;
+        syntaxInfo->capacity = documentInfo->lineCount * 2;
+        syntaxInfo->lineStates = (unsigned char *)realloc(syntaxInfo->lineStates, syntaxInfo->capacity);
     }
-    position->x = 0;
-    move(position->y, position->x);
-    print();
+    syntaxInfo->lineCount = documentInfo->lineCount;
+    syntaxInfo->lineStates[0] = LEX_NORMAL;
+    syntaxInfo->validLines = 1;
+    syntaxInfo->oldValidLines = 1;
+    syntaxInfo->editedLine = -1;
 }
 
-void end(void)
-{
-    int crl = current_row_length();
-    if (crl > windowSize->x)
+void syntaxLineEdited(int line)
+{ // line의 내용이 바뀌었으므로 다음 줄부터는 다시 렉싱해야 함
+    if (line + 1 >= syntaxInfo->validLines)
     {
-        documentInfo->frameX = crl - windowSize->x + 1;
-        position->x = windowSize->x - 1;
+        if (line > syntaxInfo->editedLine && syntaxInfo->editedLine >= 0)
+            syntaxInfo->editedLine = line;
+        return;
     }
-    else
+    if (syntaxInfo->oldValidLines < syntaxInfo->validLines)
+        syntaxInfo->oldValidLines = syntaxInfo->validLines;
+    syntaxInfo->validLines = line + 1;
+    if (line > syntaxInfo->editedLine)
+        syntaxInfo->editedLine = line;
+}
+
+void syntaxLineInserted(int line)
+{ // line이 둘로 나뉘어 line + 1에 새 줄이 생김
+    if (syntaxInfo->lineCount + 1 > syntaxInfo->capacity)
     {
-        position->x = crl;
+        syntaxInfo->capacity = (syntaxInfo->lineCount + 1) * 2;
+        syntaxInfo->lineStates = (unsigned char *)realloc(syntaxInfo->lineStates, syntaxInfo->capacity);
     }
-    while (position->current->next->data != ENTER && position->current->next != tail)
+    if (line + 1 < syntaxInfo->lineCount)
     {
-        position->current = position->current->next;
+        memmove(syntaxInfo->lineStates + line + 2, syntaxInfo->lineStates + line + 1,
+                syntaxInfo->lineCount - line - 1);
     }
-    move(position->y, position->x);
-    print();
+    syntaxInfo->lineCount++;
+
+    if (syntaxInfo->validLines > line + 1)
+        syntaxInfo->validLines++;
+    if (syntaxInfo->oldValidLines > line + 1)
+        syntaxInfo->oldValidLines++;
+    if (syntaxInfo->editedLine > line)
+        syntaxInfo->editedLine++;
+    syntaxLineEdited(line);
+    syntaxLineEdited(line + 1);
 }
 
-void pageUp(void)
-{
+void syntaxLineDeleted(int line)
+{ // line이 윗줄에 합쳐짐
+    if (line <= 0 || line >= syntaxInfo->lineCount)
+        return;
+    memmove(syntaxInfo->lineStates + line, syntaxInfo->lineStates + line + 1,
+            syntaxInfo->lineCount - line - 1);
+    syntaxInfo->lineCount--;
+
+    if (syntaxInfo->validLines > line)
+        syntaxInfo->validLines--;
+    if (syntaxInfo->oldValidLines > line)
+        syntaxInfo->oldValidLines--;
+    if (syntaxInfo->editedLine >= line)
+        syntaxInfo->editedLine--;
+    syntaxLineEdited(line - 1);
+}
 
-    if (documentInfo->frameFirstNode == head)
+void storeLineState(int line, int state)
+{ // line이 끝날 때의 상태 = 다음 줄의 시작 상태
+    int next = line + 1;
+    if (next != syntaxInfo->validLines || next >= syntaxInfo->lineCount)
         return;
-    if (documentInfo->frameY < windowSize->y - 2)
-    {
-        int lineCount = documentInfo->frameY;
-        for (int i = 0; i < lineCount; i++)
-        {
-            moveFirstFrameLeft();
-            moveLastFrameLeft();
-        }
-        documentInfo->frameY = 0;
-    }
-    else
-    {
-        documentInfo->frameLastNode = documentInfo->frameFirstNode;
-        moveLastFrameRight();
-        for (int i = 0; i < windowSize->y - 3; i++)
-        {
-            moveFirstFrameLeft();
-        }
-        documentInfo->frameY -= windowSize->y - 3;
-    }
-    position->current = documentInfo->frameFirstNode;
-    position->x = 0;
-    position->y = 0;
 
-    move(position->y, position->x);
-    print();
+    if (next > syntaxInfo->editedLine && next < syntaxInfo->oldValidLines &&
+        syntaxInfo->lineStates[next] == state)
+    { // 수정 전과 상태가 같아졌으므로 이후 줄들은 다시 렉싱할 필요가 없음
+        syntaxInfo->validLines = syntaxInfo->oldValidLines;
+        syntaxInfo->editedLine = -1;
+        return;
+    }
+    syntaxInfo->lineStates[next] = state;
+    syntaxInfo->validLines = next + 1;
+    if (syntaxInfo->validLines >= syntaxInfo->oldValidLines)
+        syntaxInfo->editedLine = -1;
 }
 
-void pageDown(void)
-{
-    if (documentInfo->frameLastNode == tail)
-        return;
+int syntaxStateAt(int line, Node *lineStart)
+{ // line의 시작 상태를 구함, 화면에 그리지 않는 줄은 상태만 계산함
+    if (syntaxInfo->type != SYNTAX_C || line >= syntaxInfo->lineCount)
+        return LEX_NORMAL; // 줄을 넘어가는 상태가 없는 문법
+    if (line < syntaxInfo->validLines)
+        return syntaxInfo->lineStates[line];
 
-    if (documentInfo->frameY + windowSize->y - 2 + windowSize->y - 2 > documentInfo->lineCount)
-    { // 한 페이지 전체를 넘길 수 없는 경우
-        int moveLineCount = documentInfo->lineCount - documentInfo->frameY - (windowSize->y - 2);
-        for (int i = 0; i < moveLineCount; i++)
+    // 마지막으로 정확한 줄의 시작까지 거슬러 올라감
+    Node *p = lineStart;
+    for (int i = line; i > syntaxInfo->validLines - 1; i--)
+    {
+        p = p->prev;
+        while (p->data != ENTER && p != head)
+            p = p->prev;
+    }
+
+    while (syntaxInfo->validLines <= line)
+    { // 항상 마지막으로 정확한 줄을 렉싱해서 다음 줄의 상태를 저장함
+        int i = syntaxInfo->validLines - 1;
+        Node *lineEnd;
+        storeLineState(i, lexLine(p, syntaxInfo->lineStates[i], 0, &lineEnd));
+        if (syntaxInfo->validLines == i + 2)
         {
-            moveFirstFrameRight();
-            moveLastFrameRight();
+            p = lineEnd;
+            continue;
         }
-        documentInfo->frameY += moveLineCount;
-    }
-    else
-    { // 한 페이지 전체를 넘길 수 있음
-        documentInfo->frameFirstNode = documentInfo->frameLastNode;
-        moveFirstFrameLeft();
-        for (int i = 0; i < windowSize->y - 3; i++)
+        // 수정 전 상태와 만나서 뒤의 줄들이 다시 정확해졌으므로 렉싱하지 않고 새로 정확해진 마지막 줄로 건너뜀
+        p = lineStart;
+        for (int j = line; syntaxInfo->validLines <= line && j > syntaxInfo->validLines - 1; j--)
         {
-            moveLastFrameRight();
+            p = p->prev;
+            while (p->data != ENTER && p != head)
+                p = p->prev;
         }
-        documentInfo->frameY += windowSize->y - 3;
     }
-    position->current = documentInfo->frameFirstNode;
-    position->x = 0;
-    position->y = 0;
-
-    move(position->y, position->x);
-    print();
+    return syntaxInfo->lineStates[line];
 }
 
-void saveFileAsFilename(char *filename)
-{
-    FILE *file = fopen(filename, "w");
-    Node *p = head->next;
-    while (p != tail)
+int lexLine(Node *lineStart, int state, int colorLength, Node **lineEnd)
+{ // lineStart 다음부터 줄 끝까지 렉싱하고, 앞의 colorLength 글자의 색을 colors에 채움
+    int length = 0;
+    Node *p = lineStart->next;
+    while (p != tail && p->data != ENTER)
     {
-        fputc((char)p->data, file);
+        if (length < LEX_MAX_LINE_LENGTH)
+        {
+            if (length >= syntaxInfo->textCapacity)
+            {
+                syntaxInfo->textCapacity = syntaxInfo->textCapacity ? syntaxInfo->textCapacity * 2 : 256;
+                syntaxInfo->text = (char *)realloc(syntaxInfo->text, syntaxInfo->textCapacity);
+                syntaxInfo->colors = (unsigned char *)realloc(syntaxInfo->colors, syntaxInfo->textCapacity);
+            }
+            syntaxInfo->text[length] = (char)p->data;
+        }
+        length++;
         p = p->next;
     }
-    fclose(file);
+    *lineEnd = p;
 
-    for (int i = 0; i < windowSize->x; i++)
-    {
-        mvprintw(windowSize->y - 1, i, " ");
+    if (length == 0 || length > LEX_MAX_LINE_LENGTH)
+    { // 너무 긴 줄은 강조하지 않음
+        if (colorLength > 0 && syntaxInfo->colors != NULL)
+            memset(syntaxInfo->colors, 0, colorLength < syntaxInfo->textCapacity ? colorLength : syntaxInfo->textCapacity);
+        return state;
     }
 
-    mvprintw(windowSize->y - 1, 0, "Save %s successfully.", filename);
-    fileInfo->filename = filename;
-
-    fileInfo->isNewFile = false;
+    memset(syntaxInfo->colors, 0, length);
+    if (syntaxInfo->type == SYNTAX_C)
+        return lexC(syntaxInfo->text, length, state, syntaxInfo->colors);
+    if (syntaxInfo->type == SYNTAX_JSON)
+        return lexJson(syntaxInfo->text, length, state, syntaxInfo->colors);
+    if (syntaxInfo->type == SYNTAX_LOG)
+        return lexLog(syntaxInfo->text, length, state, syntaxInfo->colors);
+    return state;
 }
 
-void save(void)
+int lexC(char *text, int length, int state, unsigned char *colors)
 {
-    fileInfo->isFileSaving = true;
-
-    if (fileInfo->isNewFile)
-    { // 새 파일인 경우
-        char newFilename[100];
-        for(int i=0;i<100;i++) {
-            newFilename[i] = '\0';
+    static const char *keywords[] = {
+        "auto", "break", "case", "char", "const", "continue", "default", "do", "double",
+        "else", "enum", "extern", "float", "for", "goto", "if", "inline", "int", "long",
+        "register", "restrict", "return", "short", "signed", "sizeof", "static", "struct",
+        "switch", "typedef", "union", "unsigned", "void", "volatile", "while", "bool",
+        "class", "namespace", "template", "typename", "public", "private", "protected",
+        "new", "delete", "this", "true", "false", "NULL", "nullptr", NULL};
+
+    int i = 0;
+    bool isLineStart = true; // 전처리기 판단용
+    while (i < length)
+    {
+        if (state == LEX_BLOCK_COMMENT)
+        {
+            while (i < length && !(text[i] == '*' && i + 1 < length && text[i + 1] == '/'))
+                colors[i++] = COLOR_COMMENT;
+            if (i < length)
+            {
+                colors[i] = colors[i + 1] = COLOR_COMMENT;
+                i += 2;
+                state = LEX_NORMAL;
+            }
+            continue;
         }
-        int index = 0;
-
-        // 오른쪽의 메세지
-        char rightMessage[100];
-        sprintf(rightMessage, "Enter = save | Esc = cancel");
-        mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), rightMessage);
 
-        for (int i = 0; i < windowSize->x - strlen(rightMessage); i++)
+        char c = text[i];
+        if (c == '/' && i + 1 < length && text[i + 1] == '/')
         {
-            mvprintw(windowSize->y - 1, i, " ");
+            memset(colors + i, COLOR_COMMENT, length - i);
+            break;
         }
-        move(windowSize->y - 1, 0);
-
-        while (true)
-        { // 파일이름 받아오기
-            int ch = getch();
-            if (ch == ENTER)
-            { // 파일 이름으로 저장하기
-                saveFileAsFilename(newFilename);
+        else if (c == '/' && i + 1 < length && text[i + 1] == '*')
+        {
+            colors[i] = colors[i + 1] = COLOR_COMMENT;
+            i += 2;
+            state = LEX_BLOCK_COMMENT;
+        }
+        else if (c == '"' || c == '\'')
+        {
+            int start = i++;
+            while (i < length && text[i] != c)
+                i += text[i] == '\\' ? 2 : 1;
+            if (i < length)
+                i++;
+            else
+                i = length;
+            memset(colors + start, COLOR_STRING, i - start);
+        }
+        else if (c == '#' && isLineStart)
+        {
+            int start = i++;
+            while (i < length && (isalnum((unsigned char)text[i]) || text[i] == '_' || text[i] == ' '))
+                i++;
+            memset(colors + start, COLOR_PREPROCESSOR, i - start);
+        }
+        else if (isdigit((unsigned char)c))
+        {
+            int start = i;
+            while (i < length && (isalnum((unsigned char)text[i]) || text[i] == '.'))
+                i++;
+            memset(colors + start, COLOR_NUMBER, i - start);
+        }
+        else if (isalpha((unsigned char)c) || c == '_')
+        {
+            int start = i;
+            while (i < length && (isalnum((unsigned char)text[i]) || text[i] == '_'))
+                i++;
+            for (int k = 0; keywords[k] != NULL; k++)
+            {
+                if ((int)strlen(keywords[k]) == i - start && memcmp(keywords[k], text + start, i - start) == 0)
+                {
+                    memset(colors + start, COLOR_KEYWORD, i - start);
+                    break;
+                }
+            }
+        }
+        else
+            i++;
+
+        if (c != ' ' && c != '\t')
+            isLineStart = false;
+    }
+    return state;
+}
+
+int lexJson(char *text, int length, int state, unsigned char *colors)
+{
+    int i = 0;
+    while (i < length)
+    {
+        char c = text[i];
+        if (c == '"')
+        {
+            int start = i++;
+            while (i < length && text[i] != '"')
+                i += text[i] == '\\' ? 2 : 1;
+            i = i < length ? i + 1 : length;
+
+            // 뒤에 ':'가 오면 키
+            int k = i;
+            while (k < length && (text[k] == ' ' || text[k] == '\t'))
+                k++;
+            memset(colors + start, k < length && text[k] == ':' ? COLOR_KEYWORD : COLOR_STRING, i - start);
+        }
+        else if (isdigit((unsigned char)c) || c == '-')
+        {
+            int start = i++;
+            while (i < length && (isdigit((unsigned char)text[i]) || strchr(".eE+-", text[i]) != NULL))
+                i++;
+            memset(colors + start, COLOR_NUMBER, i - start);
+        }
+        else if (isalpha((unsigned char)c))
+        {
+            int start = i;
+            while (i < length && isalpha((unsigned char)text[i]))
+                i++;
+            if ((i - start == 4 && (memcmp(text + start, "true", 4) == 0 || memcmp(text + start, "null", 4) == 0)) ||
+                (i - start == 5 && memcmp(text + start, "false", 5) == 0))
+                memset(colors + start, COLOR_NUMBER, i - start);
+        }
+        else
+            i++;
+    }
+    return state;
+}
+
+int lexLog(char *text, int length, int state, unsigned char *colors)
+{
+    static const char *levels[] = {
+        "FATAL", "CRITICAL", "ERROR", "ERR", "SEVERE",
+        "WARNING", "WARN",
+        "INFO", "NOTICE",
+        "DEBUG", "TRACE", NULL};
+    static const unsigned char levelColors[] = {
+        COLOR_LOG_ERROR, COLOR_LOG_ERROR, COLOR_LOG_ERROR, COLOR_LOG_ERROR, COLOR_LOG_ERROR,
+        COLOR_LOG_WARNING, COLOR_LOG_WARNING,
+        COLOR_LOG_INFO, COLOR_LOG_INFO,
+        COLOR_LOG_DEBUG, COLOR_LOG_DEBUG};
+
+    int i = 0;
+    while (i < length)
+    {
+        char c = text[i];
+        if (c == '"')
+        {
+            int start = i++;
+            while (i < length && text[i] != '"')
+                i += text[i] == '\\' ? 2 : 1;
+            i = i < length ? i + 1 : length;
+            memset(colors + start, COLOR_STRING, i - start);
+        }
+        else if (isupper((unsigned char)c))
+        { // 대문자로 된 심각도 단어
+            int start = i;
+            while (i < length && isupper((unsigned char)text[i]))
+                i++;
+            for (int k = 0; levels[k] != NULL; k++)
+            {
+                if ((int)strlen(levels[k]) == i - start && memcmp(levels[k], text + start, i - start) == 0)
+                {
+                    memset(colors + start, levelColors[k], i - start);
+                    break;
+                }
+            }
+            while (i < length && isalnum((unsigned char)text[i]))
+                i++;
+        }
+        else if (isalnum((unsigned char)c))
+        {
+            while (i < length && isalnum((unsigned char)text[i]))
+                i++;
+        }
+        else
+            i++;
+    }
+    return state;
+}
+
+#ifndef VITE_LIBRARY
+bool isInputPending(void)
+{ // 읽지 않은 키가 있는지 봄, 읽은 키는 되돌려둠
+    nodelay(stdscr, TRUE);
+    int ch = getch();
+    nodelay(stdscr, FALSE);
+    if (ch == ERR)
+        return false;
+    ungetch(ch);
+    return true;
+}
+
+bool skipFrame(void)
+{ // 이동 키가 밀려있고 마지막 화면을 다 그린 지 RENDER_FRAME_MS가 안 됐으면 그리지 않음
+    // 다 그린 시각부터 재므로 한 번 그리는 데 RENDER_FRAME_MS보다 오래 걸려도 밀린 키 사이의 화면은 건너뜀
+    if (renderInfo->isDeferrable && currentTimeMs() - renderInfo->lastFrameTime < RENDER_FRAME_MS && isInputPending())
+    {
+        renderInfo->isFramePending = true;
+        return true;
+    }
+    renderInfo->isFramePending = false;
+    return false;
+}
+
+void print(void)
+{
+    if (fileInfo->isFileReading || skipFrame())
+        return;
+    if (hexInfo->isEnabled)
+    {
+        printHex();
+        return;
+    }
+    clear();
+    updateSelectionRange();
+    updateBracketMatch();
+    
+    if (documentInfo->isWrapMode)
+    {
+        printWrapped();
+    }
+    else
+    {
+        Node *p = documentInfo->frameFirstNode;
+        int rowCount = 0;
+
+        // 화면에 그려지는 줄만 렉싱함
+        int colorLength = (documentInfo->frameX + windowSize->x - 1) * UTF8_MAX_LENGTH;
+        int lexState = LEX_NORMAL;
+        Node *lineEnd;
+        if (syntaxInfo->type != SYNTAX_NONE)
+        {
+            lexState = syntaxStateAt(documentInfo->frameY, p);
+            lexState = lexLine(p, lexState, colorLength, &lineEnd);
+            storeLineState(documentInfo->frameY, lexState);
+        }
+
+        while (true)
+        {
+            // frameX 칸 앞의 글자 경계부터 그림, 특수 글자 위치로 찾으므로 앞부분을 디코딩하지 않음
+            int colCount;  // 화면상의 칸
+            int byteCount = columnOfDisplay(documentInfo->frameY + rowCount, p, documentInfo->frameX, &colCount); // 문법 강조 색은 바이트마다 있음
+            for (int i = 0; i < byteCount; i++)
+                p = p->next;
+            while (p->next != tail && p->next->data != ENTER && colCount < documentInfo->frameX + windowSize->x - 1)
+            {
+                int width;
+                int length = nodeCharLength(p->next, colCount, &width);
+                if (width > 0 && colCount >= documentInfo->frameX && colCount + width <= documentInfo->frameX + windowSize->x - 1)
+                { // 글자 전체가 frame안에 있어야지만 출력함, 탭은 빈 칸으로 둠 (선택된 탭은 칸을 칠함)
+                    int color = 0;
+                    if (syntaxInfo->type != SYNTAX_NONE && byteCount < LEX_MAX_LINE_LENGTH)
+                        color = syntaxInfo->colors[byteCount];
+                    bool isInSelection = isSelected(documentInfo->frameY + rowCount, byteCount, colCount);
+                    if (isInSelection || isMatchedBracket(documentInfo->frameY + rowCount, byteCount))
+                        color = 1;
+                    if (p->next->data != TAB)
+                        printChar(rowCount, colCount - documentInfo->frameX, p->next, length, COLOR_PAIR(color));
+                    for (int i = 0; p->next->data == TAB && isInSelection && i < width; i++)
+                        mvaddch(rowCount, colCount - documentInfo->frameX + i, ' ' | COLOR_PAIR(1));
+                }
+                colCount += width;
+                byteCount += length;
+                for (int i = 0; i < length; i++)
+                    p = p->next;
+            }
+            while (p->next != tail && p->next->data != ENTER) // 화면 오른쪽 밖의 글자는 건너뜀
+                p = p->next;
+            if (p->next == tail || p->next == documentInfo->frameLastNode)
+                break;
+            p = p->next;
+            rowCount++;
+            if (syntaxInfo->type != SYNTAX_NONE)
+            {
+                lexState = lexLine(p, lexState, colorLength, &lineEnd);
+                storeLineState(documentInfo->frameY + rowCount, lexState);
+            }
+        }
+    }
+
+    if (diffInfo->isEnabled)
+        printDiffMarkers();
+
+    attron(COLOR_PAIR(1));
+
+
+    char leftMessage[100];
+    char rightMessage[100];
+
+    if (fileInfo->isUpdated)
+    {
+        sprintf(leftMessage, "[%c %s] - %d lines",
+                '*', fileInfo->filename, documentInfo->lineCount);
+    }
+    else
+    {
+        sprintf(leftMessage, "[%s] - %d lines",
+                fileInfo->filename, documentInfo->lineCount);
+    }
+    if (bufferInfo != NULL && bufferInfo->count > 1)
+        sprintf(leftMessage + strlen(leftMessage), " (%d/%d)", bufferInfo->current + 1, bufferInfo->count);
+
+    if (documentInfo->isWrapMode)
+    {
+        sprintf(rightMessage, "%s | wrap | %d/%d",
+                fileInfo->filetype,
+                documentInfo->cursorLine + 1,
+                documentInfo->cursorDisplayColumn);
+    }
+    else
+    {
+        sprintf(rightMessage, "%s | %d/%d",
+                fileInfo->filetype,
+                position->y + 1 + documentInfo->frameY,
+                position->x + documentInfo->frameX);
+    }
+    
+    mvprintw(windowSize->y - 2, 0, "%s", leftMessage);
+    mvprintw(windowSize->y - 2, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+
+    for (int i = strlen(leftMessage); i < windowSize->x - strlen(rightMessage); ++i)
+    {
+        mvaddch(windowSize->y - 2, i, ' ');
+    }
+    attroff(COLOR_PAIR(1));
+
+    if (selectionInfo->isBlock)
+        mvprintw(windowSize->y - 1, 0, "BLOCK: Arrows = extend | Type = edit every line | Ctrl-C copy | Ctrl-X cut | Esc = cancel");
+    else if (selectionInfo->isSelecting)
+        mvprintw(windowSize->y - 1, 0, "SELECT: Arrows = extend | Ctrl-C copy | Ctrl-X cut | Esc = cancel");
+    else
+        mvprintw(windowSize->y - 1, 0, "HELP: F1 all keys | Ctrl-S save | Ctrl-Q quit | Ctrl-F find | Ctrl-Z undo");
+
+
+    // 글이 없는 경우에는 ~표시를 하기
+    for (int i = 0; !documentInfo->isWrapMode && i < windowSize->y - documentInfo->lineCount - 2; i++)
+    {
+        mvprintw(windowSize->y - 3 - i, 0, "~");
+    }
+    move(position->y, position->x);
+    renderInfo->lastFrameTime = currentTimeMs();
+}
+
+void showHelp(void)
+{ // F1: 메세지 줄에 다 못 쓰는 키들을 화면 전체에 보여줌, 아무 키나 누르면 돌아감
+    static char *keys[] = {
+        "Ctrl-S  save",
+        "Ctrl-Q  quit",
+        "Ctrl-F  find",
+        "Ctrl-R  replace",
+        "Ctrl-Z  undo",
+        "Ctrl-W  wrap",
+        "Ctrl-B  select",
+        "Ctrl-K  block select",
+        "Ctrl-C  copy",
+        "Ctrl-X  cut",
+        "Ctrl-V  paste",
+        "Ctrl-O  insert file",
+        "Ctrl-P  filter lines",
+        "Ctrl-L  line operations",
+        "Ctrl-D  diff",
+        "Ctrl-]  matching bracket",
+        "Ctrl-E  open file",
+        "Ctrl-N  buffers",
+        "Ctrl-G  search files",
+    };
+    int count = sizeof(keys) / sizeof(keys[0]);
+    int rows = windowSize->y > 3 ? windowSize->y - 2 : 1;
+    int columnWidth = 28; // 창이 낮으면 여러 칸으로 나눔
+    erase();
+    for (int i = 0; i < count; i++)
+    {
+        int column = i / rows * columnWidth;
+        if (column + columnWidth > windowSize->x && i / rows > 0)
+            break; // 창이 좁으면 남는 키는 그리지 않음
+        mvprintw(i % rows, column, "%s", keys[i]);
+    }
+    attron(COLOR_PAIR(1));
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 2, i, ' ');
+    mvprintw(windowSize->y - 2, 0, "Keys");
+    attroff(COLOR_PAIR(1));
+    mvprintw(windowSize->y - 1, 0, "Press any key to return.");
+    getch();
+    print();
+}
+
+void printWrapped(void)
+{ // 자동 줄 바꿈 모드에서 화면에 보이는 줄만 그림
+    int rowWidth = wrapWidth();
+    int height = windowSize->y - 2;
+    Node *p = documentInfo->frameFirstNode;
+    int line = documentInfo->frameY;
+    int rowBase = -documentInfo->frameRow; // 현재 줄의 첫 화면 줄이 그려질 위치
+    int column;        // 줄에서의 화면상 칸
+    int byteCount;     // 줄에서의 바이트 위치
+
+    int lexState = LEX_NORMAL;
+    Node *lineEnd;
+    if (syntaxInfo->type != SYNTAX_NONE)
+    {
+        lexState = syntaxStateAt(line, p);
+        lexState = lexLine(p, lexState, rowWidth * height * UTF8_MAX_LENGTH, &lineEnd);
+        storeLineState(line, lexState);
+    }
+    // 화면 위로 올라간 화면 줄은 건너뜀
+    byteCount = columnOfDisplay(line, p, documentInfo->frameRow * rowWidth, &column);
+    for (int i = 0; i < byteCount; i++)
+        p = p->next;
+
+    while (p->next != tail)
+    {
+        if (p->next->data == ENTER)
+        {
+            rowBase += column / rowWidth + 1;
+            column = 0;
+            byteCount = 0;
+            line++;
+            if (rowBase >= height)
+                break;
+            if (syntaxInfo->type != SYNTAX_NONE)
+            {
+                lexState = lexLine(p->next, lexState, rowWidth * height * UTF8_MAX_LENGTH, &lineEnd);
+                storeLineState(line, lexState);
+            }
+            p = p->next;
+        }
+        else
+        {
+            int width;
+            int length = nodeCharLength(p->next, column, &width);
+            int row = rowBase + column / rowWidth;
+            if (row >= height)
                 break;
+            if (row >= 0 && width > 0)
+            { // 넓은 글자가 화면 줄의 마지막 칸에서 시작하면 남겨둔 오른쪽 한 칸까지 씀
+                int color = 0;
+                if (syntaxInfo->type != SYNTAX_NONE && byteCount < LEX_MAX_LINE_LENGTH)
+                    color = syntaxInfo->colors[byteCount];
+                bool isInSelection = isSelected(line, byteCount, column);
+                if (isInSelection || isMatchedBracket(line, byteCount))
+                    color = 1;
+                if (p->next->data != TAB)
+                    printChar(row, column % rowWidth, p->next, length, COLOR_PAIR(color));
+                for (int i = 0; p->next->data == TAB && isInSelection && i < width; i++)
+                    mvaddch(rowBase + (column + i) / rowWidth, (column + i) % rowWidth, ' ' | COLOR_PAIR(1));
+            }
+            column += width;
+            byteCount += length;
+            for (int i = 0; i < length; i++)
+                p = p->next;
+        }
+    }
+
+    // 글이 없는 경우에는 ~표시를 하기
+    for (int row = rowBase + column / rowWidth + 1; row < height; row++)
+    {
+        mvprintw(row, 0, "~");
+    }
+}
+#endif
+
+void moveFirstFrameRight(void)
+{
+    if (fileInfo->isFileReading)
+        return;
+    documentInfo->frameFirstNode = documentInfo->frameFirstNode->next;
+    while (documentInfo->frameFirstNode->data != ENTER)
+    {
+        documentInfo->frameFirstNode = documentInfo->frameFirstNode->next;
+    }
+}
+
+void moveFirstFrameLeft(void)
+{
+    if (fileInfo->isFileReading)
+        return;
+    documentInfo->frameFirstNode = documentInfo->frameFirstNode->prev;
+    while (documentInfo->frameFirstNode->data != ENTER && documentInfo->frameFirstNode != head)
+    {
+        documentInfo->frameFirstNode = documentInfo->frameFirstNode->prev;
+    }
+}
+
+void moveLastFrameRight(void)
+{
+    if (fileInfo->isFileReading)
+        return;
+    documentInfo->frameLastNode = documentInfo->frameLastNode->next;
+    while (documentInfo->frameLastNode->data != ENTER && documentInfo->frameLastNode != tail)
+    {
+        documentInfo->frameLastNode = documentInfo->frameLastNode->next;
+    }
+}
+
+void moveLastFrameLeft(void)
+{
+    if (fileInfo->isFileReading)
+        return;
+    documentInfo->frameLastNode = documentInfo->frameLastNode->prev;
+    while (documentInfo->frameLastNode->data != ENTER)
+    {
+        documentInfo->frameLastNode = documentInfo->frameLastNode->prev;
+    }
+}
+
+#ifndef VITE_LIBRARY
+void backspace(void)
+{
+    if (position->current == head)
+        return;
+    if (documentInfo->isWrapMode)
+    {
+        wrapBackspace();
+        return;
+    }
+    int line = documentInfo->frameY + position->y;
+    if (position->current->data == ENTER)
+    { // 커서가 진짜 라인의 제일 처음인 경우 윗줄과 합침
+        int prl = layoutInfo->lineWidths[line - 1];
+        bool isPlain = layoutIsPlainLine(line - 1) && layoutIsPlainLine(line);
+        if (position->y == 0)
+        { // 페이지의 제일 처음인 경우 (문서 처음 x)
+            moveFirstFrameLeft();
+            moveLastFrameLeft();
+            documentInfo->frameY--;
+        }
+        else if (documentInfo->frameLastNode == tail && documentInfo->frameY != 0)
+        { // 페이지가 제일 아래로 내려가 있는 경우
+            moveFirstFrameLeft();
+            documentInfo->frameY--;
+        }
+        else
+        { // 페이지가 제일 아래가 아닌 경우
+            position->y--;
+            moveLastFrameRight();
+        }
+        documentInfo->lineCount--;
+        delete ();
+        lineJoined(line);
+        if (!isPlain)
+        { // 아랫줄의 탭 위치가 바뀌고, 나뉘어 있던 바이트가 한 글자로 합쳐질 수 있음
+            layoutMeasureLine(line - 1, lineStartOf(position->current));
+            prl = currentDisplayColumn(line - 1);
+        }
+        scrollToDisplayColumn(prl);
+    }
+    else
+    {
+        // 탭과 아스키가 아닌 글자가 없는 줄은 칸 수를 다시 셀 필요가 없음
+        bool isPlain = layoutIsPlainLine(line);
+        int column = position->x + documentInfo->frameX - 1;
+        delete ();
+        lineChanged(line, -1);
+        if (!isPlain)
+        {
+            layoutMeasureLine(line, lineStartOf(position->current));
+            column = currentDisplayColumn(line);
+        }
+        scrollToDisplayColumn(column);
+    }
+    move(position->y, position->x);
+    print();
+}
+
+void enter(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapEnter();
+        return;
+    }
+    int line = documentInfo->frameY + position->y;
+    bool isPlain = layoutIsPlainLine(line);
+    lineSplit(line, currentColumn());
+    insert(ENTER);
+    if (!isPlain)
+    { // 나뉜 두 줄의 칸 수를 다시 셈
+        layoutMeasureLine(line, lineStartOf(position->current->prev));
+        layoutMeasureLine(line + 1, position->current);
+    }
+    documentInfo->lineCount++;
+    documentInfo->frameX = 0;
+    position->x = 0;
+    if (documentInfo->lineCount >= windowSize->y - 1) // 문서의 라인 수가 화면 크기보다 클 경우
+    {
+        if (position->y == windowSize->y - 3)
+        { // 커서가 화면의 제일 밑인 경우
+            move(position->y, 0);
+            moveFirstFrameRight();
+            moveLastFrameRight();
+            documentInfo->frameY++;
+        }
+        else
+        {
+            move(++position->y, 0);
+            moveLastFrameLeft();
+        }
+    }
+    else
+    { // 이외의 경우
+        move(++position->y, 0);
+    }
+
+    print();
+}
+
+void arrowUp(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapArrowUp();
+        return;
+    }
+    if (position->y == 0 && documentInfo->frameY == 0)
+        return;
+
+    // 윗줄에서 화면상 같은 칸(없으면 줄 끝)으로 감, 넓은 글자나 탭의 가운데로는 가지 않음
+    Node *prevLineStart = lineStartOf(lineStartOf(position->current)->prev);
+    int reached;
+    int column = columnOfDisplay(documentInfo->frameY + position->y - 1, prevLineStart,
+                                 position->x + documentInfo->frameX, &reached);
+    position->current = prevLineStart;
+    for (int i = 0; i < column; i++)
+        position->current = position->current->next;
+    position->y--;
+    scrollToDisplayColumn(reached);
+    if (position->y < 0)
+    {
+        position->y = 0;
+        moveFirstFrameLeft();
+        moveLastFrameLeft();
+        documentInfo->frameY--;
+    }
+    move(position->y, position->x);
+    print();
+}
+
+void arrowDown(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapArrowDown();
+        return;
+    }
+
+    if (position->y + documentInfo->frameY == documentInfo->lineCount - 1)
+        return;
+    // 아랫줄에서 화면상 같은 칸(없으면 줄 끝)으로 감
+    Node *nextLineStart = position->current->next;
+    while (nextLineStart->data != ENTER)
+        nextLineStart = nextLineStart->next;
+    int reached;
+    int column = columnOfDisplay(documentInfo->frameY + position->y + 1, nextLineStart,
+                                 position->x + documentInfo->frameX, &reached);
+    position->current = nextLineStart;
+    for (int i = 0; i < column; i++)
+        position->current = position->current->next;
+    position->y++;
+    scrollToDisplayColumn(reached);
+    if (position->y > windowSize->y - 3)
+    {
+        position->y--;
+        moveFirstFrameRight();
+        moveLastFrameRight();
+        documentInfo->frameY++;
+    }
+    move(position->y, position->x);
+    print();
+}
+
+void arrowRight(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapArrowRight();
+        return;
+    }
+    if (position->current->next == tail)
+        return;
+
+    if (position->current->next->data == ENTER)
+    {
+        position->current = position->current->next;
+        documentInfo->frameX = 0;
+        position->y++;
+        position->x = 0;
+    }
+    else
+    { // 글자 하나(여러 바이트일 수 있음)를 건너뜀
+        int display = position->x + documentInfo->frameX;
+        int width;
+        int length = nodeCharLength(position->current->next, display, &width);
+        for (int i = 0; i < length; i++)
+            position->current = position->current->next;
+        scrollToDisplayColumn(display + width);
+    }
+    if (position->y == windowSize->y - 2)
+    {
+        position->y--;
+        move(position->y, position->x);
+        moveFirstFrameRight();
+        moveLastFrameRight();
+        documentInfo->frameY++;
+    }
+    move(position->y, position->x);
+    print();
+}
+
+void arrowLeft(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapArrowLeft();
+        return;
+    }
+    if (position->current == head)
+        return;
+    int line = documentInfo->frameY + position->y;
+    if (position->current->data == ENTER)
+    { // 라인의 제일 첫번째에서 왼쪽 화살표를 누른 경우
+        if (position->current == documentInfo->frameFirstNode)
+        { // 페이지의 제일 첫 부분인 경우
+            moveFirstFrameLeft();
+            moveLastFrameLeft();
+            documentInfo->frameY--;
+        }
+        else
+        {
+            position->y--;
+        }
+        position->current = position->current->prev;
+        scrollToDisplayColumn(layoutInfo->lineWidths[line - 1]);
+    }
+    else
+    { // 글자 하나(여러 바이트일 수 있음)를 건너뜀
+        bool isPlain = position->current->data < 0x80 && position->current->data != TAB;
+        int length = prevCharLength(position->current);
+        for (int i = 0; i < length; i++)
+            position->current = position->current->prev;
+        scrollToDisplayColumn(isPlain ? position->x + documentInfo->frameX - 1 : currentDisplayColumn(line));
+    }
+    move(position->y, position->x);
+    print();
+}
+
+void home(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapSetCursor(documentInfo->cursorLine, 0);
+        wrapScrollToCursor();
+        move(position->y, position->x);
+        print();
+        return;
+    }
+    documentInfo->frameX = 0;
+
+    while (position->current->data != ENTER && position->current != head)
+    {
+        position->current = position->current->prev;
+    }
+    position->x = 0;
+    move(position->y, position->x);
+    print();
+}
+
+void end(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapSetCursor(documentInfo->cursorLine, layoutInfo->lineLengths[documentInfo->cursorLine]);
+        wrapScrollToCursor();
+        move(position->y, position->x);
+        print();
+        return;
+    }
+    while (position->current->next->data != ENTER && position->current->next != tail)
+    {
+        position->current = position->current->next;
+    }
+    scrollToDisplayColumn(layoutInfo->lineWidths[documentInfo->frameY + position->y]);
+    move(position->y, position->x);
+    print();
+}
+
+void pageUp(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapPageUp();
+        return;
+    }
+
+    if (documentInfo->frameFirstNode == head)
+        return;
+    if (documentInfo->frameY < windowSize->y - 2)
+    {
+        int lineCount = documentInfo->frameY;
+        for (int i = 0; i < lineCount; i++)
+        {
+            moveFirstFrameLeft();
+            moveLastFrameLeft();
+        }
+        documentInfo->frameY = 0;
+    }
+    else
+    {
+        documentInfo->frameLastNode = documentInfo->frameFirstNode;
+        moveLastFrameRight();
+        for (int i = 0; i < windowSize->y - 3; i++)
+        {
+            moveFirstFrameLeft();
+        }
+        documentInfo->frameY -= windowSize->y - 3;
+    }
+    position->current = documentInfo->frameFirstNode;
+    position->x = 0;
+    position->y = 0;
+
+    move(position->y, position->x);
+    print();
+}
+
+void pageDown(void)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapPageDown();
+        return;
+    }
+    if (documentInfo->frameLastNode == tail)
+        return;
+
+    if (documentInfo->frameY + windowSize->y - 2 + windowSize->y - 2 > documentInfo->lineCount)
+    { // 한 페이지 전체를 넘길 수 없는 경우
+        int moveLineCount = documentInfo->lineCount - documentInfo->frameY - (windowSize->y - 2);
+        for (int i = 0; i < moveLineCount; i++)
+        {
+            moveFirstFrameRight();
+            moveLastFrameRight();
+        }
+        documentInfo->frameY += moveLineCount;
+    }
+    else
+    { // 한 페이지 전체를 넘길 수 있음
+        documentInfo->frameFirstNode = documentInfo->frameLastNode;
+        moveFirstFrameLeft();
+        for (int i = 0; i < windowSize->y - 3; i++)
+        {
+            moveLastFrameRight();
+        }
+        documentInfo->frameY += windowSize->y - 3;
+    }
+    position->current = documentInfo->frameFirstNode;
+    position->x = 0;
+    position->y = 0;
+
+    move(position->y, position->x);
+    print();
+}
+#endif
+
+int compressionFromFilename(char *filename)
+{
+    char *dot = strrchr(filename, '.');
+    if (dot && strcmp(dot, ".gz") == 0)
+        return COMPRESSION_GZIP;
+#ifdef HAVE_ZSTD
+    if (dot && strcmp(dot, ".zst") == 0)
+        return COMPRESSION_ZSTD;
+#endif
+    return COMPRESSION_NONE;
+}
+
+void resetFrameLastNode(void)
+{ // frameFirstNode부터 한 화면 아래의 줄 끝을 찾음
+    documentInfo->frameLastNode = documentInfo->frameFirstNode;
+    for (int i = 0; i < windowSize->y - 2 && documentInfo->frameLastNode != tail; i++)
+    {
+        moveLastFrameRight();
+    }
+}
+
+#ifndef VITE_LIBRARY
+void toggleWrapMode(void)
+{
+    int height = windowSize->y - 2;
+    if (!documentInfo->isWrapMode)
+    { // 줄과 칸으로 커서를 기억하고 x축 스크롤을 없앰
+        documentInfo->cursorLine = documentInfo->frameY + position->y;
+        documentInfo->cursorColumn = currentColumn();
+        documentInfo->cursorDisplayColumn = documentInfo->frameX + position->x;
+        documentInfo->frameX = 0;
+        documentInfo->frameRow = 0;
+        documentInfo->isWrapMode = true;
+        wrapScrollToCursor();
+    }
+    else
+    { // 커서가 화면 안에 있도록 frame을 다시 맞춤
+        documentInfo->isWrapMode = false;
+        documentInfo->frameRow = 0;
+        while (documentInfo->cursorLine - documentInfo->frameY >= height)
+        {
+            moveFirstFrameRight();
+            documentInfo->frameY++;
+        }
+        resetFrameLastNode();
+
+        documentInfo->frameX = 0;
+        scrollToDisplayColumn(documentInfo->cursorDisplayColumn);
+        position->y = documentInfo->cursorLine - documentInfo->frameY;
+    }
+    print();
+}
+#endif
+
+void wrapSetCursor(int line, int column)
+{ // 커서를 (line, column)으로 옮김, 옮긴 거리만큼만 노드를 따라감
+    if (line == documentInfo->cursorLine)
+    {
+        for (int i = documentInfo->cursorColumn; i < column; i++)
+            position->current = position->current->next;
+        for (int i = documentInfo->cursorColumn; i > column; i--)
+            position->current = position->current->prev;
+    }
+    else if (line > documentInfo->cursorLine)
+    {
+        for (int i = documentInfo->cursorLine; i < line; i++)
+        {
+            position->current = position->current->next;
+            while (position->current->data != ENTER)
+                position->current = position->current->next;
+        }
+        for (int i = 0; i < column; i++)
+            position->current = position->current->next;
+    }
+    else
+    {
+        // 현재 줄의 시작으로 간 뒤 한 줄씩 올라감
+        while (position->current->data != ENTER && position->current != head)
+            position->current = position->current->prev;
+        for (int i = documentInfo->cursorLine; i > line; i--)
+        {
+            position->current = position->current->prev;
+            while (position->current->data != ENTER && position->current != head)
+                position->current = position->current->prev;
+        }
+        for (int i = 0; i < column; i++)
+            position->current = position->current->next;
+    }
+    documentInfo->cursorLine = line;
+    documentInfo->cursorColumn = column;
+    documentInfo->cursorDisplayColumn = layoutIsPlainLine(line) ? column : currentDisplayColumn(line);
+}
+
+void wrapSetFrameTop(int row)
+{ // 화면의 첫 줄을 문서의 row번째 화면 줄로 맞춤
+    int subRow;
+    int line = layoutLineOfRow(row, &subRow);
+    while (documentInfo->frameY < line)
+    {
+        moveFirstFrameRight();
+        documentInfo->frameY++;
+    }
+    while (documentInfo->frameY > line)
+    {
+        moveFirstFrameLeft();
+        documentInfo->frameY--;
+    }
+    documentInfo->frameRow = subRow;
+}
+
+void wrapScrollToCursor(void)
+{ // 커서가 화면 안에 보이도록 frame을 옮기고 화면상의 커서 위치를 계산함
+    updateLayout();
+    int width = wrapWidth();
+    int height = windowSize->y - 2;
+
+    int cursorRow = layoutRowOfLine(documentInfo->cursorLine) + documentInfo->cursorDisplayColumn / width;
+    int topRow = layoutRowOfLine(documentInfo->frameY) + documentInfo->frameRow;
+    if (cursorRow < topRow)
+        topRow = cursorRow;
+    else if (cursorRow >= topRow + height)
+        topRow = cursorRow - height + 1;
+    wrapSetFrameTop(topRow);
+
+    position->y = cursorRow - topRow;
+    position->x = documentInfo->cursorDisplayColumn % width;
+}
+
+#ifndef VITE_LIBRARY
+void wrapArrowUp(void)
+{
+    int width = wrapWidth();
+    int line = documentInfo->cursorLine;
+    int display = documentInfo->cursorDisplayColumn;
+    if (display >= width)
+    { // 같은 줄의 윗 화면 줄
+        wrapSetCursor(line, wrapColumnOfDisplay(line, lineStartOf(position->current), display - width));
+    }
+    else if (line > 0)
+    { // 윗줄의 마지막 화면 줄
+        int target = layoutInfo->lineWidths[line - 1] / width * width + display;
+        Node *prevLineStart = lineStartOf(lineStartOf(position->current)->prev);
+        wrapSetCursor(line - 1, wrapColumnOfDisplay(line - 1, prevLineStart, target));
+    }
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapArrowDown(void)
+{
+    int width = wrapWidth();
+    int line = documentInfo->cursorLine;
+    int display = documentInfo->cursorDisplayColumn;
+    if (display / width < layoutInfo->lineWidths[line] / width)
+    { // 같은 줄의 아랫 화면 줄
+        wrapSetCursor(line, wrapColumnOfDisplay(line, lineStartOf(position->current), display + width));
+    }
+    else if (line + 1 < documentInfo->lineCount)
+    { // 아랫줄의 첫 화면 줄
+        Node *nextLineStart = position->current->next;
+        while (nextLineStart->data != ENTER)
+            nextLineStart = nextLineStart->next;
+        wrapSetCursor(line + 1, wrapColumnOfDisplay(line + 1, nextLineStart, display % width));
+    }
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapArrowRight(void)
+{
+    if (position->current->next == tail)
+        return;
+    if (position->current->next->data == ENTER)
+        wrapSetCursor(documentInfo->cursorLine + 1, 0);
+    else
+    {
+        int width;
+        int length = nodeCharLength(position->current->next, documentInfo->cursorDisplayColumn, &width);
+        wrapSetCursor(documentInfo->cursorLine, documentInfo->cursorColumn + length);
+    }
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapArrowLeft(void)
+{
+    if (position->current == head)
+        return;
+    if (documentInfo->cursorColumn == 0)
+    {
+        int line = documentInfo->cursorLine - 1;
+        wrapSetCursor(line, layoutInfo->lineLengths[line]);
+    }
+    else
+        wrapSetCursor(documentInfo->cursorLine, documentInfo->cursorColumn - prevCharLength(position->current));
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapPageUp(void)
+{
+    updateLayout();
+    int width = wrapWidth();
+    int height = windowSize->y - 2;
+    int topRow = layoutRowOfLine(documentInfo->frameY) + documentInfo->frameRow;
+    if (topRow == 0)
+        return;
+
+    topRow = topRow > height - 1 ? topRow - (height - 1) : 0;
+    wrapSetFrameTop(topRow);
+
+    // 커서는 새 화면의 첫 줄로 옮김
+    int column = wrapColumnOfDisplay(documentInfo->frameY, documentInfo->frameFirstNode, documentInfo->frameRow * width);
+    wrapSetCursor(documentInfo->frameY, column);
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapPageDown(void)
+{
+    updateLayout();
+    int width = wrapWidth();
+    int height = windowSize->y - 2;
+    int totalRows = layoutRowOfLine(layoutInfo->lineCount);
+    int topRow = layoutRowOfLine(documentInfo->frameY) + documentInfo->frameRow;
+    if (topRow + height >= totalRows)
+        return;
+
+    topRow += height - 1;
+    if (topRow > totalRows - height)
+        topRow = totalRows - height;
+    wrapSetFrameTop(topRow);
+
+    int column = wrapColumnOfDisplay(documentInfo->frameY, documentInfo->frameFirstNode, documentInfo->frameRow * width);
+    wrapSetCursor(documentInfo->frameY, column);
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapBackspace(void)
+{
+    int line = documentInfo->cursorLine;
+    if (position->current->data == ENTER)
+    { // 윗줄과 합침
+        int column = layoutInfo->lineLengths[line - 1];
+        int display = layoutInfo->lineWidths[line - 1];
+        bool isPlain = layoutIsPlainLine(line - 1) && layoutIsPlainLine(line);
+        if (position->current == documentInfo->frameFirstNode)
+        { // 지워질 줄바꿈이 화면의 시작인 경우
+            moveFirstFrameLeft();
+            documentInfo->frameY--;
+            documentInfo->frameRow = 0;
+        }
+        delete ();
+        lineJoined(line);
+        documentInfo->lineCount--;
+        documentInfo->cursorLine--;
+        documentInfo->cursorColumn = column;
+        if (!isPlain)
+        { // 아랫줄의 탭 위치가 바뀌고, 나뉘어 있던 바이트가 한 글자로 합쳐질 수 있음
+            layoutMeasureLine(line - 1, lineStartOf(position->current));
+            display = currentDisplayColumn(line - 1);
+        }
+        documentInfo->cursorDisplayColumn = display;
+    }
+    else
+    {
+        bool isPlain = layoutIsPlainLine(line);
+        delete ();
+        lineChanged(line, -1);
+        documentInfo->cursorColumn--;
+        documentInfo->cursorDisplayColumn--;
+        if (!isPlain)
+        {
+            layoutMeasureLine(line, lineStartOf(position->current));
+            documentInfo->cursorDisplayColumn = currentDisplayColumn(line);
+        }
+    }
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapEnter(void)
+{
+    int line = documentInfo->cursorLine;
+    bool isPlain = layoutIsPlainLine(line);
+    lineSplit(line, documentInfo->cursorColumn);
+    insert(ENTER);
+    if (!isPlain)
+    { // 나뉜 두 줄의 칸 수를 다시 셈
+        layoutMeasureLine(line, lineStartOf(position->current->prev));
+        layoutMeasureLine(line + 1, position->current);
+    }
+    documentInfo->lineCount++;
+    documentInfo->cursorLine++;
+    documentInfo->cursorColumn = 0;
+    documentInfo->cursorDisplayColumn = 0;
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+
+void wrapCommonKey(int key)
+{
+    int line = documentInfo->cursorLine;
+    bool isPlain = key < 0x80 && key != TAB && layoutIsPlainLine(line);
+    insert(key);
+    lineChanged(line, 1);
+    documentInfo->cursorColumn++;
+    documentInfo->cursorDisplayColumn++;
+    if (!isPlain)
+    {
+        layoutMeasureLine(line, lineStartOf(position->current));
+        documentInfo->cursorDisplayColumn = currentDisplayColumn(line);
+    }
+    wrapScrollToCursor();
+    move(position->y, position->x);
+    print();
+}
+#endif
+
+bool saveDocument(char *filename, long long *writtenBytes, bool *isInPlace)
+{ // 문서를 filename에 저장함 (화면은 그리지 않음), 저장하지 못했으면 false
+    if (fileInfo->isReadOnly && filename == fileInfo->filename)
+        return false; // 다 읽지 못한 파일은 이름을 받아서 저장할 때만 씀
+    if (fileInfo->isNewFile || filename != fileInfo->filename)
+    { // 새 이름으로 저장하는 경우 확장자에 따라 압축 여부를 정함
+        fileInfo->compression = compressionFromFilename(filename);
+    }
+
+    // 읽은 뒤로 다른 곳에서 바뀌지 않은 파일은 고친 부분만 덮어씀
+    *writtenBytes = 0;
+    *isInPlace = !fileInfo->isNewFile && filename == fileInfo->filename && saveInPlace(writtenBytes);
+    if (!*isInPlace && !writeWholeFile(filename))
+        return false;
+
+    if (diffInfo->isEnabled)
+        resetDiffBaseline(); // 저장한 내용이 디스크와 비교할 새 기준임
+    if (filename != fileInfo->filename)
+        fileInfo->filename = strdup(filename); // save()의 파일 이름 버퍼는 지역 변수임
+    saveTrigramSidecar(fileInfo->filename);
+
+    fileInfo->isNewFile = false;
+    fileInfo->isReadOnly = false;
+    resetDirtyLines();
+    discardAutosave();
+    return true;
+}
+
+#ifndef VITE_LIBRARY
+void saveFileAsFilename(char *filename)
+{
+    for (int i = 0; i < windowSize->x; i++)
+    {
+        mvprintw(windowSize->y - 1, i, " ");
+    }
+    if (fileInfo->isReadOnly && filename == fileInfo->filename)
+    {
+        mvprintw(windowSize->y - 1, 0, "%s was not read completely. Save it under a new name.", filename);
+        return;
+    }
+
+    long long writtenBytes;
+    bool isInPlace;
+    if (!saveDocument(filename, &writtenBytes, &isInPlace))
+    {
+        mvprintw(windowSize->y - 1, 0, "Cannot save %s.", filename);
+        return;
+    }
+
+    if (diffInfo->isEnabled)
+    { // 지운 표시를 다시 그림
+        print();
+        for (int i = 0; i < windowSize->x; i++)
+            mvaddch(windowSize->y - 1, i, ' ');
+    }
+    if (isInPlace)
+        mvprintw(windowSize->y - 1, 0, "Save %s in place successfully. (%lld bytes written)", filename, writtenBytes);
+    else
+        mvprintw(windowSize->y - 1, 0, "Save %s successfully.", filename);
+}
+#endif
+
+bool writeWholeFile(char *filename)
+{ // 문서 전체를 (압축하는 형식이면 압축하면서) 새로 씀
+    // 같은 폴더의 임시 파일에 다 쓴 뒤 바꿔치기해서, 쓰다가 실패해도 원래 파일이 남음
+#ifndef HAVE_ZSTD
+    if (fileInfo->compression == COMPRESSION_ZSTD)
+        return false; // zstd 없이 빌드된 경우 압축하지 않은 내용을 .zst 파일에 쓰지 않음
+#endif
+    char *tempPath = (char *)malloc(strlen(filename) + 16);
+    sprintf(tempPath, "%s.vite-save", filename);
+    FILE *file = NULL;
+    gzFile gz = NULL;
+    if (fileInfo->compression == COMPRESSION_GZIP)
+        gz = gzopen(tempPath, "wb");
+    else
+        file = fopen(tempPath, "wb");
+    if (file == NULL && gz == NULL)
+    {
+        free(tempPath);
+        return false;
+    }
+    bool isFailed = false;
+
+#ifdef HAVE_ZSTD
+    ZSTD_CStream *zstdStream = NULL;
+    char zstdOutputData[READ_CHUNK_SIZE];
+    if (fileInfo->compression == COMPRESSION_ZSTD)
+    {
+        zstdStream = ZSTD_createCStream();
+        isFailed = zstdStream == NULL;
+    }
+#endif
+
+    // 한 글자씩 쓰지 않고 청크 단위로 모아서 씀
+    char buffer[READ_CHUNK_SIZE];
+    int length = 0;
+    Node *p = head->next;
+    while (true)
+    {
+        if (p != tail)
+        {
+            buffer[length++] = (char)p->data;
+            p = p->next;
+        }
+        if (length < READ_CHUNK_SIZE && p != tail)
+            continue;
+
+        if (gz != NULL)
+            isFailed |= length > 0 && gzwrite(gz, buffer, length) != length;
+#ifdef HAVE_ZSTD
+        else if (zstdStream != NULL)
+        {
+            ZSTD_inBuffer input = {buffer, length, 0};
+            ZSTD_EndDirective mode = p == tail ? ZSTD_e_end : ZSTD_e_continue;
+            size_t remaining;
+            do
+            {
+                ZSTD_outBuffer output = {zstdOutputData, READ_CHUNK_SIZE, 0};
+                remaining = ZSTD_compressStream2(zstdStream, &output, &input, mode);
+                if (ZSTD_isError(remaining))
+                {
+                    isFailed = true;
+                    break;
+                }
+                isFailed |= fwrite(zstdOutputData, 1, output.pos, file) != output.pos;
+            } while (mode == ZSTD_e_end ? remaining != 0 : input.pos < input.size);
+        }
+#endif
+        else
+            isFailed |= fwrite(buffer, 1, length, file) != (size_t)length;
+
+        length = 0;
+        if (p == tail)
+            break;
+    }
+
+#ifdef HAVE_ZSTD
+    if (zstdStream != NULL)
+        ZSTD_freeCStream(zstdStream);
+#endif
+    if (gz != NULL)
+        isFailed |= gzclose(gz) != Z_OK;
+    else
+        isFailed |= fclose(file) != 0;
+
+    struct stat fileStat;
+    if (!isFailed && stat(filename, &fileStat) == 0)
+        chmod(tempPath, fileStat.st_mode & 07777); // 원래 파일의 권한을 유지함
+#ifdef WINDOWS
+    if (!isFailed)
+        remove(filename); // 윈도우의 rename은 있는 파일을 덮어쓰지 않음
+#endif
+    if (isFailed || rename(tempPath, filename) != 0)
+    {
+        remove(tempPath);
+        free(tempPath);
+        return false;
+    }
+    free(tempPath);
+    return true;
+
+}
+
+bool saveInPlace(long long *writtenBytes)
+{ // 내용만 고친 줄들은 제자리에 덮어쓰고, 길이가 바뀐 줄이 있으면 그 줄부터 파일 끝까지 다시 쓴 뒤 크기를 맞춤
+#ifdef WINDOWS
+    return false;
+#else
+    long long fileSize;
+    long long fileTime;
+    if (fileInfo->compression != COMPRESSION_NONE || !getFileStamp(fileInfo->filename, &fileSize, &fileTime) ||
+        fileSize != fileInfo->diskSize || fileTime != fileInfo->diskTime)
+        return false;
+
+    // 줄 길이를 더해서 고친 구간들의 파일 안에서의 위치를 구함
+    int resizedLine = fileInfo->resizedLine < documentInfo->lineCount ? fileInfo->resizedLine : documentInfo->lineCount;
+    int rangeCount = 0;
+    while (rangeCount < fileInfo->dirtyCount && fileInfo->dirtyRanges[rangeCount].first < resizedLine)
+        rangeCount++;
+    long long *starts = (long long *)malloc(sizeof(long long) * (rangeCount + 1));
+    long long *ends = (long long *)malloc(sizeof(long long) * (rangeCount + 1));
+    long long offset = 0;
+    long long resizedOffset = 0;
+    int range = 0;
+    for (int line = 0; line < documentInfo->lineCount; line++)
+    {
+        if (range < rangeCount && line == fileInfo->dirtyRanges[range].first)
+            starts[range] = offset;
+        if (line == resizedLine)
+            resizedOffset = offset;
+        offset += layoutInfo->lineLengths[line];
+        if (range < rangeCount && line == fileInfo->dirtyRanges[range].last)
+        { // 줄 끝의 줄바꿈은 그대로임, 길이가 바뀐 줄에서 잘린 구간은 안에서 옮겨졌을 수 있는 마지막 줄바꿈까지 씀
+            ends[range++] = offset + (line == resizedLine - 1 && resizedLine < documentInfo->lineCount);
+        }
+        offset++;
+    }
+    if (range != rangeCount)
+    { // 구간이 문서 밖에서 끝나면 위치를 믿을 수 없으므로 새로 씀
+        free(starts);
+        free(ends);
+        return false;
+    }
+    long long newSize = offset - 1; // 마지막 줄 뒤에는 줄바꿈이 없음
+    if (resizedLine == documentInfo->lineCount)
+        resizedOffset = newSize;
+    if (newSize - resizedOffset > SAVE_TAIL_LIMIT || (resizedLine == documentInfo->lineCount && newSize != fileSize))
+    { // 앞쪽에서 길이가 바뀌면 뒤를 모두 밀어야 하므로 새로 씀
+        free(starts);
+        free(ends);
+        return false;
+    }
+    if (resizedLine < documentInfo->lineCount)
+    {
+        starts[rangeCount] = resizedOffset;
+        ends[rangeCount] = newSize;
+    }
+
+    int fd = open(fileInfo->filename, O_WRONLY);
+    bool isFailed = fd < 0;
+    int totalRanges = rangeCount + (resizedLine < documentInfo->lineCount);
+    Node *p = NULL;
+    int line = -1;
+    for (int i = 0; i < totalRanges && !isFailed; i++)
+    {
+        int firstLine = i < rangeCount ? fileInfo->dirtyRanges[i].first : resizedLine;
+        if (line < 0)
+        {
+            p = findLineStart(firstLine);
+            line = firstLine;
+        }
+        for (; line < firstLine; line++)
+        { // 구간은 줄 번호 순서이므로 앞으로만 따라감
+            for (p = p->next; p->data != ENTER; p = p->next)
+                ;
+        }
+
+        // 한 구간을 청크 단위로 모아서 씀
+        char buffer[READ_CHUNK_SIZE];
+        long long position = starts[i];
+        Node *q = p;
+        while (position < ends[i] && !isFailed)
+        {
+            int length = 0;
+            while (length < READ_CHUNK_SIZE && position + length < ends[i])
+            {
+                q = q->next;
+                buffer[length++] = (char)q->data;
+            }
+            isFailed = pwrite(fd, buffer, length, position) != length;
+            position += length;
+            *writtenBytes += length;
+        }
+    }
+    if (!isFailed && newSize != fileSize)
+        isFailed = ftruncate(fd, newSize) != 0;
+    if (fd >= 0)
+        isFailed |= close(fd) != 0;
+    free(starts);
+    free(ends);
+    if (isFailed)
+    { // 덮어쓰다가 실패하면 파일 전체를 다시 씀
+        fileInfo->diskTime = -1;
+        *writtenBytes = 0;
+        return false;
+    }
+    return true;
+#endif
+}
+
+void markLinesDirty(int first, int last)
+{ // 구간 전체의 바이트 수는 그대로이고 내용만 바뀐 줄들을 구간 목록에 합침
+    if (last >= fileInfo->resizedLine)
+    { // 구간 안의 줄 길이는 바뀌었을 수 있으므로 길이가 바뀐 줄 뒤와 걸치면 구간 처음부터 다시 씀
+        markLineResized(first);
+        return;
+    }
+    DirtyRange *ranges = fileInfo->dirtyRanges;
+    int low = 0; // first - 1 이후에서 끝나는 첫 구간
+    int high = fileInfo->dirtyCount;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (ranges[middle].last < first - 1)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < fileInfo->dirtyCount && ranges[low].first <= last + 1)
+    { // 겹치거나 붙어 있는 구간들을 하나로 합침
+        if (first < ranges[low].first)
+            ranges[low].first = first;
+        if (last > ranges[low].last)
+            ranges[low].last = last;
+        int next = low + 1;
+        while (next < fileInfo->dirtyCount && ranges[next].first <= ranges[low].last + 1)
+        {
+            if (ranges[next].last > ranges[low].last)
+                ranges[low].last = ranges[next].last;
+            next++;
+        }
+        memmove(ranges + low + 1, ranges + next, sizeof(DirtyRange) * (fileInfo->dirtyCount - next));
+        fileInfo->dirtyCount -= next - low - 1;
+        return;
+    }
+    if (fileInfo->dirtyCount == DIRTY_RANGE_MAX)
+    { // 구간이 너무 많으면 전체를 하나로 합침
+        ranges[0].last = ranges[fileInfo->dirtyCount - 1].last;
+        fileInfo->dirtyCount = 1;
+        markLinesDirty(first, last);
+        return;
+    }
+    memmove(ranges + low + 1, ranges + low, sizeof(DirtyRange) * (fileInfo->dirtyCount - low));
+    ranges[low].first = first;
+    ranges[low].last = last;
+    fileInfo->dirtyCount++;
+}
+
+void markLineResized(int line)
+{ // 이 줄부터 뒤쪽의 파일 내용이 밀리므로 저장할 때 파일 끝까지 다시 씀
+    if (line < 0)
+        line = 0;
+    if (line < fileInfo->resizedLine)
+        fileInfo->resizedLine = line;
+    // 이 줄부터는 통째로 다시 쓰므로 걸친 구간은 앞 줄까지로 자르고 빈 구간은 버림 (구간은 줄 번호 순서임)
+    while (fileInfo->dirtyCount > 0 && fileInfo->dirtyRanges[fileInfo->dirtyCount - 1].last >= line)
+    {
+        DirtyRange *last = &fileInfo->dirtyRanges[fileInfo->dirtyCount - 1];
+        if (last->first <= line - 1)
+        {
+            last->last = line - 1;
+            break;
+        }
+        fileInfo->dirtyCount--;
+    }
+}
+
+void resetDirtyLines(void)
+{ // 파일을 읽거나 저장한 뒤에는 디스크의 파일과 문서가 같음
+    fileInfo->resizedLine = INT_MAX;
+    fileInfo->dirtyCount = 0;
+    if (!getFileStamp(fileInfo->filename, &fileInfo->diskSize, &fileInfo->diskTime))
+        fileInfo->diskSize = -1;
+}
+
+#ifndef VITE_LIBRARY
+void save(void)
+{
+    if (hexInfo->isEnabled)
+    { // 헥스 보기는 고친 바이트만 제자리에 씀
+        saveHexView();
+        return;
+    }
+    fileInfo->isFileSaving = true;
+
+    if (fileInfo->isNewFile || fileInfo->isReadOnly)
+    { // 새 파일이거나 다 읽지 못한 파일인 경우 이름을 받아서 저장함
+        char newFilename[100];
+        for(int i=0;i<100;i++) {
+            newFilename[i] = '\0';
+        }
+        int index = 0;
+
+        // 오른쪽의 메세지
+        char rightMessage[100];
+        sprintf(rightMessage, "Enter = save | Esc = cancel");
+        mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), rightMessage);
+
+        for (int i = 0; i < windowSize->x - strlen(rightMessage); i++)
+        {
+            mvprintw(windowSize->y - 1, i, " ");
+        }
+        move(windowSize->y - 1, 0);
+
+        while (true)
+        { // 파일이름 받아오기
+            int ch = getch();
+            if (ch == ENTER)
+            { // 파일 이름으로 저장하기
+                saveFileAsFilename(newFilename);
+                break;
+            }
+            else if (ch == BACKSPACE || ch == KEY_BACKSPACE)
+            { // 파일 이름 backspace
+                for (int i = 0; i < index; i++)
+                {
+                    mvprintw(windowSize->y - 1, i, " ");
+                }
+                if (index > 0)
+                    index -= prevTextCharLength(newFilename, index);
+                newFilename[index] = '\0';
+                mvprintw(windowSize->y - 1, 0, newFilename);
+            }
+            else if (ch == ESC) {
+                print();
+                return;
+            }
+            else
+            { // 파일 이름 쓰기
+                newFilename[index] = ch;
+                mvprintw(windowSize->y - 1, 0, newFilename);
+                index++;
+            }
+        }
+
+    }
+    else
+    { // 기존에 있던 파일을 연 경우
+        if (fileInfo->isUpdated)
+        { // 변경사항이 있는 경우
+            saveFileAsFilename(fileInfo->filename);
+        }
+        else
+        {
+            for (int i = 0; i < windowSize->x; i++)
+            {
+                mvprintw(windowSize->y - 1, i, " ");
+            }
+            mvprintw(windowSize->y - 1, 0, "There are no changes to the file.");
+        }
+    }
+    fileInfo->isUpdated = false;
+    fileInfo->isFileSaving = false;
+    move(position->y, position->x);
+}
+
+void commonKey(int key)
+{
+    if (documentInfo->isWrapMode)
+    {
+        wrapCommonKey(key);
+        return;
+    }
+
+    int line = documentInfo->frameY + position->y;
+    bool isPlain = key < 0x80 && key != TAB && layoutIsPlainLine(line);
+    int column = position->x + documentInfo->frameX + 1;
+    insert(key);
+    lineChanged(line, 1);
+    if (!isPlain)
+    { // 여러 바이트짜리 글자는 마지막 바이트가 들어와야 칸 수가 정해지고, 탭은 뒤의 탭 위치를 바꿈
+        layoutMeasureLine(line, lineStartOf(position->current));
+        column = currentDisplayColumn(line);
+    }
+    scrollToDisplayColumn(column);
+    move(position->y, position->x);
+    print();
+}
+#endif
+
+double currentTimeMs(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+int detectCompression(FILE *file)
+{ // 확장자가 아닌 매직 바이트로 압축 형식을 판단함
+    unsigned char magic[4] = {0, 0, 0, 0};
+    size_t length = fread(magic, 1, 4, file);
+    rewind(file);
+
+    if (length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+        return COMPRESSION_GZIP;
+    if (length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+int readChunk(FileReader *reader, char *buffer)
+{ // 압축을 푼 데이터를 최대 READ_CHUNK_SIZE만큼 buffer에 채움, 에러인 경우 -1
+    if (reader->compression == COMPRESSION_GZIP)
+    {
+        int length = gzread(reader->gzFile, buffer, READ_CHUNK_SIZE);
+        int error = Z_OK;
+        if (length == 0)
+            gzerror(reader->gzFile, &error); // 잘린 파일은 gzread가 에러 없이 0을 돌려줌
+        return error == Z_OK ? length : -1;
+    }
+
+#ifdef HAVE_ZSTD
+    if (reader->compression == COMPRESSION_ZSTD)
+    {
+        ZSTD_outBuffer output = {buffer, READ_CHUNK_SIZE, 0};
+        while (output.pos < output.size)
+        {
+            if (reader->zstdInput.pos == reader->zstdInput.size)
+            {
+                reader->zstdInput.size = fread(reader->zstdInputData, 1, READ_CHUNK_SIZE, reader->file);
+                reader->zstdInput.pos = 0;
+                if (reader->zstdInput.size == 0)
+                    break;
+            }
+            reader->zstdRemaining = ZSTD_decompressStream(reader->zstdStream, &output, &reader->zstdInput);
+            if (ZSTD_isError(reader->zstdRemaining))
+                return -1;
+        }
+        if (output.pos == 0 && reader->zstdRemaining != 0)
+            return -1; // 파일이 프레임 중간에서 끝남
+        return (int)output.pos;
+    }
+#endif
+
+    return (int)fread(buffer, 1, READ_CHUNK_SIZE, reader->file);
+}
+
+void *decompressFile(void *arg)
+{ // 압축 해제 쓰레드: 비어있는 청크를 채워서 메인 쓰레드에 넘겨줌
+    FileReader *reader = (FileReader *)arg;
+    while (true)
+    {
+        pthread_mutex_lock(&reader->mutex);
+        while (reader->filledCount == READ_CHUNK_COUNT)
+            pthread_cond_wait(&reader->cond, &reader->mutex);
+        ReadChunk *chunk = &reader->chunks[reader->writeIndex];
+        pthread_mutex_unlock(&reader->mutex);
+
+        int length = readChunk(reader, chunk->data);
+
+        pthread_mutex_lock(&reader->mutex);
+        if (length <= 0)
+        {
+            reader->isDone = true;
+            reader->isFailed = length < 0;
+            pthread_cond_broadcast(&reader->cond);
+            pthread_mutex_unlock(&reader->mutex);
+            break;
+        }
+        chunk->length = length;
+        reader->writeIndex = (reader->writeIndex + 1) % READ_CHUNK_COUNT;
+        reader->filledCount++;
+        pthread_cond_broadcast(&reader->cond);
+        pthread_mutex_unlock(&reader->mutex);
+    }
+    return NULL;
+}
+
+FileReader *openFileReader(FILE *file, char *filename, int compression)
+{ // 압축 해제 쓰레드를 시작함, 시작하지 못하면 nextReadChunk가 바로 NULL을 돌려줌
+    FileReader *reader = (FileReader *)malloc(sizeof(FileReader));
+    reader->file = file;
+    reader->gzFile = NULL;
+    reader->compression = compression;
+    reader->readIndex = 0;
+    reader->writeIndex = 0;
+    reader->filledCount = 0;
+    reader->isDone = false;
+    reader->isFailed = false;
+    pthread_mutex_init(&reader->mutex, NULL);
+    pthread_cond_init(&reader->cond, NULL);
+
+    if (compression == COMPRESSION_GZIP)
+        reader->gzFile = gzopen(filename, "rb");
+#ifdef HAVE_ZSTD
+    if (compression == COMPRESSION_ZSTD)
+    {
+        reader->zstdStream = ZSTD_createDStream();
+        ZSTD_initDStream(reader->zstdStream);
+        reader->zstdInput.src = reader->zstdInputData;
+        reader->zstdInput.size = 0;
+        reader->zstdInput.pos = 0;
+        reader->zstdRemaining = 0;
+    }
+#else
+    if (compression == COMPRESSION_ZSTD)
+        reader->isFailed = true; // zstd 없이 빌드된 경우
+#endif
+
+    reader->isThreadStarted = false;
+    if (!reader->isFailed && (compression != COMPRESSION_GZIP || reader->gzFile != NULL))
+        reader->isThreadStarted = pthread_create(&reader->thread, NULL, decompressFile, reader) == 0;
+    return reader;
+}
+
+ReadChunk *nextReadChunk(FileReader *reader)
+{ // 압축 해제 쓰레드가 채운 다음 청크를 기다림, 파일이 끝나면 NULL
+    if (!reader->isThreadStarted)
+        return NULL;
+    pthread_mutex_lock(&reader->mutex);
+    while (reader->filledCount == 0 && !reader->isDone)
+        pthread_cond_wait(&reader->cond, &reader->mutex);
+    ReadChunk *chunk = reader->filledCount > 0 ? &reader->chunks[reader->readIndex] : NULL;
+    pthread_mutex_unlock(&reader->mutex);
+    return chunk;
+}
+
+void releaseReadChunk(FileReader *reader)
+{ // 다 쓴 청크를 압축 해제 쓰레드에 돌려줌
+    pthread_mutex_lock(&reader->mutex);
+    reader->readIndex = (reader->readIndex + 1) % READ_CHUNK_COUNT;
+    reader->filledCount--;
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->mutex);
+}
+
+bool closeFileReader(FileReader *reader)
+{ // 쓰레드를 기다리고 파일을 닫음, 끝까지 읽지 못했으면 true
+    if (reader->isThreadStarted)
+        pthread_join(reader->thread, NULL);
+    bool isFailed = reader->isFailed || !reader->isThreadStarted;
+
+    if (reader->gzFile != NULL)
+        gzclose(reader->gzFile);
+#ifdef HAVE_ZSTD
+    if (reader->compression == COMPRESSION_ZSTD)
+        ZSTD_freeDStream(reader->zstdStream);
+#endif
+    pthread_mutex_destroy(&reader->mutex);
+    pthread_cond_destroy(&reader->cond);
+    fclose(reader->file);
+    free(reader);
+    return isFailed;
+}
+
+void loadChunk(char *buffer, int length)
+{ // 읽어온 청크를 문서에 그대로 붙임 (commonKey, enter를 거치지 않음)
+    int textStart = 0; // 트라이그램 블록에 아직 넣지 않은 부분의 시작
+    // 세션 사이드카의 줄 색인을 채워둔 경우에는 줄 길이와 칸 수를 세지 않음
+    bool isRestored = sessionInfo->isRestored;
+    // 탭과 아스키가 아닌 바이트가 없는 청크는 디코딩하지 않고 바이트 수를 칸 수로 씀
+    bool isPlain = !isRestored && layoutInfo->decoder.length == 0 && isPlainText(buffer, length);
+    for (int i = 0; i < length; i++)
+    {
+        insert((unsigned char)buffer[i]);
+        if (buffer[i] == ENTER)
+        {
+            int line = documentInfo->lineCount - 1;
+            if (trigramInfo->isEnabled)
+            {
+                trigramAppendText(buffer + textStart, i + 1 - textStart);
+                textStart = i + 1;
+                // 사이드카가 파일과 맞지 않으면 줄 수가 모자랄 수 있음, 다 읽은 뒤에 다시 셈
+                trigramAppendLine(position->current, line < layoutInfo->lineCount ? layoutInfo->lineLengths[line] : 0);
+            }
+            if (!isRestored)
+            {
+                if (!isPlain)
+                    layoutInfo->lineWidths[line] += flushUtf8(&layoutInfo->decoder);
+                layoutAppendLine();
+            }
+            documentInfo->lineCount++;
+            if (documentInfo->lineCount == windowSize->y - 1)
+            { // 화면의 마지막 줄이 끝나는 위치
+                documentInfo->frameLastNode = position->current;
+            }
+            // 되살릴 화면 위치의 줄 시작 노드를 읽으면서 찾아둠
+            if (line + 1 == sessionInfo->frameY)
+                sessionInfo->frameStart = position->current;
+            if (line + 1 == sessionInfo->cursorLine)
+                sessionInfo->cursorStart = position->current;
+        }
+        else if (isRestored)
+            continue;
+        else if (isPlain)
+        {
+            layoutInfo->lineLengths[layoutInfo->lineCount - 1]++;
+            layoutInfo->lineWidths[layoutInfo->lineCount - 1]++;
+        }
+        else
+        {
+            int line = layoutInfo->lineCount - 1;
+            layoutInfo->lineLengths[line]++;
+            layoutInfo->lineWidths[line] += feedUtf8(&layoutInfo->decoder, buffer[i], layoutInfo->lineWidths[line]);
+            if ((unsigned char)buffer[i] >= 0x80 || buffer[i] == TAB)
+                layoutInfo->columnMaps[line] = &unmeasuredColumnMap;
+        }
+    }
+    if (trigramInfo->isEnabled)
+        trigramAppendText(buffer + textStart, length - textStart);
+}
+
+FILE *openTextFile(char *filename, int *compression)
+{ // 문서의 파일 이름과 확장자를 정하고 파일을 엶, 없는 파일이면 NULL
+    fileInfo->isNewFile = false;
+    fileInfo->filename = filename;
+
+    FILE *pFile = fopen(filename, "rb");
+    *compression = pFile ? detectCompression(pFile) : COMPRESSION_NONE;
+
+    // 파일의 확장자 가져오기 (압축 확장자는 건너뜀)
+    char *dot = strrchr(filename, '.');
+    if (dot && *compression != COMPRESSION_NONE && compressionFromFilename(filename) == *compression)
+    {
+        char *end = dot;
+        for (dot = end - 1; dot > filename && *dot != '.'; dot--)
+            ;
+        if (*dot == '.')
+        { // 파일 이름 중간이라 끝에 '\0'이 없으므로 복사해둠
+            snprintf(fileInfo->innerFiletype, sizeof(fileInfo->innerFiletype), "%.*s", (int)(end - dot - 1), dot + 1);
+            fileInfo->filetype = fileInfo->innerFiletype;
+        }
+        else
+            fileInfo->filetype = "no ft";
+    }
+    else if (dot)
+        fileInfo->filetype = dot + 1;
+    syntaxInfo->type = syntaxTypeFromFiletype(fileInfo->filetype);
+    return pFile;
+}
+
+bool loadText(FILE *pFile, char *filename, int compression, long long *totalBytes, double *elapsed)
+{ // 열린 파일을 (압축을 풀면서) 문서로 읽고 파일을 닫음, 화면은 그리지 않음, 끝까지 읽지 못했으면 true
+    fileInfo->isFileReading = true;
+    startSession(filename);
+    startTrigramIndex(filename);
+
+    double startTime = currentTimeMs();
+    *totalBytes = 0;
+
+    FileReader *reader = openFileReader(pFile, filename, compression);
+    ReadChunk *chunk;
+    while ((chunk = nextReadChunk(reader)) != NULL)
+    { // 압축 해제와 문서 만들기를 동시에 진행함
+        loadChunk(chunk->data, chunk->length);
+        *totalBytes += chunk->length;
+        releaseReadChunk(reader);
+    }
+    *elapsed = currentTimeMs() - startTime;
+    bool isFailed = closeFileReader(reader);
+
+    fileInfo->compression = compression;
+    resetDirtyLines();
+    if (isFailed)
+    { // 다 읽지 못한 파일을 덮어쓰지 않음
+        fileInfo->isReadOnly = true;
+        markLineResized(0);
+    }
+    layoutInfo->lineWidths[layoutInfo->lineCount - 1] += flushUtf8(&layoutInfo->decoder); // 파일이 글자 중간에서 끝난 경우
+    resetSyntaxStates();
+    finishTrigramIndex(filename);
+    position->x = 0;
+    position->y = 0;
+    documentInfo->frameX = 0;
+    documentInfo->frameY = 0;
+    position->current = head;
+    fileInfo->isFileReading = false;
+    restoreSession(isFailed);
+    return isFailed;
+}
+
+bool loadFile(char *filename)
+{ // 화면 없이 파일을 문서로 읽음 (라이브러리용, 바이너리 파일도 글로 읽음), 끝까지 읽었거나 없는 파일이면 true
+    int compression;
+    FILE *pFile = openTextFile(filename, &compression);
+    if (pFile == NULL)
+        return true; // 존재하지 않는 파일은 빈 문서로 시작함
+    long long totalBytes;
+    double elapsed;
+    return !loadText(pFile, filename, compression, &totalBytes, &elapsed);
+}
+
+#ifndef VITE_LIBRARY
+void readFile(char *filename)
+{
+    int compression;
+    FILE *pFile = openTextFile(filename, &compression);
+    if (pFile == NULL)
+    { // 존재하지 않는 파일은 빈 문서로 시작함
+        print();
+        return;
+    }
+    if (compression == COMPRESSION_NONE && (hexInfo->isForced || hasNulBytes(pFile)) && openHexView(pFile))
+        return; // 바이너리 파일은 줄로 나누지 않음
+
+    long long totalBytes;
+    double elapsed;
+    bool isFailed = loadText(pFile, filename, compression, &totalBytes, &elapsed);
+    move(0, 0);
+    print();
+
+    // 읽기 속도 출력 (압축된 파일과 그렇지 않은 파일을 비교하기 위함)
+    char *formats[] = {"plain", "gzip", "zstd"};
+    for (int i = 0; i < windowSize->x; i++)
+    {
+        mvprintw(windowSize->y - 1, i, " ");
+    }
+    if (isFailed)
+    {
+        mvprintw(windowSize->y - 1, 0, "Cannot read %s file completely. (%lld bytes)", formats[compression], totalBytes);
+    }
+    else
+    {
+        mvprintw(windowSize->y - 1, 0, "Read %lld bytes (%s) in %.1f ms, %.1f MB/s%s%s%s",
+                 totalBytes, formats[compression], elapsed,
+                 elapsed > 0 ? totalBytes / 1048576.0 / (elapsed / 1000.0) : 0.0,
+                 !trigramInfo->isEnabled ? "" : trigramInfo->isFromSidecar ? " | index loaded" : " | indexing",
+                 sessionInfo->frameY < 0 ? "" : " | session restored",
+                 hasNewerAutosave(filename) ? " | unsaved edits in autosave" : "");
+    }
+    move(position->y, position->x);
+}
+
+bool hasNulBytes(FILE *file)
+{ // 파일 앞부분에 NUL 바이트가 있으면 바이너리 파일로 봄
+    char buffer[HEX_DETECT_SIZE];
+    int length = fread(buffer, 1, sizeof(buffer), file);
+    rewind(file);
+    return memchr(buffer, 0, length) != NULL;
+}
+
+bool openHexView(FILE *file)
+{ // 파일을 읽지 않고 mmap만 함, 화면에 그리는 페이지만 커널이 읽어옴
+#ifdef WINDOWS
+    return false;
+#else
+    struct stat fileStat;
+    if (fstat(fileno(file), &fileStat) != 0 || fileStat.st_size == 0)
+        return false; // 빈 파일은 mmap할 수 없으므로 글 문서로 엶
+    void *data = mmap(NULL, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(file), 0);
+    if (data == MAP_FAILED)
+        return false;
+    fclose(file); // 매핑은 파일을 닫아도 남음
+    hexInfo->isEnabled = true;
+    hexInfo->data = (unsigned char *)data;
+    hexInfo->size = fileStat.st_size;
+    hexInfo->top = 0;
+    hexInfo->cursor = 0;
+    syntaxInfo->type = SYNTAX_NONE;
+    print();
+
+    char message[100];
+    sprintf(message, "Opened as binary. (%lld bytes) Tab = hex/ascii column", hexInfo->size);
+    printMessage(message);
+    moveHexCursor();
+    return true;
+#endif
+}
+
+int hexColumn(int index, bool isAscii)
+{ // 줄에서 index번째 바이트가 그려지는 칸, 오프셋 칸의 너비는 파일 크기에 맞춤
+    int digits = 8;
+    while (digits < 16 && ((hexInfo->size - 1) >> (digits * 4)) != 0)
+        digits++;
+    if (isAscii)
+        return digits + 2 + HEX_ROW_BYTES * 3 + 2 + index;
+    return digits + 2 + index * 3 + (index >= HEX_ROW_BYTES / 2); // 8바이트마다 한 칸 더 띄움
+}
+
+void printHex(void)
+{ // 화면에 보이는 줄의 바이트만 읽어서 오프셋 | 16진수 | 아스키 칸으로 그림
+    int height = windowSize->y - 2;
+    long long page = (long long)height * HEX_ROW_BYTES;
+    long long cursorRow = hexInfo->cursor - hexInfo->cursor % HEX_ROW_BYTES;
+    if (cursorRow < hexInfo->top)
+        hexInfo->top = cursorRow;
+    else if (cursorRow >= hexInfo->top + page)
+        hexInfo->top = cursorRow - page + HEX_ROW_BYTES;
+    clear();
+
+    for (int row = 0; row < height; row++)
+    {
+        long long offset = hexInfo->top + (long long)row * HEX_ROW_BYTES;
+        if (offset >= hexInfo->size)
+        {
+            mvprintw(row, 0, "~");
+            continue;
+        }
+        mvprintw(row, 0, "%08llx", offset);
+        for (int i = 0; i < HEX_ROW_BYTES && offset + i < hexInfo->size; i++)
+        {
+            unsigned char byte = hexInfo->data[offset + i];
+            // 커서가 없는 칸에서도 커서의 바이트를 칠해서 두 칸을 맞춰 볼 수 있게 함
+            int color = offset + i == hexInfo->cursor ? COLOR_PAIR(COLOR_HIGHLIGHT) : 0;
+            if (hexColumn(i, false) + 2 <= windowSize->x)
+            {
+                attron(hexInfo->isAsciiColumn ? color : 0);
+                mvprintw(row, hexColumn(i, false), "%02x", byte);
+                attroff(COLOR_PAIR(COLOR_HIGHLIGHT));
+            }
+            if (hexColumn(i, true) < windowSize->x)
+                mvaddch(row, hexColumn(i, true), (byte >= ' ' && byte < 127 ? byte : '.') | (hexInfo->isAsciiColumn ? 0 : color));
+        }
+        if (hexColumn(-1, true) < windowSize->x)
+            mvaddch(row, hexColumn(-1, true), '|');
+        if (hexColumn(HEX_ROW_BYTES, true) < windowSize->x)
+            mvaddch(row, hexColumn(HEX_ROW_BYTES, true), '|');
+    }
+
+    attron(COLOR_PAIR(1));
+    char leftMessage[100];
+    char rightMessage[100];
+    sprintf(leftMessage, fileInfo->isUpdated ? "[* %s] - %lld bytes" : "[%s] - %lld bytes", fileInfo->filename, hexInfo->size);
+    if (bufferInfo != NULL && bufferInfo->count > 1)
+        sprintf(leftMessage + strlen(leftMessage), " (%d/%d)", bufferInfo->current + 1, bufferInfo->count);
+    sprintf(rightMessage, "%s | hex | 0x%llx", fileInfo->filetype, hexInfo->cursor);
+    mvprintw(windowSize->y - 2, 0, "%s", leftMessage);
+    mvprintw(windowSize->y - 2, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+    for (int i = strlen(leftMessage); i < windowSize->x - strlen(rightMessage); ++i)
+    {
+        mvaddch(windowSize->y - 2, i, ' ');
+    }
+    attroff(COLOR_PAIR(1));
+
+    mvprintw(windowSize->y - 1, 0, "HEX: Arrows move | 0-9 a-f overwrite | Tab = hex/ascii | Ctrl-G go to offset | Ctrl-Z undo | Ctrl-S save | Ctrl-Q quit | Ctrl-N buffers");
+    moveHexCursor();
+    renderInfo->lastFrameTime = currentTimeMs();
+}
+
+void moveHexCursor(void)
+{
+    int index = hexInfo->cursor % HEX_ROW_BYTES;
+    int column = hexInfo->isAsciiColumn ? hexColumn(index, true) : hexColumn(index, false) + hexInfo->isLowNibble;
+    move((hexInfo->cursor - hexInfo->top) / HEX_ROW_BYTES, column);
+}
+
+bool hexKey(int key)
+{ // 헥스 보기의 키를 처리함, 저장과 종료와 창 크기 변경, 버퍼 열기와 바꾸기는 false를 돌려줘서 원래대로 처리함
+    if (key == CTRL('s') || key == CTRL('q') || key == KEY_RESIZE || key == CTRL('e') || key == CTRL('n'))
+        return false;
+    long long page = (long long)(windowSize->y - 2) * HEX_ROW_BYTES;
+    long long cursor = hexInfo->cursor;
+
+    if (key == KEY_UP && cursor >= HEX_ROW_BYTES)
+        cursor -= HEX_ROW_BYTES;
+    else if (key == KEY_DOWN && cursor + HEX_ROW_BYTES < hexInfo->size)
+        cursor += HEX_ROW_BYTES;
+    else if (key == KEY_LEFT)
+        cursor--;
+    else if (key == KEY_RIGHT)
+        cursor++;
+    else if (key == KEY_HOME)
+        cursor -= cursor % HEX_ROW_BYTES;
+    else if (key == KEY_END)
+        cursor += HEX_ROW_BYTES - 1 - cursor % HEX_ROW_BYTES;
+    else if (key == KEY_PPAGE || key == KEY_NPAGE)
+    { // 화면과 커서를 함께 한 페이지 옮김
+        long long step = key == KEY_PPAGE ? -page : page;
+        long long lastRow = (hexInfo->size - 1) - (hexInfo->size - 1) % HEX_ROW_BYTES;
+        hexInfo->top += step;
+        if (hexInfo->top > lastRow)
+            hexInfo->top = lastRow;
+        if (hexInfo->top < 0)
+            hexInfo->top = 0;
+        cursor += step;
+    }
+    else if (key == TAB)
+    {
+        hexInfo->isAsciiColumn = !hexInfo->isAsciiColumn;
+        hexInfo->isLowNibble = false;
+    }
+    else if (key == CTRL('z'))
+    {
+        undoHexByte();
+        cursor = hexInfo->cursor;
+    }
+    else if (key == CTRL('g'))
+    { // 10진수나 0x로 시작하는 16진수 오프셋으로 이동
+        char offset[32] = "";
+        if (readPrompt("Go to offset: ", offset, sizeof(offset)) && offset[0] != '\0')
+        {
+            char *end;
+            long long value = strtoll(offset, &end, 0);
+            if (end != offset)
+                cursor = value;
+        }
+    }
+    else if (!hexInfo->isAsciiColumn && key <= UCHAR_MAX && isxdigit(key))
+    { // 윗자리, 아랫자리 순서로 덮어쓰고 아랫자리를 치면 다음 바이트로 넘어감
+        int digit = isdigit(key) ? key - '0' : tolower(key) - 'a' + 10;
+        unsigned char byte = hexInfo->data[cursor];
+        if (hexInfo->isLowNibble)
+            byte = (byte & 0xf0) | digit;
+        else
+            byte = (digit << 4) | (byte & 0x0f);
+        writeHexByte(cursor, byte, true);
+        if (hexInfo->isLowNibble)
+            cursor++;
+        hexInfo->isLowNibble = !hexInfo->isLowNibble;
+    }
+    else if (hexInfo->isAsciiColumn && key >= ' ' && key < 127)
+    {
+        writeHexByte(cursor, (unsigned char)key, true);
+        cursor++;
+    }
+
+    if (cursor != hexInfo->cursor)
+    {
+        if (cursor >= hexInfo->size)
+            cursor = hexInfo->size - 1;
+        if (cursor < 0)
+            cursor = 0;
+        if (cursor != hexInfo->cursor)
+            hexInfo->isLowNibble = false;
+        hexInfo->cursor = cursor;
+    }
+    print();
+    return true;
+}
+#endif
+
+void writeHexByte(long long offset, unsigned char byte, bool isRecorded)
+{ // 매핑의 바이트를 바꾸고 저장할 오프셋에 넣음, 직접 친 경우에는 되돌리기에도 넣음
+    if (isRecorded)
+    {
+        if (hexInfo->undoCount == hexInfo->undoCapacity)
+        {
+            hexInfo->undoCapacity *= 2;
+            hexInfo->undoOffsets = (long long *)realloc(hexInfo->undoOffsets, sizeof(long long) * hexInfo->undoCapacity);
+            hexInfo->undoBytes = (unsigned char *)realloc(hexInfo->undoBytes, hexInfo->undoCapacity);
+        }
+        hexInfo->undoOffsets[hexInfo->undoCount] = offset;
+        hexInfo->undoBytes[hexInfo->undoCount] = hexInfo->data[offset];
+        hexInfo->undoCount++;
+    }
+    if (hexInfo->dirtyCount == hexInfo->dirtyCapacity)
+    {
+        hexInfo->dirtyCapacity *= 2;
+        hexInfo->dirtyOffsets = (long long *)realloc(hexInfo->dirtyOffsets, sizeof(long long) * hexInfo->dirtyCapacity);
+    }
+    hexInfo->dirtyOffsets[hexInfo->dirtyCount++] = offset;
+    hexInfo->data[offset] = byte;
+    fileInfo->isUpdated = true;
+}
+
+void undoHexByte(void)
+{
+    if (hexInfo->undoCount == 0)
+        return;
+    hexInfo->undoCount--;
+    long long offset = hexInfo->undoOffsets[hexInfo->undoCount];
+    writeHexByte(offset, hexInfo->undoBytes[hexInfo->undoCount], false);
+    hexInfo->cursor = offset;
+    hexInfo->isLowNibble = false;
+}
+
+int compareOffsets(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return x < y ? -1 : x > y;
+}
+
+#ifndef VITE_LIBRARY
+void saveHexView(void)
+{ // 고친 오프셋을 정렬해서 이어지는 구간마다 pwrite함, 파일 크기는 바뀌지 않음
+#ifdef WINDOWS
+    printMessage("Cannot save binary file on this platform.");
+#else
+    int fd = open(fileInfo->filename, O_WRONLY);
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size != hexInfo->size)
+    { // 디스크의 파일 크기가 바뀌었으면 매핑과 맞지 않으므로 쓰지 않음
+        if (fd >= 0)
+            close(fd);
+        printMessage("Cannot save file. (changed on disk or not writable)");
+        moveHexCursor();
+        return;
+    }
+
+    qsort(hexInfo->dirtyOffsets, hexInfo->dirtyCount, sizeof(long long), compareOffsets);
+    long long writtenBytes = 0;
+    bool isFailed = false;
+    for (int i = 0; i < hexInfo->dirtyCount && !isFailed;)
+    {
+        long long start = hexInfo->dirtyOffsets[i];
+        long long end = start + 1;
+        while (i < hexInfo->dirtyCount && hexInfo->dirtyOffsets[i] <= end)
+        { // 같은 오프셋과 붙어있는 오프셋을 한 구간으로 합침
+            if (hexInfo->dirtyOffsets[i] + 1 > end)
+                end = hexInfo->dirtyOffsets[i] + 1;
+            i++;
+        }
+        if (pwrite(fd, hexInfo->data + start, end - start, start) != end - start)
+            isFailed = true;
+        writtenBytes += end - start;
+    }
+    if (close(fd) != 0)
+        isFailed = true;
+    if (isFailed)
+    {
+        printMessage("Cannot save file.");
+        moveHexCursor();
+        return;
+    }
+
+    hexInfo->dirtyCount = 0;
+    fileInfo->isUpdated = false;
+    print();
+    char message[200];
+    snprintf(message, sizeof(message), "Save %s in place successfully. (%lld bytes written)", fileInfo->filename, writtenBytes);
+    printMessage(message);
+    moveHexCursor();
+#endif
+}
+#endif
+
+char *sidecarPath(char *filename, char *suffix)
+{ // 사이드카는 같은 폴더의 숨긴 파일임, dir/name.log -> dir/.name.log.suffix
+    char *slash = strrchr(filename, '/');
+    int directoryLength = slash ? slash - filename + 1 : 0;
+    char *path = (char *)malloc(strlen(filename) + strlen(suffix) + 3);
+    sprintf(path, "%.*s.%s.%s", directoryLength, filename, filename + directoryLength, suffix);
+    return path;
+}
+
+bool writeFileAtomically(char *path, void (*write)(FILE *file, void *arg), void *arg, bool isSynced)
+{ // write로 임시 파일(path.tmp)에 다 쓴 뒤 이름을 바꿔서 반쯤 쓰인 파일이 남지 않게 함, isSynced면 디스크까지 내려씀
+    char *tempPath = (char *)malloc(strlen(path) + 5);
+    sprintf(tempPath, "%s.tmp", path);
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL)
+    {
+        free(tempPath);
+        return false;
+    }
+    write(file, arg);
+    bool isWritten = !ferror(file) && fflush(file) == 0;
+#ifndef WINDOWS
+    if (isWritten && isSynced)
+        isWritten = fsync(fileno(file)) == 0; // 끝난 뒤 전원이 나가도 남도록 함
+#endif
+    if (fclose(file) != 0)
+        isWritten = false;
+    if (isWritten)
+        isWritten = rename(tempPath, path) == 0;
+    if (!isWritten)
+        remove(tempPath);
+    free(tempPath);
+    return isWritten;
+}
+
+bool getFileStamp(char *filename, long long *fileSize, long long *fileTime)
+{ // 사이드카가 가리키는 파일이 바뀌었는지 크기와 수정 시간으로 확인함
+    struct stat fileStat;
+    if (stat(filename, &fileStat) != 0)
+        return false;
+    *fileSize = fileStat.st_size;
+    *fileTime = fileStat.st_mtime;
+    return true;
+}
+
+unsigned int trigramHash(unsigned int trigram)
+{
+    return (trigram * 2654435761u) >> (32 - TRIGRAM_HASH_BITS);
+}
+
+void hashTrigrams(char *text, int length, unsigned char *bits)
+{ // 줄바꿈이 들어간 트라이그램은 검색어에 나올 수 없으므로 넣지 않음, 대소문자 무시 검색에도 쓰도록 소문자로 해시함
+    unsigned int trigram = 0;
+    int count = 0; // 줄바꿈 이후로 읽은 글자 수
+    for (int i = 0; i < length; i++)
+    {
+        if (text[i] == ENTER)
+        {
+            count = 0;
+            continue;
+        }
+        trigram = ((trigram << 8) | foldCase((unsigned char)text[i])) & 0xFFFFFF;
+        if (++count >= 3)
+        {
+            unsigned int hash = trigramHash(trigram);
+            bits[hash >> 3] |= 1 << (hash & 7);
+        }
+    }
+}
+
+bool hasTrigrams(unsigned char *bits, char *word, int wordLength)
+{ // 단어의 트라이그램이 모두 비트맵에 있으면 블록에 단어가 있을 수도 있음
+    unsigned int trigram = 0;
+    for (int i = 0; i < wordLength; i++)
+    {
+        trigram = ((trigram << 8) | foldCase((unsigned char)word[i])) & 0xFFFFFF;
+        if (i < 2)
+            continue;
+        unsigned int hash = trigramHash(trigram);
+        if (!(bits[hash >> 3] & (1 << (hash & 7))))
+            return false;
+    }
+    return true;
+}
+
+TrigramBlock *nextTrigramCandidate(int *blockIndex, int *blockFirstLine, char *word, int wordLength)
+{ // 단어가 있을 수 있는 다음 블록을 찾음, blockFirstLine은 찾은 블록의 다음 블록의 첫 줄이 됨
+    while (*blockIndex < trigramInfo->blockCount)
+    {
+        TrigramBlock *block = trigramInfo->blocks[(*blockIndex)++];
+        *blockFirstLine += block->lineCount;
+        if (block->isDirty || !isTaskDone(&block->isIndexed) || hasTrigrams(block->bits, word, wordLength))
+            return block;
+    }
+    return NULL;
+}
+
+TrigramBlock *newTrigramBlock(Node *start)
+{
+    TrigramBlock *block = (TrigramBlock *)malloc(sizeof(TrigramBlock));
+    block->start = start;
+    block->lineCount = 0;
+    block->length = 0;
+    block->bits = (unsigned char *)calloc(TRIGRAM_BITS / 8, 1);
+    block->isIndexed = false;
+    block->isDirty = false;
+    block->text = NULL;
+    block->textLength = 0;
+    block->textCapacity = 0;
+    return block;
+}
+
+void addTrigramBlock(TrigramBlock *block)
+{
+    if (trigramInfo->blockCount == trigramInfo->capacity)
+    {
+        trigramInfo->capacity *= 2;
+        trigramInfo->blocks = (TrigramBlock **)realloc(trigramInfo->blocks, sizeof(TrigramBlock *) * trigramInfo->capacity);
+    }
+    trigramInfo->blocks[trigramInfo->blockCount++] = block;
+}
+
+void retireTrigramMemory(void *memory)
+{ // 사이드카를 쓰는 쓰레드가 아직 읽고 있을 수 있으므로 다 쓴 뒤에 해제함
+    if (isTrigramIndexBuilt())
+    {
+        free(memory);
+        return;
+    }
+    if (trigramInfo->retiredCount == trigramInfo->retiredCapacity)
+    {
+        trigramInfo->retiredCapacity *= 2;
+        trigramInfo->retired = (void **)realloc(trigramInfo->retired, sizeof(void *) * trigramInfo->retiredCapacity);
+    }
+    trigramInfo->retired[trigramInfo->retiredCount++] = memory;
+}
+
+bool isTrigramIndexBuilt(void)
+{
+    if (!isTaskDone(&trigramInfo->isBuilt))
+        return false;
+    for (int i = 0; i < trigramInfo->retiredCount; i++)
+        free(trigramInfo->retired[i]);
+    trigramInfo->retiredCount = 0;
+    return true;
+}
+
+void startTrigramIndex(char *filename)
+{ // 큰 파일을 읽기 전에 사이드카를 읽어보고, 없으면 읽으면서 블록마다 색인을 만듦
+    long long fileSize, fileTime;
+    if (!getFileStamp(filename, &fileSize, &fileTime) || fileSize < TRIGRAM_MIN_FILE_SIZE)
+        return;
+    trigramInfo->isEnabled = true;
+    trigramInfo->sidecarPath = sidecarPath(filename, "trigram");
+
+    if (readTrigramSidecar(trigramInfo->sidecarPath, fileSize, fileTime))
+    {
+        trigramInfo->isFromSidecar = true;
+        trigramInfo->loadingBlock = 0;
+        trigramInfo->loadingLines = 0;
+        trigramInfo->blocks[0]->start = head;
+        return;
+    }
+    TrigramBlock *block = newTrigramBlock(head);
+    block->textCapacity = TRIGRAM_BLOCK_SIZE * 2;
+    block->text = (char *)malloc(block->textCapacity);
+    addTrigramBlock(block);
+}
+
+void finishTrigramIndex(char *filename)
+{ // 파일을 다 읽은 뒤 마지막 블록을 색인하고 사이드카 저장을 쓰레드 풀에 맡김
+    if (!trigramInfo->isEnabled)
+        return;
+    TrigramBlock *last = trigramInfo->blocks[trigramInfo->blockCount - 1];
+    if (trigramInfo->isFromSidecar)
+    {
+        if (trigramInfo->loadingBlock != trigramInfo->blockCount - 1 || trigramInfo->loadingLines + 1 != last->lineCount)
+        { // 사이드카가 파일과 맞지 않으면 모든 블록을 다시 색인하게 함
+            trigramInfo->isFromSidecar = false;
+            trigramInfo->isBuilt = true;
+            rebuildLineCaches();
+            return;
+        }
+        trigramInfo->isBuilt = true;
+        return;
+    }
+    last->lineCount++; // 줄바꿈으로 끝나지 않는 마지막 줄
+    submitTask(runTrigramHash, last);
+
+    TrigramSidecar *sidecar = (TrigramSidecar *)malloc(sizeof(TrigramSidecar));
+    sidecar->path = strdup(trigramInfo->sidecarPath);
+    if (!getFileStamp(filename, &sidecar->fileSize, &sidecar->fileTime))
+        sidecar->fileSize = -1;
+    sidecar->blockCount = trigramInfo->blockCount;
+    sidecar->lineCounts = (int *)malloc(sizeof(int) * sidecar->blockCount);
+    sidecar->bits = (unsigned char **)malloc(sizeof(unsigned char *) * sidecar->blockCount);
+    sidecar->blocks = (TrigramBlock **)malloc(sizeof(TrigramBlock *) * sidecar->blockCount);
+    for (int i = 0; i < sidecar->blockCount; i++)
+    {
+        sidecar->lineCounts[i] = trigramInfo->blocks[i]->lineCount;
+        sidecar->bits[i] = trigramInfo->blocks[i]->bits;
+        sidecar->blocks[i] = trigramInfo->blocks[i];
+    }
+    sidecar->isBuilt = &trigramInfo->isBuilt;
+    submitTask(runTrigramSidecar, sidecar);
+}
+
+void trigramAppendText(char *text, int length)
+{ // 파일을 읽는 동안 현재 블록의 텍스트를 모아둠
+    TrigramBlock *block = trigramInfo->blocks[trigramInfo->blockCount - 1];
+    if (block->text == NULL)
+        return;
+    if (block->textLength + length > block->textCapacity)
+    {
+        block->textCapacity = (block->textLength + length) * 2;
+        block->text = (char *)realloc(block->text, block->textCapacity);
+    }
+    memcpy(block->text + block->textLength, text, length);
+    block->textLength += length;
+}
+
+void trigramAppendLine(Node *lineEnd, int lineLength)
+{ // 문서 끝에 줄바꿈으로 끝나는 줄이 추가됨, 블록이 충분히 커지면 다음 블록을 시작함
+    if (trigramInfo->isFromSidecar && fileInfo->isFileReading)
+    { // 사이드카에 저장된 줄 수대로 블록을 나눔
+        if (trigramInfo->loadingBlock >= trigramInfo->blockCount)
+            return;
+        TrigramBlock *block = trigramInfo->blocks[trigramInfo->loadingBlock];
+        if (++trigramInfo->loadingLines == block->lineCount && trigramInfo->loadingBlock + 1 < trigramInfo->blockCount)
+        {
+            trigramInfo->loadingBlock++;
+            trigramInfo->loadingLines = 0;
+            trigramInfo->blocks[trigramInfo->loadingBlock]->start = lineEnd;
+        }
+        return;
+    }
+
+    TrigramBlock *block = trigramInfo->blocks[trigramInfo->blockCount - 1];
+    block->lineCount++;
+    block->length += lineLength + 1;
+    if (block->length < TRIGRAM_BLOCK_SIZE)
+        return;
+
+    TrigramBlock *next = newTrigramBlock(lineEnd);
+    if (block->text != NULL)
+    {
+        submitTask(runTrigramHash, block);
+        next->textCapacity = TRIGRAM_BLOCK_SIZE * 2;
+        next->text = (char *)malloc(next->textCapacity);
+    }
+    else
+    { // 파일을 읽는 중이 아니면 텍스트가 없으므로 다음 검색에서 색인함
+        next->isIndexed = true;
+        next->isDirty = true;
+    }
+    addTrigramBlock(next);
+}
+
+void runTrigramHash(void *arg, int worker)
+{
+    TrigramBlock *block = (TrigramBlock *)arg;
+    hashTrigrams(block->text, block->textLength, block->bits);
+    free(block->text);
+    block->text = NULL;
+    markTaskDone(&block->isIndexed);
+}
+
+void runTrigramSidecar(void *arg, int worker)
+{ // 모든 블록의 색인이 끝나면 사이드카 파일로 저장함
+    TrigramSidecar *sidecar = (TrigramSidecar *)arg;
+    for (int i = 0; i < sidecar->blockCount; i++)
+        waitTask(&sidecar->blocks[i]->isIndexed);
+    if (sidecar->fileSize >= 0)
+        writeTrigramSidecar(sidecar);
+
+    bool *isBuilt = sidecar->isBuilt;
+    free(sidecar->path);
+    free(sidecar->lineCounts);
+    free(sidecar->bits);
+    free(sidecar->blocks);
+    free(sidecar);
+    markTaskDone(isBuilt);
+}
+
+bool writeTrigramSidecar(TrigramSidecar *sidecar)
+{
+    return writeFileAtomically(sidecar->path, writeTrigramContents, sidecar, false);
+}
+
+void writeTrigramContents(FILE *file, void *arg)
+{
+    TrigramSidecar *sidecar = (TrigramSidecar *)arg;
+    int bitCount = TRIGRAM_BITS;
+    fwrite(TRIGRAM_MAGIC, 1, 8, file);
+    fwrite(&sidecar->fileSize, sizeof(long long), 1, file);
+    fwrite(&sidecar->fileTime, sizeof(long long), 1, file);
+    fwrite(&bitCount, sizeof(int), 1, file);
+    fwrite(&sidecar->blockCount, sizeof(int), 1, file);
+    fwrite(sidecar->lineCounts, sizeof(int), sidecar->blockCount, file);
+    for (int i = 0; i < sidecar->blockCount; i++)
+        fwrite(sidecar->bits[i], 1, TRIGRAM_BITS / 8, file);
+}
+
+bool readTrigramSidecar(char *path, long long fileSize, long long fileTime)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    char magic[8];
+    long long savedSize, savedTime;
+    int bitCount, blockCount;
+    bool isValid = fread(magic, 1, 8, file) == 8 && memcmp(magic, TRIGRAM_MAGIC, 8) == 0 &&
+                   fread(&savedSize, sizeof(long long), 1, file) == 1 && savedSize == fileSize &&
+                   fread(&savedTime, sizeof(long long), 1, file) == 1 && savedTime == fileTime &&
+                   fread(&bitCount, sizeof(int), 1, file) == 1 && bitCount == TRIGRAM_BITS &&
+                   fread(&blockCount, sizeof(int), 1, file) == 1 && blockCount > 0;
+    if (!isValid)
+    {
+        fclose(file);
+        return false;
+    }
+
+    int *lineCounts = (int *)malloc(sizeof(int) * blockCount);
+    isValid = fread(lineCounts, sizeof(int), blockCount, file) == blockCount;
+    for (int i = 0; i < blockCount && isValid; i++)
+    {
+        TrigramBlock *block = newTrigramBlock(NULL);
+        block->lineCount = lineCounts[i];
+        block->isIndexed = true;
+        addTrigramBlock(block);
+        isValid = fread(block->bits, 1, TRIGRAM_BITS / 8, file) == TRIGRAM_BITS / 8;
+    }
+    free(lineCounts);
+    fclose(file);
+
+    if (!isValid)
+    {
+        for (int i = 0; i < trigramInfo->blockCount; i++)
+        {
+            free(trigramInfo->blocks[i]->bits);
+            free(trigramInfo->blocks[i]);
+        }
+        trigramInfo->blockCount = 0;
+    }
+    return isValid;
+}
+
+void resetTrigramBlocks(void)
+{ // 줄 캐시를 다시 만들 때 블록도 처음부터 나누고, 비트맵은 다음 검색에서 만듦
+    for (int i = 0; i < trigramInfo->blockCount; i++)
+    {
+        retireTrigramMemory(trigramInfo->blocks[i]->bits);
+        retireTrigramMemory(trigramInfo->blocks[i]);
+    }
+    trigramInfo->blockCount = 0;
+    TrigramBlock *block = newTrigramBlock(head);
+    block->isIndexed = true;
+    block->isDirty = true;
+    addTrigramBlock(block);
+}
+
+int trigramBlockOfLine(int line, int *firstLine)
+{
+    *firstLine = 0;
+    for (int i = 0; i < trigramInfo->blockCount - 1; i++)
+    {
+        if (line < *firstLine + trigramInfo->blocks[i]->lineCount)
+            return i;
+        *firstLine += trigramInfo->blocks[i]->lineCount;
+    }
+    return trigramInfo->blockCount - 1;
+}
+
+void trigramLineChanged(int line)
+{
+    if (!trigramInfo->isEnabled || fileInfo->isFileReading)
+        return;
+    int firstLine;
+    trigramInfo->blocks[trigramBlockOfLine(line, &firstLine)]->isDirty = true;
+}
+
+void trigramLineSplit(int line)
+{
+    if (!trigramInfo->isEnabled || fileInfo->isFileReading)
+        return;
+    int firstLine;
+    TrigramBlock *block = trigramInfo->blocks[trigramBlockOfLine(line, &firstLine)];
+    block->lineCount++;
+    block->isDirty = true;
+}
+
+void trigramLineJoined(int line)
+{
+    if (!trigramInfo->isEnabled || fileInfo->isFileReading)
+        return;
+    int firstLine;
+    int index = trigramBlockOfLine(line, &firstLine);
+    TrigramBlock *block = trigramInfo->blocks[index];
+    if (line == firstLine && index > 0)
+    { // 블록의 시작 노드가 지워졌으므로 앞 블록에 합침
+        TrigramBlock *prev = trigramInfo->blocks[index - 1];
+        prev->lineCount += block->lineCount - 1;
+        prev->isDirty = true;
+        retireTrigramMemory(block->bits);
+        retireTrigramMemory(block);
+        memmove(trigramInfo->blocks + index, trigramInfo->blocks + index + 1,
+                sizeof(TrigramBlock *) * (trigramInfo->blockCount - index - 1));
+        trigramInfo->blockCount--;
+        return;
+    }
+    block->lineCount--;
+    block->isDirty = true;
+}
+
+void refreshTrigramBlock(TrigramBlock *block)
+{ // 편집된 블록의 비트맵을 문서에서 다시 만듦
+    char buffer[READ_CHUNK_SIZE];
+    int length = 0;
+    int lines = 0;
+    memset(block->bits, 0, TRIGRAM_BITS / 8);
+    for (Node *p = block->start->next; p != tail; p = p->next)
+    {
+        buffer[length++] = (char)p->data;
+        if (p->data == ENTER && ++lines == block->lineCount)
+            break;
+        if (length == READ_CHUNK_SIZE)
+        { // 청크 경계에 걸친 트라이그램을 위해 마지막 두 글자를 남김
+            hashTrigrams(buffer, length, block->bits);
+            buffer[0] = buffer[length - 2];
+            buffer[1] = buffer[length - 1];
+            length = 2;
+        }
+    }
+    hashTrigrams(buffer, length, block->bits);
+    block->isDirty = false;
+}
+
+void saveTrigramSidecar(char *filename)
+{ // 저장한 파일을 다시 열 때 바로 쓸 수 있도록 색인을 새 파일 기준으로 다시 저장함
+    if (!trigramInfo->isEnabled || !isTrigramIndexBuilt())
+        return;
+    TrigramSidecar sidecar;
+    if (!getFileStamp(filename, &sidecar.fileSize, &sidecar.fileTime))
+        return;
+    free(trigramInfo->sidecarPath);
+    trigramInfo->sidecarPath = sidecarPath(filename, "trigram");
+
+    sidecar.path = trigramInfo->sidecarPath;
+    sidecar.blockCount = trigramInfo->blockCount;
+    sidecar.lineCounts = (int *)malloc(sizeof(int) * sidecar.blockCount);
+    sidecar.bits = (unsigned char **)malloc(sizeof(unsigned char *) * sidecar.blockCount);
+    sidecar.blocks = trigramInfo->blocks;
+    for (int i = 0; i < sidecar.blockCount; i++)
+    {
+        if (trigramInfo->blocks[i]->isDirty)
+            refreshTrigramBlock(trigramInfo->blocks[i]);
+        sidecar.lineCounts[i] = trigramInfo->blocks[i]->lineCount;
+        sidecar.bits[i] = trigramInfo->blocks[i]->bits;
+    }
+    writeTrigramSidecar(&sidecar);
+    free(sidecar.lineCounts);
+    free(sidecar.bits);
+}
+
+bool sampleFile(char *filename, long long fileSize, unsigned long long *sample)
+{ // 파일의 앞, 가운데, 끝에서 SESSION_SAMPLE_SIZE 바이트씩 읽어서 해시함
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+        return false;
+    char buffer[SESSION_SAMPLE_SIZE];
+    long long offsets[3] = {0, fileSize / 2, fileSize > SESSION_SAMPLE_SIZE ? fileSize - SESSION_SAMPLE_SIZE : 0};
+    unsigned long long hash = DIFF_HASH_START;
+    for (int i = 0; i < 3; i++)
+    {
+        if (fseeko(file, offsets[i], SEEK_SET) != 0)
+            break;
+        int length = fread(buffer, 1, sizeof(buffer), file);
+        for (int j = 0; j < length; j++)
+            hash = (hash ^ (unsigned char)buffer[j]) * DIFF_HASH_PRIME;
+    }
+    fclose(file);
+    *sample = hash;
+    return true;
+}
+
+void startSession(char *filename)
+{ // 큰 파일을 읽기 전에 세션 사이드카를 읽어봄
+    long long fileSize, fileTime;
+    unsigned long long sample;
+    if (sessionInfo->isSkipped || !getFileStamp(filename, &fileSize, &fileTime) || fileSize < SESSION_MIN_FILE_SIZE)
+        return;
+    sessionInfo->isEnabled = true;
+    sessionInfo->path = sidecarPath(filename, "session");
+    if (sampleFile(filename, fileSize, &sample))
+        readSessionSidecar(sessionInfo->path, fileSize, fileTime, sample);
+}
+
+bool readSessionSidecar(char *path, long long fileSize, long long fileTime, unsigned long long sample)
+{ // 최근 검색어는 항상 되살리고, 화면 위치와 줄 색인은 파일이 그대로일 때만 씀
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    char magic[8];
+    long long savedSize, savedTime;
+    unsigned long long savedSample;
+    int tabSize, wordCount, lineCount;
+    int view[4]; // frameY, frameX, 커서의 줄, 커서의 칸
+    bool isValid = fread(magic, 1, 8, file) == 8 && memcmp(magic, SESSION_MAGIC, 8) == 0 &&
+                   fread(&savedSize, sizeof(long long), 1, file) == 1 &&
+                   fread(&savedTime, sizeof(long long), 1, file) == 1 &&
+                   fread(&savedSample, sizeof(unsigned long long), 1, file) == 1 &&
+                   fread(&tabSize, sizeof(int), 1, file) == 1 &&
+                   fread(view, sizeof(int), 4, file) == 4 &&
+                   fread(&wordCount, sizeof(int), 1, file) == 1 && wordCount >= 0 && wordCount <= SEARCH_HISTORY_SIZE;
+    for (int i = 0; i < wordCount && isValid; i++)
+    {
+        int length;
+        isValid = fread(&length, sizeof(int), 1, file) == 1 && length > 0 && length < 100;
+        if (!isValid)
+            break;
+        char *word = (char *)malloc(length + 1);
+        isValid = fread(word, 1, length, file) == length;
+        word[length] = '\0';
+        searchInfo->recentWords[searchInfo->recentCount++] = word;
+    }
+    isValid = isValid && savedSize == fileSize && savedTime == fileTime && savedSample == sample &&
+              view[0] >= 0 && view[1] >= 0 && view[2] >= 0 && view[3] >= 0 &&
+              fread(&lineCount, sizeof(int), 1, file) == 1 && lineCount >= 0;
+    if (!isValid)
+    {
+        fclose(file);
+        return false;
+    }
+    sessionInfo->frameY = view[0];
+    sessionInfo->frameX = view[1];
+    sessionInfo->cursorLine = view[2];
+    sessionInfo->cursorColumn = view[3];
+    sessionInfo->frameStart = head;
+    sessionInfo->cursorStart = head;
+
+    if (lineCount > 0 && tabSize == layoutInfo->tabSize)
+    { // 줄 길이, 칸 수, 탭과 아스키가 아닌 글자가 없는 줄인지를 그대로 채움
+        if (layoutInfo->capacity < lineCount)
+        {
+            layoutInfo->capacity = lineCount;
+            layoutInfo->lineLengths = (int *)realloc(layoutInfo->lineLengths, sizeof(int) * layoutInfo->capacity);
+            layoutInfo->lineWidths = (int *)realloc(layoutInfo->lineWidths, sizeof(int) * layoutInfo->capacity);
+            layoutInfo->columnMaps = (ColumnMap **)realloc(layoutInfo->columnMaps, sizeof(ColumnMap *) * layoutInfo->capacity);
+        }
+        unsigned char *plains = (unsigned char *)malloc(lineCount);
+        if (fread(layoutInfo->lineLengths, sizeof(int), lineCount, file) == lineCount &&
+            fread(layoutInfo->lineWidths, sizeof(int), lineCount, file) == lineCount &&
+            fread(plains, 1, lineCount, file) == lineCount)
+        {
+            for (int i = 0; i < lineCount; i++)
+                layoutInfo->columnMaps[i] = plains[i] ? NULL : &unmeasuredColumnMap;
+            layoutInfo->lineCount = lineCount;
+            layoutInfo->isRowTreeDirty = true;
+            sessionInfo->isRestored = true;
+        }
+        else
+        { // 빈 문서의 줄 하나로 되돌림
+            layoutInfo->lineLengths[0] = 0;
+            layoutInfo->lineWidths[0] = 0;
+            layoutInfo->columnMaps[0] = NULL;
+        }
+        free(plains);
+    }
+    fclose(file);
+    return true;
+}
+
+void restoreSession(bool isFailed)
+{ // 다 읽은 뒤 채워둔 줄 색인이 파일과 맞는지 확인하고, 저장된 화면 위치로 옮김
+    if (sessionInfo->isRestored)
+    {
+        sessionInfo->isRestored = false;
+        if (isFailed || layoutInfo->lineCount != documentInfo->lineCount)
+            rebuildLineCaches();
+    }
+    if (sessionInfo->frameY < 0)
+        return;
+    if (sessionInfo->frameY >= documentInfo->lineCount || sessionInfo->cursorLine >= documentInfo->lineCount)
+    {
+        sessionInfo->frameY = -1;
+        return;
+    }
+    documentInfo->frameFirstNode = sessionInfo->frameStart;
+    documentInfo->frameY = sessionInfo->frameY;
+    documentInfo->frameX = sessionInfo->frameX;
+    int column = sessionInfo->cursorColumn;
+    if (column > layoutInfo->lineLengths[sessionInfo->cursorLine])
+        column = layoutInfo->lineLengths[sessionInfo->cursorLine];
+    moveCursorToLine(sessionInfo->cursorLine, sessionInfo->cursorStart, column);
+}
+
+void saveSession(void)
+{ // 끝낼 때 화면 위치와 최근 검색어를 쓰고, 문서가 디스크의 파일과 같으면 줄 색인도 씀
+    long long fileSize, fileTime;
+    unsigned long long sample;
+    if (!sessionInfo->isEnabled || hexInfo->isEnabled || !getFileStamp(fileInfo->filename, &fileSize, &fileTime) ||
+        !sampleFile(fileInfo->filename, fileSize, &sample))
+        return;
+    SessionStamp stamp = {fileSize, fileTime, sample};
+    writeFileAtomically(sessionInfo->path, writeSessionContents, &stamp, false);
+}
+
+void writeSessionContents(FILE *file, void *arg)
+{
+    SessionStamp *stamp = (SessionStamp *)arg;
+    int view[4] = {documentInfo->frameY, documentInfo->isWrapMode ? 0 : documentInfo->frameX, currentLineIndex(), currentColumn()};
+    int lineCount = fileInfo->isUpdated ? 0 : layoutInfo->lineCount; // 저장하지 않은 편집이 있으면 줄 색인이 디스크의 파일과 다름
+    fwrite(SESSION_MAGIC, 1, 8, file);
+    fwrite(&stamp->fileSize, sizeof(long long), 1, file);
+    fwrite(&stamp->fileTime, sizeof(long long), 1, file);
+    fwrite(&stamp->sample, sizeof(unsigned long long), 1, file);
+    fwrite(&layoutInfo->tabSize, sizeof(int), 1, file);
+    fwrite(view, sizeof(int), 4, file);
+    fwrite(&searchInfo->recentCount, sizeof(int), 1, file);
+    for (int i = 0; i < searchInfo->recentCount; i++)
+    {
+        int length = strlen(searchInfo->recentWords[i]);
+        fwrite(&length, sizeof(int), 1, file);
+        fwrite(searchInfo->recentWords[i], 1, length, file);
+    }
+    fwrite(&lineCount, sizeof(int), 1, file);
+    fwrite(layoutInfo->lineLengths, sizeof(int), lineCount, file);
+    fwrite(layoutInfo->lineWidths, sizeof(int), lineCount, file);
+    unsigned char *plains = (unsigned char *)malloc(lineCount + 1);
+    for (int i = 0; i < lineCount; i++)
+        plains[i] = layoutInfo->columnMaps[i] == NULL;
+    fwrite(plains, 1, lineCount, file);
+    free(plains);
+}
+
+void addRecentWord(char *word)
+{ // 같은 검색어는 맨 앞으로 옮기고, 가득 차면 가장 오래된 것을 버림
+    int index = 0;
+    while (index < searchInfo->recentCount && strcmp(searchInfo->recentWords[index], word) != 0)
+        index++;
+    char *recent;
+    if (index < searchInfo->recentCount)
+        recent = searchInfo->recentWords[index];
+    else
+    {
+        recent = strdup(word);
+        if (searchInfo->recentCount < SEARCH_HISTORY_SIZE)
+            searchInfo->recentCount++;
+        else
+            free(searchInfo->recentWords[SEARCH_HISTORY_SIZE - 1]);
+        index = searchInfo->recentCount - 1;
+    }
+    memmove(searchInfo->recentWords + 1, searchInfo->recentWords, sizeof(char *) * index);
+    searchInfo->recentWords[0] = recent;
+}
+
+bool hasNewerAutosave(char *filename)
+{ // 저장하지 않고 끝난 편집이 남아있는지 알려주기 위해 봄
+    char *path = sidecarPath(filename, "autosave");
+    long long fileSize, fileTime, autosaveSize, autosaveTime;
+    bool isNewer = getFileStamp(path, &autosaveSize, &autosaveTime) && getFileStamp(filename, &fileSize, &fileTime) &&
+                   autosaveTime >= fileTime;
+    free(path);
+    return isNewer;
+}
+
+void noteEdit(void)
+{ // 문서를 바꾸는 곳(beforeEdit, applyEdits)에서 부름, 복사 중인 스냅숏은 다음 틱에 버려짐
+    autosaveInfo->editCount++;
+    autosaveInfo->lastEditTime = currentTimeMs();
+}
+
+int autosaveTimeout(void)
+{ // 메인 루프의 getch가 기다릴 시간, 자동 저장할 것이 없으면 -1
+    if (autosaveInfo->idleMs == 0 || fileInfo->isNewFile || fileInfo->isReadOnly || hexInfo->isEnabled)
+        return -1;
+    if (autosaveInfo->text != NULL)
+        return 0; // 복사 중이면 키가 없을 때마다 조금씩 복사함
+    if (autosaveInfo->job != NULL)
+        return AUTOSAVE_POLL_MS;
+    if (autosaveInfo->editCount == autosaveInfo->savedCount)
+        return -1;
+    double delay = autosaveInfo->cost * AUTOSAVE_BACKOFF < AUTOSAVE_MAX_DELAY_MS ? autosaveInfo->cost * AUTOSAVE_BACKOFF
+                                                                                   : AUTOSAVE_MAX_DELAY_MS;
+    double due = autosaveInfo->lastSaveTime + delay;
+    if (autosaveInfo->isInterrupted || autosaveInfo->editCount - autosaveInfo->savedCount < autosaveInfo->editLimit)
+    { // 편집이 많이 쌓였으면 입력이 잠깐 비는 사이에도 씀
+        double idle = autosaveInfo->lastEditTime + autosaveInfo->idleMs;
+        if (idle > due)
+            due = idle;
+    }
+    double now = currentTimeMs();
+    return due <= now ? 0 : (int)(due - now) + 1;
+}
+
+#ifndef VITE_LIBRARY
+void autosaveTick(void)
+{ // 메인 루프의 getch가 키 없이 돌아오면 부름, 스냅숏을 한 조각 복사하거나 끝난 쓰기를 정리함
+    if (autosaveInfo->job != NULL && isTaskDone(&autosaveInfo->job->isDone) && finishAutosaveJob(false))
+    {
+        char message[300];
+        snprintf(message, sizeof(message), "Cannot autosave to %.250s.", autosaveInfo->path);
+        printMessage(message);
+    }
+    if (autosaveInfo->text != NULL && autosaveInfo->snapshotCount != autosaveInfo->editCount)
+    { // 복사하는 동안 문서가 바뀌었으므로 버리고, 입력이 멈출 때 처음부터 다시 복사함
+        free(autosaveInfo->text);
+        autosaveInfo->text = NULL;
+        autosaveInfo->isInterrupted = true;
+    }
+    if (autosaveInfo->text == NULL)
+    {
+        if (autosaveInfo->job != NULL || autosaveTimeout() != 0 || isMemoryLow())
+            return;
+        if (autosaveInfo->path == NULL)
+            autosaveInfo->path = sidecarPath(fileInfo->filename, "autosave"); // 새 파일은 처음 저장한 뒤에 정해짐
+        autosaveInfo->capacity = fileInfo->diskSize > 0 ? fileInfo->diskSize + AUTOSAVE_SLICE_SIZE : AUTOSAVE_SLICE_SIZE;
+        autosaveInfo->text = (char *)malloc(autosaveInfo->capacity);
+        autosaveInfo->length = 0;
+        autosaveInfo->next = head->next;
+        autosaveInfo->snapshotCount = autosaveInfo->editCount;
+        autosaveInfo->copyTime = 0;
+        autosaveInfo->lastSaveTime = currentTimeMs();
+    }
+    copyAutosaveSlice();
+}
+#endif
+
+void copyAutosaveSlice(void)
+{ // AUTOSAVE_SLICE_SIZE만큼 복사하고 돌아가서 키 입력을 먼저 처리함, 다 복사했으면 쓰레드 풀에 쓰기를 넘김
+    double startTime = currentTimeMs();
+    if (autosaveInfo->length + AUTOSAVE_SLICE_SIZE > autosaveInfo->capacity)
+    {
+        autosaveInfo->capacity *= 2;
+        autosaveInfo->text = (char *)realloc(autosaveInfo->text, autosaveInfo->capacity);
+    }
+    char *text = autosaveInfo->text + autosaveInfo->length;
+    Node *p = autosaveInfo->next;
+    int length = 0;
+    while (p != tail && length < AUTOSAVE_SLICE_SIZE)
+    {
+        text[length++] = (char)p->data;
+        p = p->next;
+    }
+    autosaveInfo->length += length;
+    autosaveInfo->next = p;
+    autosaveInfo->copyTime += currentTimeMs() - startTime;
+    if (p != tail)
+        return;
+
+    AutosaveJob *job = (AutosaveJob *)malloc(sizeof(AutosaveJob));
+    job->path = autosaveInfo->path;
+    job->text = autosaveInfo->text;
+    job->length = autosaveInfo->length;
+    job->isFailed = false;
+    job->isDone = false;
+    autosaveInfo->job = job;
+    autosaveInfo->text = NULL;
+    autosaveInfo->savedCount = autosaveInfo->snapshotCount;
+    autosaveInfo->isInterrupted = false;
+    submitTask(runAutosaveJob, job);
+}
+
+void runAutosaveJob(void *arg, int worker)
+{ // 자동 저장은 끝난 뒤 전원이 나가도 남아야 하므로 디스크까지 내려씀
+    AutosaveJob *job = (AutosaveJob *)arg;
+    double startTime = currentTimeMs();
+    job->isFailed = !writeFileAtomically(job->path, writeAutosaveContents, job, true);
+    free(job->text);
+    job->text = NULL;
+    job->elapsed = currentTimeMs() - startTime;
+    markTaskDone(&job->isDone);
+}
+
+void writeAutosaveContents(FILE *file, void *arg)
+{
+    AutosaveJob *job = (AutosaveJob *)arg;
+    fwrite(job->text, 1, job->length, file);
+}
+
+bool finishAutosaveJob(bool isWaiting)
+{ // 걸린 시간을 다음 자동 저장의 간격에 반영함, 쓰지 못했으면 true
+    AutosaveJob *job = autosaveInfo->job;
+    if (job == NULL)
+        return false;
+    if (isWaiting)
+        waitTask(&job->isDone);
+    autosaveInfo->cost = autosaveInfo->copyTime + job->elapsed;
+    autosaveInfo->job = NULL;
+    bool isFailed = job->isFailed;
+    free(job);
+    return isFailed;
+}
+
+void discardAutosave(void)
+{ // 저장했으면 사이드카는 필요 없음, 쓰는 중이면 끝나길 기다린 뒤 지움
+    finishAutosaveJob(true);
+    if (autosaveInfo->text != NULL)
+    {
+        free(autosaveInfo->text);
+        autosaveInfo->text = NULL;
+    }
+    autosaveInfo->savedCount = autosaveInfo->editCount;
+    autosaveInfo->isInterrupted = false;
+    if (autosaveInfo->path == NULL)
+        autosaveInfo->path = sidecarPath(fileInfo->filename, "autosave"); // 지난번에 저장하지 않고 끝낸 사이드카도 지움
+    remove(autosaveInfo->path);
+}
+
+#ifndef VITE_LIBRARY
+void diffView(void)
+{ // 처음 부르면 디스크의 파일과 비교해서 표시를 켜고, 바뀐 부분들 사이를 화살표로 옮겨 다님
+    char message[200];
+    double elapsed = -1;
+    if (!diffInfo->isEnabled)
+    {
+        if (fileInfo->isNewFile)
+        {
+            printMessage("No file on disk to compare.");
+            return;
+        }
+        double startTime = currentTimeMs();
+        if (!readDiskHashes(fileInfo->filename))
+        {
+            printMessage("Cannot read file on disk.");
+            return;
+        }
+        diffInfo->isEnabled = true;
+        runDiff(bufferHashes());
+        elapsed = currentTimeMs() - startTime;
+    }
+
+    DiffHunk *hunks;
+    int hunkCount = collectDiffHunks(&hunks);
+    if (hunkCount == 0)
+    {
+        print();
+        if (elapsed >= 0)
+            sprintf(message, "No changes against disk. (%d lines compared in %.1f ms)", documentInfo->lineCount, elapsed);
+        else
+            sprintf(message, "No changes against disk.");
+        printMessage(message);
+        free(hunks);
+        return;
+    }
+
+    int index = 0; // 커서가 있는 줄부터 보여줌
+    while (index < hunkCount - 1 && hunks[index].line + hunks[index].lineCount <= currentLineIndex())
+        index++;
+    while (true)
+    {
+        DiffHunk *hunk = &hunks[index];
+        int line = hunk->line < documentInfo->lineCount ? hunk->line : documentInfo->lineCount - 1;
+        moveCursorTo(line, 0);
+        print();
+        for (int i = 0; i < windowSize->x; i++)
+            mvaddch(windowSize->y - 1, i, ' ');
+        // unified diff처럼 줄이 없는 쪽은 바로 앞 줄 번호를 씀
+        sprintf(message, "[%d/%d] @@ -%d,%d +%d,%d @@", index + 1, hunkCount,
+                hunk->diskLine + (hunk->diskCount > 0), hunk->diskCount, hunk->line + (hunk->lineCount > 0), hunk->lineCount);
+        if (elapsed >= 0)
+            sprintf(message + strlen(message), " (%.1f ms)", elapsed);
+        char rightMessage[] = "Arrows = prev/next change | H = hide markers | Esc = done";
+        mvprintw(windowSize->y - 1, 0, "%s", message);
+        mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+        move(position->y, position->x);
+
+        int ch = getch();
+        if ((ch == KEY_UP || ch == KEY_LEFT) && index > 0)
+            index--;
+        else if ((ch == KEY_DOWN || ch == KEY_RIGHT) && index < hunkCount - 1)
+            index++;
+        else if (ch == 'h' || ch == 'H' || ch == CTRL('d'))
+        { // 표시를 끄고 비교 결과를 버림, 다음에 다시 디스크에서 읽음
+            diffInfo->isEnabled = false;
+            break;
+        }
+        else if (ch == ESC || ch == ENTER)
+            break;
+    }
+    free(hunks);
+    print();
+}
+#endif
+
+bool readDiskHashes(char *filename)
+{ // 디스크의 파일을 청크로 읽으면서(압축된 파일은 풀면서) 줄마다 해시를 구함, 내용은 남겨두지 않음
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+        return false;
+    FileReader *reader = openFileReader(file, filename, detectCompression(file));
+    if (diffInfo->diskCapacity == 0)
+    {
+        diffInfo->diskCapacity = 1024;
+        diffInfo->diskHashes = (unsigned long long *)malloc(sizeof(unsigned long long) * diffInfo->diskCapacity);
+    }
+    diffInfo->diskCount = 0;
+    unsigned long long hash = DIFF_HASH_START;
+    ReadChunk *chunk;
+    while ((chunk = nextReadChunk(reader)) != NULL)
+    {
+        for (int i = 0; i < chunk->length; i++)
+        {
+            unsigned char ch = (unsigned char)chunk->data[i];
+            if (ch != ENTER)
+            {
+                hash = (hash ^ ch) * DIFF_HASH_PRIME;
+                continue;
+            }
+            if (diffInfo->diskCount + 1 >= diffInfo->diskCapacity)
+            {
+                diffInfo->diskCapacity *= 2;
+                diffInfo->diskHashes = (unsigned long long *)realloc(diffInfo->diskHashes, sizeof(unsigned long long) * diffInfo->diskCapacity);
+            }
+            diffInfo->diskHashes[diffInfo->diskCount++] = hash;
+            hash = DIFF_HASH_START;
+        }
+        releaseReadChunk(reader);
+    }
+    diffInfo->diskHashes[diffInfo->diskCount++] = hash; // 마지막 줄 (줄바꿈으로 끝나면 빈 줄)
+    return !closeFileReader(reader);
+}
+
+unsigned long long hashLine(Node *lineStart, Node **lineEnd)
+{ // lineStart 다음부터 줄 끝까지의 해시, lineEnd에는 줄 끝의 줄바꿈(또는 tail)을 넣음
+    unsigned long long hash = DIFF_HASH_START;
+    Node *p = lineStart->next;
+    for (; p != tail && p->data != ENTER; p = p->next)
+        hash = (hash ^ p->data) * DIFF_HASH_PRIME;
+    if (lineEnd != NULL)
+        *lineEnd = p;
+    return hash;
+}
+
+unsigned long long *bufferHashes(void)
+{ // 문서를 한 번 따라가면서 모든 줄의 해시를 구함
+    unsigned long long *hashes = (unsigned long long *)malloc(sizeof(unsigned long long) * documentInfo->lineCount);
+    Node *p = head;
+    for (int line = 0; line < documentInfo->lineCount; line++)
+        hashes[line] = hashLine(p, &p);
+    return hashes;
+}
+
+void ensureDiffCapacity(int lineCount)
+{
+    if (lineCount <= diffInfo->capacity)
+        return;
+    while (diffInfo->capacity < lineCount)
+        diffInfo->capacity = diffInfo->capacity == 0 ? 1024 : diffInfo->capacity * 2;
+    diffInfo->diskLines = (int *)realloc(diffInfo->diskLines, sizeof(int) * diffInfo->capacity);
+    diffInfo->lineStates = (unsigned char *)realloc(diffInfo->lineStates, diffInfo->capacity);
+}
+
+void runDiff(unsigned long long *hashes)
+{ // 디스크와 버퍼의 줄 해시(hashes, 여기서 해제함)를 비교하고, 바뀐 구간마다 앞쪽 줄들을 지워진 디스크의 줄과 짝지음
+    int lineCount = documentInfo->lineCount;
+    int diskCount = diffInfo->diskCount;
+    DiffRun run;
+    run.a = diffInfo->diskHashes;
+    run.b = hashes;
+    run.matches = (int *)malloc(sizeof(int) * lineCount);
+    for (int i = 0; i < lineCount; i++)
+        run.matches[i] = -1;
+    run.forward = (int *)malloc(sizeof(int) * (2 * DIFF_MAX_COST + 5));
+    run.backward = (int *)malloc(sizeof(int) * (2 * DIFF_MAX_COST + 5));
+    diffRange(&run, 0, 0, diskCount, lineCount);
+
+    ensureDiffCapacity(lineCount);
+    diffInfo->lineCount = lineCount;
+    int line = 0;
+    int diskLine = 0;
+    while (line < lineCount)
+    { // [line, nextLine)은 디스크의 [diskLine, nextDiskLine)을 대신함
+        int nextLine = line;
+        while (nextLine < lineCount && run.matches[nextLine] < 0)
+            nextLine++;
+        int nextDiskLine = nextLine < lineCount ? run.matches[nextLine] : diskCount;
+        for (int i = line; i < nextLine; i++)
+        {
+            bool isPaired = diskLine + (i - line) < nextDiskLine;
+            diffInfo->diskLines[i] = isPaired ? diskLine + (i - line) : -1;
+            diffInfo->lineStates[i] = isPaired ? DIFF_CHANGED : DIFF_ADDED;
+        }
+        if (nextLine < lineCount)
+        {
+            diffInfo->diskLines[nextLine] = nextDiskLine;
+            diffInfo->lineStates[nextLine] = DIFF_SAME;
+        }
+        if (nextDiskLine - diskLine > nextLine - line)
+            diffInfo->lineStates[nextLine > 0 ? nextLine - 1 : 0] |= DIFF_DELETED;
+        if (nextLine == lineCount)
+            break;
+        line = nextLine + 1;
+        diskLine = nextDiskLine + 1;
+    }
+    if (diskLine < diskCount && line == lineCount)
+        diffInfo->lineStates[lineCount - 1] |= DIFF_DELETED; // 끝부분이 지워짐
+
+    free(run.b);
+    free(run.matches);
+    free(run.forward);
+    free(run.backward);
+}
+
+void diffRange(DiffRun *run, int left, int top, int right, int bottom)
+{ // 디스크의 [left, right)와 버퍼의 [top, bottom)을 비교함, 같은 앞뒤 부분을 먼저 떼어내서 보통은 바뀐 곳 근처만 봄
+    while (left < right && top < bottom && run->a[left] == run->b[top])
+        run->matches[top++] = left++;
+    while (left < right && top < bottom && run->a[right - 1] == run->b[bottom - 1])
+        run->matches[--bottom] = --right;
+    if (left == right || top == bottom)
+        return;
+
+    int snake[4];
+    if (!diffMiddleSnake(run, left, top, right, bottom, snake))
+        return; // 너무 많이 다르면 구간 전체를 바뀐 것으로 둠
+    diffRange(run, left, top, snake[0], snake[1]);
+    diffRange(run, snake[0], snake[1], snake[2], snake[3]); // 편집이 하나뿐이라 앞뒤를 떼어내면 끝남
+    diffRange(run, snake[2], snake[3], right, bottom);
+}
+
+bool diffMiddleSnake(DiffRun *run, int left, int top, int right, int bottom, int *snake)
+{ // 앞과 뒤에서 동시에 편집 거리를 늘려가다가 만나는 스네이크를 찾음, snake에 시작과 끝 (x, y)를 넣음
+    int width = right - left;
+    int height = bottom - top;
+    int delta = width - height;
+    int maxCost = (width + height + 1) / 2;
+    if (maxCost > DIFF_MAX_COST)
+        maxCost = DIFF_MAX_COST;
+    int *forward = run->forward + DIFF_MAX_COST + 2; // 음수 대각선도 쓰도록 가운데를 0으로 둠
+    int *backward = run->backward + DIFF_MAX_COST + 2;
+    forward[1] = left;
+    backward[1] = bottom;
+
+    for (int cost = 0; cost <= maxCost; cost++)
+    {
+        for (int k = cost; k >= -cost; k -= 2)
+        {
+            int c = k - delta;
+            int x;
+            int px;
+            if (k == -cost || (k != cost && forward[k - 1] < forward[k + 1]))
+                x = px = forward[k + 1];
+            else
+            {
+                px = forward[k - 1];
+                x = px + 1;
+            }
+            int y = top + (x - left) - k;
+            int py = (cost == 0 || x != px) ? y : y - 1;
+            while (x < right && y < bottom && run->a[x] == run->b[y])
+            {
+                x++;
+                y++;
+            }
+            forward[k] = x;
+            if ((delta & 1) && c >= -(cost - 1) && c <= cost - 1 && y >= backward[c])
+            {
+                snake[0] = px;
+                snake[1] = py;
+                snake[2] = x;
+                snake[3] = y;
+                return true;
+            }
+        }
+        for (int c = cost; c >= -cost; c -= 2)
+        {
+            int k = c + delta;
+            int y;
+            int py;
+            if (c == -cost || (c != cost && backward[c - 1] > backward[c + 1]))
+                y = py = backward[c + 1];
+            else
+            {
+                py = backward[c - 1];
+                y = py - 1;
+            }
+            int x = left + (y - top) + k;
+            int px = (cost == 0 || y != py) ? x : x + 1;
+            while (x > left && y > top && run->a[x - 1] == run->b[y - 1])
+            {
+                x--;
+                y--;
+            }
+            backward[c] = y;
+            if (!(delta & 1) && k >= -cost && k <= cost && x <= forward[k])
+            {
+                snake[0] = x;
+                snake[1] = y;
+                snake[2] = px;
+                snake[3] = py;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void resetDiffBaseline(void)
+{ // 저장한 뒤에는 디스크의 파일이 버퍼와 같음
+    free(diffInfo->diskHashes);
+    diffInfo->diskHashes = bufferHashes();
+    diffInfo->diskCount = documentInfo->lineCount;
+    diffInfo->diskCapacity = documentInfo->lineCount;
+    ensureDiffCapacity(documentInfo->lineCount);
+    diffInfo->lineCount = documentInfo->lineCount;
+    for (int i = 0; i < diffInfo->lineCount; i++)
+    {
+        diffInfo->diskLines[i] = i;
+        diffInfo->lineStates[i] = DIFF_SAME;
+    }
+}
+
+int diffLineState(int line, Node *lineStart)
+{ // 고친 줄이면 해시를 다시 구해서 짝지어진 디스크의 줄과 비교함
+    int state = diffInfo->lineStates[line] & DIFF_STATE_MASK;
+    if (state == DIFF_STALE)
+    {
+        state = hashLine(lineStart, NULL) == diffInfo->diskHashes[diffInfo->diskLines[line]] ? DIFF_SAME : DIFF_CHANGED;
+        diffInfo->lineStates[line] = (diffInfo->lineStates[line] & DIFF_DELETED) | state;
+    }
+    return state;
+}
+
+void refreshDiffStates(void)
+{ // 문서를 한 번 따라가면서 고친 줄들만 다시 비교함
+    Node *p = head;
+    for (int line = 0; line < diffInfo->lineCount && p != tail; line++)
+    {
+        diffLineState(line, p);
+        for (p = p->next; p != tail && p->data != ENTER; p = p->next)
+            ;
+    }
+}
+
+int collectDiffHunks(DiffHunk **hunks)
+{ // 바뀐 줄이 이어진 구간과 그 사이에서 지워진 디스크의 줄들을 하나로 묶음
+    refreshDiffStates();
+    int capacity = 16;
+    int count = 0;
+    *hunks = (DiffHunk *)malloc(sizeof(DiffHunk) * capacity);
+    int expected = 0; // 다음에 짝지어질 것으로 보는 디스크의 줄
+    int start = -1;
+    int diskStart = 0;
+    for (int line = 0; line <= diffInfo->lineCount; line++)
+    {
+        bool isEnd = line == diffInfo->lineCount;
+        int diskLine = isEnd ? diffInfo->diskCount : diffInfo->diskLines[line];
+        bool isSame = isEnd || (diffInfo->lineStates[line] & DIFF_STATE_MASK) == DIFF_SAME;
+        if (!isSame)
+        {
+            if (start < 0)
+            {
+                start = line;
+                diskStart = expected;
+            }
+        }
+        else if (start >= 0 || diskLine > expected)
+        { // 이 줄 앞에서 구간이 끝남
+            if (start < 0)
+            {
+                start = line;
+                diskStart = expected;
+            }
+            if (count == capacity)
+            {
+                capacity *= 2;
+                *hunks = (DiffHunk *)realloc(*hunks, sizeof(DiffHunk) * capacity);
+            }
+            (*hunks)[count].line = start;
+            (*hunks)[count].lineCount = line - start;
+            (*hunks)[count].diskLine = diskStart;
+            (*hunks)[count].diskCount = diskLine - diskStart;
+            count++;
+            start = -1;
+        }
+        if (diskLine >= 0)
+            expected = diskLine + 1;
+    }
+    return count;
+}
+
+#ifndef VITE_LIBRARY
+void printDiffMarkers(void)
+{ // 화면에 보이는 줄마다 오른쪽 끝 칸에 추가(+), 바뀜(~), 아래 줄 지워짐(_)을 표시함
+    int height = windowSize->y - 2;
+    int row = documentInfo->isWrapMode ? -documentInfo->frameRow : 0;
+    Node *p = documentInfo->frameFirstNode;
+    for (int line = documentInfo->frameY; line < diffInfo->lineCount && row < height; line++)
+    {
+        int state = diffLineState(line, p);
+        int marker = 0;
+        int color = 0;
+        if (state == DIFF_CHANGED)
+        {
+            marker = '~';
+            color = COLOR_KEYWORD;
+        }
+        else if (state == DIFF_ADDED)
+        {
+            marker = '+';
+            color = COLOR_STRING;
+        }
+        else if (diffInfo->lineStates[line] & DIFF_DELETED)
+        {
+            marker = '_';
+            color = COLOR_LOG_ERROR;
+        }
+        if (marker != 0 && row >= 0)
+            mvaddch(row, windowSize->x - 1, marker | COLOR_PAIR(color));
+        row += documentInfo->isWrapMode ? layoutLineRows(line) : 1;
+        for (p = p->next; p != tail && p->data != ENTER; p = p->next)
+            ;
+        if (p == tail)
+            break;
+    }
+}
+#endif
+
+void diffLineChanged(int line)
+{ // 줄을 그리거나 바뀐 부분을 모을 때 다시 비교함
+    if (!diffInfo->isEnabled || line < 0 || line >= diffInfo->lineCount)
+        return;
+    if (diffInfo->diskLines[line] >= 0)
+        diffInfo->lineStates[line] = (diffInfo->lineStates[line] & DIFF_DELETED) | DIFF_STALE;
+}
+
+void diffLineSplit(int line, int column)
+{ // 줄 맨 앞에서 나뉘면 위에 줄이 추가된 것으로, 아니면 아래에 줄이 추가된 것으로 봄
+    if (!diffInfo->isEnabled || line < 0 || line >= diffInfo->lineCount)
+        return;
+    ensureDiffCapacity(diffInfo->lineCount + 1);
+    memmove(diffInfo->diskLines + line + 1, diffInfo->diskLines + line, sizeof(int) * (diffInfo->lineCount - line));
+    memmove(diffInfo->lineStates + line + 1, diffInfo->lineStates + line, diffInfo->lineCount - line);
+    diffInfo->lineCount++;
+    int added = column == 0 ? line : line + 1;
+    int kept = column == 0 ? line + 1 : line;
+    diffInfo->diskLines[added] = -1;
+    diffInfo->lineStates[added] = DIFF_ADDED;
+    if (column != 0)
+    { // 아래에서 지워진 줄은 나뉜 아랫줄 밑에 있음
+        diffInfo->lineStates[added] |= diffInfo->lineStates[kept] & DIFF_DELETED;
+        diffInfo->lineStates[kept] &= ~DIFF_DELETED;
+        diffLineChanged(kept);
+    }
+}
+
+void diffLineJoined(int line)
+{ // 합쳐진 두 줄 중 디스크와 짝지어진 줄을 남기고, 짝을 잃은 디스크의 줄은 지워진 것으로 표시함
+    if (!diffInfo->isEnabled || line <= 0 || line >= diffInfo->lineCount)
+        return;
+    int upper = line - 1;
+    unsigned char deleted = (diffInfo->lineStates[upper] | diffInfo->lineStates[line]) & DIFF_DELETED;
+    if (diffInfo->diskLines[upper] < 0)
+        diffInfo->diskLines[upper] = diffInfo->diskLines[line];
+    else if (diffInfo->diskLines[line] >= 0)
+        deleted = DIFF_DELETED;
+    diffInfo->lineStates[upper] = deleted | (diffInfo->diskLines[upper] >= 0 ? DIFF_STALE : DIFF_ADDED);
+    memmove(diffInfo->diskLines + line, diffInfo->diskLines + line + 1, sizeof(int) * (diffInfo->lineCount - line - 1));
+    memmove(diffInfo->lineStates + line, diffInfo->lineStates + line + 1, diffInfo->lineCount - line - 1);
+    diffInfo->lineCount--;
+}
+
+int bracketDelta(unsigned char data)
+{ // 여는 괄호는 +1, 닫는 괄호는 -1
+    switch (data)
+    {
+    case '(':
+    case '[':
+    case '{':
+        return 1;
+    case ')':
+    case ']':
+    case '}':
+        return -1;
+    }
+    return 0;
+}
+
+unsigned char bracketPartner(unsigned char data)
+{
+    char *pairs = "()[]{}";
+    char *found = strchr(pairs, data);
+    if (data == '\0' || found == NULL)
+        return 0;
+    int index = found - pairs;
+    return pairs[index ^ 1];
+}
+
+BracketBlock *addBracketBlock(Node *start)
+{
+    if (bracketInfo->blockCount == bracketInfo->capacity)
+    {
+        bracketInfo->capacity *= 2;
+        bracketInfo->blocks = (BracketBlock *)realloc(bracketInfo->blocks, sizeof(BracketBlock) * bracketInfo->capacity);
+    }
+    BracketBlock *block = &bracketInfo->blocks[bracketInfo->blockCount++];
+    block->start = start;
+    block->lineCount = 0;
+    block->depth = 0;
+    block->minDepth = 0;
+    block->isDirty = false;
+    return block;
+}
+
+void buildBracketIndex(void)
+{ // 문서를 한 번 따라가면서 BRACKET_BLOCK_SIZE 바이트쯤 되는 줄 묶음마다 깊이를 요약함
+    bracketInfo->blockCount = 0;
+    BracketBlock *block = addBracketBlock(head);
+    int length = 0;
+    for (Node *p = head->next; p != tail; p = p->next)
+    {
+        length++;
+        if (p->data == ENTER)
+        {
+            block->lineCount++;
+            if (length >= BRACKET_BLOCK_SIZE)
+            {
+                block = addBracketBlock(p);
+                length = 0;
+            }
+            continue;
+        }
+        int delta = bracketDelta(p->data);
+        if (delta != 0)
+        {
+            block->depth += delta;
+            if (block->depth < block->minDepth)
+                block->minDepth = block->depth;
+        }
+    }
+    block->lineCount++; // 마지막 줄
+    bracketInfo->isBuilt = true;
+    bracketInfo->isTreeDirty = true;
+}
+
+void resetBracketIndex(void)
+{ // 줄 캐시를 다시 만들 때는 색인도 다음에 괄호를 찾을 때 처음부터 만듦
+    bracketInfo->isBuilt = false;
+    bracketInfo->blockCount = 0;
+}
+
+void refreshBracketBlock(BracketBlock *block)
+{ // 편집된 블록의 요약을 문서에서 다시 셈
+    int lines = 0;
+    block->depth = 0;
+    block->minDepth = 0;
+    for (Node *p = block->start->next; p != tail; p = p->next)
+    {
+        if (p->data == ENTER && ++lines == block->lineCount)
+            break;
+        int delta = bracketDelta(p->data);
+        if (delta != 0)
+        {
+            block->depth += delta;
+            if (block->depth < block->minDepth)
+                block->minDepth = block->depth;
+        }
+    }
+    block->isDirty = false;
+}
+
+void updateBracketTree(int index)
+{ // 잎 하나를 고치고 조상들의 요약을 다시 합침
+    int node = bracketInfo->treeSize + index;
+    bracketInfo->treeDepths[node] = bracketInfo->blocks[index].depth;
+    bracketInfo->treeMinDepths[node] = bracketInfo->blocks[index].minDepth;
+    for (node /= 2; node >= 1; node /= 2)
+    {
+        int left = node * 2;
+        int right = left + 1;
+        bracketInfo->treeDepths[node] = bracketInfo->treeDepths[left] + bracketInfo->treeDepths[right];
+        int rightMin = bracketInfo->treeDepths[left] + bracketInfo->treeMinDepths[right];
+        bracketInfo->treeMinDepths[node] = bracketInfo->treeMinDepths[left] < rightMin ? bracketInfo->treeMinDepths[left] : rightMin;
+    }
+}
+
+void refreshBracketTree(void)
+{ // 고친 블록만 다시 세고 트리에 반영함, 블록 수가 바뀌었으면 트리를 다시 만듦
+    if (!bracketInfo->isBuilt)
+        buildBracketIndex();
+    if (bracketInfo->isTreeDirty)
+    {
+        int size = 1;
+        while (size < bracketInfo->blockCount)
+            size *= 2;
+        if (size != bracketInfo->treeSize)
+        {
+            bracketInfo->treeSize = size;
+            bracketInfo->treeDepths = (int *)realloc(bracketInfo->treeDepths, sizeof(int) * size * 2);
+            bracketInfo->treeMinDepths = (int *)realloc(bracketInfo->treeMinDepths, sizeof(int) * size * 2);
+        }
+        // 남는 잎은 깊이를 바꾸지 않는 빈 블록
+        memset(bracketInfo->treeDepths, 0, sizeof(int) * size * 2);
+        memset(bracketInfo->treeMinDepths, 0, sizeof(int) * size * 2);
+        for (int i = 0; i < bracketInfo->blockCount; i++)
+        {
+            BracketBlock *block = &bracketInfo->blocks[i];
+            if (block->isDirty)
+                refreshBracketBlock(block);
+            bracketInfo->treeDepths[size + i] = block->depth;
+            bracketInfo->treeMinDepths[size + i] = block->minDepth;
+        }
+        for (int node = size - 1; node >= 1; node--)
+        {
+            int left = node * 2;
+            int right = left + 1;
+            bracketInfo->treeDepths[node] = bracketInfo->treeDepths[left] + bracketInfo->treeDepths[right];
+            int rightMin = bracketInfo->treeDepths[left] + bracketInfo->treeMinDepths[right];
+            bracketInfo->treeMinDepths[node] = bracketInfo->treeMinDepths[left] < rightMin ? bracketInfo->treeMinDepths[left] : rightMin;
+        }
+        bracketInfo->isTreeDirty = false;
+        return;
+    }
+    for (int i = 0; i < bracketInfo->blockCount; i++)
+    {
+        if (bracketInfo->blocks[i].isDirty)
+        {
+            refreshBracketBlock(&bracketInfo->blocks[i]);
+            updateBracketTree(i);
+        }
+    }
+}
+
+int findBracketBlockForward(int node, int left, int right, int from, int *depth)
+{ // from 이후에서 깊이가 0까지 내려가는 첫 블록, depth는 그 블록 시작에서의 깊이가 됨
+    if (right < from)
+        return -1;
+    if (left >= from && *depth + bracketInfo->treeMinDepths[node] > 0)
+    { // 구간 전체를 건너뜀
+        *depth += bracketInfo->treeDepths[node];
+        return -1;
+    }
+    if (left == right)
+        return left;
+    int middle = (left + right) / 2;
+    int index = findBracketBlockForward(node * 2, left, middle, from, depth);
+    if (index >= 0)
+        return index;
+    return findBracketBlockForward(node * 2 + 1, middle + 1, right, from, depth);
+}
+
+int findBracketBlockBackward(int node, int left, int right, int to, int *depth)
+{ // to 이전에서 뒤로 가며 깊이가 0까지 내려가는 마지막 블록, depth는 그 블록 끝에서의 깊이가 됨
+    if (left > to)
+        return -1;
+    // 블록을 뒤에서부터 지나면 깊이는 -depth만큼 바뀌고 가장 얕은 곳은 minDepth - depth
+    if (right <= to && *depth - bracketInfo->treeDepths[node] + bracketInfo->treeMinDepths[node] > 0)
+    {
+        *depth -= bracketInfo->treeDepths[node];
+        return -1;
+    }
+    if (left == right)
+        return left;
+    int middle = (left + right) / 2;
+    int index = findBracketBlockBackward(node * 2 + 1, middle + 1, right, to, depth);
+    if (index >= 0)
+        return index;
+    return findBracketBlockBackward(node * 2, left, middle, to, depth);
+}
+
+Node *scanBrackets(Node *from, Node *stop, bool isForward, int *depth, int *line)
+{ // from부터 stop 앞까지 노드를 따라가며 깊이가 0이 되는 괄호를 찾음, 뒤로 갈 때는 닫는 괄호가 깊어짐
+    for (Node *p = from; p != stop; p = isForward ? p->next : p->prev)
+    {
+        if (p->data == ENTER)
+        {
+            *line += isForward ? 1 : -1;
+            continue;
+        }
+        *depth += isForward ? bracketDelta(p->data) : -bracketDelta(p->data);
+        if (*depth == 0)
+            return p;
+    }
+    return NULL;
+}
+
+bool findMatchingBracket(Node *node, int line, int *matchLine, int *matchColumn, Node **matchLineStart)
+{ // 커서가 있는 블록 안은 노드를 따라가고, 블록 밖은 트리에서 짝이 있는 블록을 찾은 뒤 그 블록만 따라감
+    int delta = bracketDelta(node->data);
+    if (delta == 0)
+        return false;
+    refreshBracketTree();
+    int firstLine;
+    int index = bracketBlockOfLine(line, &firstLine);
+    BracketBlock *blocks = bracketInfo->blocks;
+    int depth = 1;
+    Node *found;
+    if (delta > 0)
+    {
+        Node *blockEnd = index + 1 < bracketInfo->blockCount ? blocks[index + 1].start : tail;
+        found = scanBrackets(node->next, blockEnd, true, &depth, &line);
+        if (found == NULL)
+        {
+            int target = findBracketBlockForward(1, 0, bracketInfo->treeSize - 1, index + 1, &depth);
+            if (target < 0 || target >= bracketInfo->blockCount)
+                return false;
+            for (int i = index; i < target; i++)
+                firstLine += blocks[i].lineCount;
+            line = firstLine;
+            blockEnd = target + 1 < bracketInfo->blockCount ? blocks[target + 1].start : tail;
+            found = scanBrackets(blocks[target].start->next, blockEnd, true, &depth, &line);
+        }
+    }
+    else
+    {
+        found = scanBrackets(node->prev, blocks[index].start, false, &depth, &line);
+        if (found == NULL)
+        {
+            int target = findBracketBlockBackward(1, 0, bracketInfo->treeSize - 1, index - 1, &depth);
+            if (target < 0)
+                return false;
+            for (int i = target + 1; i < index; i++)
+                firstLine -= blocks[i].lineCount;
+            line = firstLine - 1; // 다음 블록의 시작 노드 바로 앞은 이 블록의 마지막 줄
+            found = scanBrackets(blocks[target + 1].start->prev, blocks[target].start, false, &depth, &line);
+        }
+    }
+    if (found == NULL || found->data != bracketPartner(node->data))
+        return false; // 종류가 다른 괄호와 만나면 짝이 없는 것으로 봄
+    int column = 0;
+    Node *lineStart = found->prev;
+    for (; lineStart != head && lineStart->data != ENTER; lineStart = lineStart->prev)
+        column++;
+    *matchLine = line;
+    *matchColumn = column;
+    if (matchLineStart != NULL)
+        *matchLineStart = lineStart;
+    return true;
+}
+
+bool cursorBracket(Node **node, int *line, int *column)
+{ // 커서 위치의 괄호, 없으면 커서 바로 앞의 괄호
+    *line = currentLineIndex();
+    *column = currentColumn();
+    *node = position->current->next;
+    if (*node != tail && bracketDelta((*node)->data) != 0)
+        return true;
+    *node = position->current;
+    (*column)--;
+    return *node != head && bracketDelta((*node)->data) != 0;
+}
+
+void updateBracketMatch(void)
+{ // 화면을 그리기 전에 커서의 괄호와 짝을 찾아둠, 선택 중에는 칠하지 않음
+    bracketInfo->cursorLine = -1;
+    bracketInfo->matchLine = -1;
+    Node *node;
+    int line;
+    int column;
+    if (selectionInfo->isSelecting || fileInfo->isFileReading || !cursorBracket(&node, &line, &column))
+        return;
+    bracketInfo->cursorLine = line;
+    bracketInfo->cursorColumn = column;
+    if (!findMatchingBracket(node, line, &bracketInfo->matchLine, &bracketInfo->matchColumn, NULL))
+        bracketInfo->matchLine = -1;
+}
+
+bool isMatchedBracket(int line, int column)
+{
+    if (bracketInfo->matchLine < 0)
+        return false;
+    return (line == bracketInfo->cursorLine && column == bracketInfo->cursorColumn) ||
+           (line == bracketInfo->matchLine && column == bracketInfo->matchColumn);
+}
+
+#ifndef VITE_LIBRARY
+void jumpToMatchingBracket(void)
+{
+    Node *node;
+    int line;
+    int column;
+    int matchLine;
+    int matchColumn;
+    Node *matchLineStart;
+    if (!cursorBracket(&node, &line, &column) || !findMatchingBracket(node, line, &matchLine, &matchColumn, &matchLineStart))
+    {
+        printMessage("No matching bracket.");
+        return;
+    }
+    moveCursorToLine(matchLine, matchLineStart, matchColumn);
+    print();
+}
+#endif
+
+int bracketBlockOfLine(int line, int *firstLine)
+{
+    *firstLine = 0;
+    for (int i = 0; i < bracketInfo->blockCount - 1; i++)
+    {
+        if (line < *firstLine + bracketInfo->blocks[i].lineCount)
+            return i;
+        *firstLine += bracketInfo->blocks[i].lineCount;
+    }
+    return bracketInfo->blockCount - 1;
+}
+
+void bracketLineChanged(int line)
+{
+    if (!bracketInfo->isBuilt)
+        return;
+    int firstLine;
+    bracketInfo->blocks[bracketBlockOfLine(line, &firstLine)].isDirty = true;
+}
+
+void bracketLineSplit(int line)
+{
+    if (!bracketInfo->isBuilt)
+        return;
+    int firstLine;
+    BracketBlock *block = &bracketInfo->blocks[bracketBlockOfLine(line, &firstLine)];
+    block->lineCount++;
+    block->isDirty = true;
+}
+
+void bracketLineJoined(int line)
+{
+    if (!bracketInfo->isBuilt)
+        return;
+    int firstLine;
+    int index = bracketBlockOfLine(line, &firstLine);
+    BracketBlock *block = &bracketInfo->blocks[index];
+    if (line == firstLine && index > 0)
+    { // 블록의 시작 노드가 지워졌으므로 앞 블록에 합침
+        BracketBlock *prev = &bracketInfo->blocks[index - 1];
+        prev->lineCount += block->lineCount - 1;
+        prev->isDirty = true;
+        memmove(bracketInfo->blocks + index, bracketInfo->blocks + index + 1,
+                sizeof(BracketBlock) * (bracketInfo->blockCount - index - 1));
+        bracketInfo->blockCount--;
+        bracketInfo->isTreeDirty = true;
+        return;
+    }
+    block->lineCount--;
+    block->isDirty = true;
+}
+
+void initThreadPool(void)
+{
+    threadPool = (ThreadPool *)malloc(sizeof(ThreadPool));
+    #ifdef WINDOWS
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    threadPool->threadCount = systemInfo.dwNumberOfProcessors;
+    #else
+    threadPool->threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    #endif
+    if (threadPool->threadCount < 1)
+        threadPool->threadCount = 1;
+
+    threadPool->taskCapacity = 64;
+    threadPool->tasks = (Task *)malloc(sizeof(Task) * threadPool->taskCapacity);
+    threadPool->taskHead = 0;
+    threadPool->taskCount = 0;
+    pthread_mutex_init(&threadPool->mutex, NULL);
+    pthread_cond_init(&threadPool->taskCond, NULL);
+    pthread_cond_init(&threadPool->doneCond, NULL);
+
+    threadPool->threads = (pthread_t *)malloc(sizeof(pthread_t) * threadPool->threadCount);
+    for (int i = 0; i < threadPool->threadCount; i++)
+    {
+        pthread_create(&threadPool->threads[i], NULL, runWorker, (void *)(long)i);
+    }
+}
+
+void *runWorker(void *arg)
+{
+    int worker = (int)(long)arg;
+    while (true)
+    {
+        pthread_mutex_lock(&threadPool->mutex);
+        while (threadPool->taskCount == 0)
+            pthread_cond_wait(&threadPool->taskCond, &threadPool->mutex);
+        Task task = threadPool->tasks[threadPool->taskHead];
+        threadPool->taskHead = (threadPool->taskHead + 1) % threadPool->taskCapacity;
+        threadPool->taskCount--;
+        pthread_mutex_unlock(&threadPool->mutex);
+
+        task.function(task.arg, worker);
+    }
+    return NULL;
+}
+
+void submitTask(void (*function)(void *arg, int worker), void *arg)
+{
+    pthread_mutex_lock(&threadPool->mutex);
+    if (threadPool->taskCount == threadPool->taskCapacity)
+    { // 큐가 가득 찬 경우 두 배로 늘리고 순서대로 다시 놓음
+        Task *tasks = (Task *)malloc(sizeof(Task) * threadPool->taskCapacity * 2);
+        for (int i = 0; i < threadPool->taskCount; i++)
+            tasks[i] = threadPool->tasks[(threadPool->taskHead + i) % threadPool->taskCapacity];
+        free(threadPool->tasks);
+        threadPool->tasks = tasks;
+        threadPool->taskHead = 0;
+        threadPool->taskCapacity *= 2;
+    }
+    int index = (threadPool->taskHead + threadPool->taskCount) % threadPool->taskCapacity;
+    threadPool->tasks[index].function = function;
+    threadPool->tasks[index].arg = arg;
+    threadPool->taskCount++;
+    pthread_cond_signal(&threadPool->taskCond);
+    pthread_mutex_unlock(&threadPool->mutex);
+}
+
+void markTaskDone(bool *isDone)
+{
+    pthread_mutex_lock(&threadPool->mutex);
+    *isDone = true;
+    pthread_cond_broadcast(&threadPool->doneCond);
+    pthread_mutex_unlock(&threadPool->mutex);
+}
+
+bool isTaskDone(bool *isDone)
+{
+    pthread_mutex_lock(&threadPool->mutex);
+    bool result = *isDone;
+    pthread_mutex_unlock(&threadPool->mutex);
+    return result;
+}
+
+void waitTask(bool *isDone)
+{
+    pthread_mutex_lock(&threadPool->mutex);
+    while (!*isDone)
+        pthread_cond_wait(&threadPool->doneCond, &threadPool->mutex);
+    pthread_mutex_unlock(&threadPool->mutex);
+}
+
+PNode *createResultList(void)
+{
+    PNode *wordListHead = (PNode *)malloc(sizeof(PNode));
+    PNode *wordListTail = (PNode *)malloc(sizeof(PNode));
+
+    wordListHead->next = wordListTail;
+    wordListHead->prev = wordListTail; // 한 방향으로만 접근 가능하도록 함 (반 원형 연결 리스트?)
+
+    wordListTail->prev = wordListHead;
+    wordListTail->next = NULL;
+    wordListHead->position = NULL;
+    wordListTail->position = NULL;
+    return wordListHead;
+}
+
+void appendResult(PNode *listHead, Node *node, int x, int y, int length)
+{
+    PNode *wordListTail = listHead->prev;
+    PNode *new = (PNode *)malloc(sizeof(PNode));
+    new->position = (Position *)malloc(sizeof(Position));
+    new->position->current = node;
+    new->position->x = x;
+    new->position->y = y;
+    new->length = length;
+
+    new->next = wordListTail;
+    new->prev = wordListTail->prev;
+
+    wordListTail->prev->next = new;
+    wordListTail->prev = new;
+}
+
+PNode *searchDocument(char *word, void (*onFirstResult)(PNode *result, char *word))
+{ // 문서를 청크로 나눠서 쓰레드 풀에서 검색하고, 결과는 문서 순서대로 합침
+    PNode *wordListHead = createResultList();
+    if (word[0] == '\0')
+        return wordListHead;
+
+    Regex **regexes = NULL;
+    if (searchInfo->isRegex)
+    {
+        regexes = (Regex **)malloc(sizeof(Regex *) * threadPool->threadCount);
+        for (int i = 0; i < threadPool->threadCount; i++)
+        {
+            regexes[i] = compileRegex(word, searchInfo->isCaseInsensitive);
+            if (regexes[i] == NULL)
+            { // 잘못된 정규식은 결과가 없는 것으로 처리함
+                free(regexes);
+                return wordListHead;
+            }
+        }
+    }
+
+    int jobCapacity = 64;
+    int jobCount = 0;
+    SearchJob **jobs = (SearchJob **)malloc(sizeof(SearchJob *) * jobCapacity);
+    int finishedCount = 0; // 앞에서부터 끝난 작업 수
+    int maxPending = threadPool->threadCount * SEARCH_CHUNKS_PER_THREAD;
+    TextChunk *spares = (TextChunk *)malloc(sizeof(TextChunk) * (maxPending + 1)); // 다 쓴 청크 버퍼를 다시 씀
+    int spareCount = 0;
+    bool isFirstReported = onFirstResult == NULL;
+
+    // 트라이그램 색인이 있으면 단어의 트라이그램이 모두 들어있는 블록만 복사해서 검색함
+    int wordLength = strlen(word);
+    bool isIndexUsed = trigramInfo->isEnabled && !searchInfo->isRegex && wordLength >= 3;
+    bool isBuilt = isIndexUsed && isTrigramIndexBuilt();
+    int blockIndex = 0;
+    int blockFirstLine = 0;
+    TrigramBlock *block = NULL;
+    unsigned char *newBits = NULL; // 편집된 블록은 검색하면서 비트맵을 다시 만듦
+    bool isBlockNeeded = isIndexUsed;
+
+    char *foldedWord = NULL; // 대소문자 무시 모드에서는 단어를 한 번만 소문자로 바꿔 둠
+    if (searchInfo->isCaseInsensitive && !searchInfo->isRegex)
+    {
+        foldedWord = strdup(word);
+        for (int i = 0; i < wordLength; i++)
+            foldedWord[i] = foldCase((unsigned char)foldedWord[i]);
+    }
+
+    Node *from = head;
+    int line = 0;
+    int endLine = INT_MAX;
+    while (true)
+    {
+        if (isBlockNeeded)
+        {
+            if (newBits != NULL)
+            { // 블록을 다 읽었으므로 새 비트맵으로 바꿈
+                free(block->bits);
+                block->bits = newBits;
+                block->isDirty = false;
+                newBits = NULL;
+            }
+            block = nextTrigramCandidate(&blockIndex, &blockFirstLine, word, wordLength);
+            if (block == NULL)
+                break;
+            from = block->start;
+            line = blockFirstLine - block->lineCount;
+            endLine = blockFirstLine;
+            if (isBuilt && block->isDirty && isTaskDone(&block->isIndexed))
+                newBits = (unsigned char *)calloc(TRIGRAM_BITS / 8, 1);
+            isBlockNeeded = false;
+        }
+
+        SearchJob *job = (SearchJob *)malloc(sizeof(SearchJob));
+        if (spareCount > 0)
+        {
+            job->chunk = spares[--spareCount];
+        }
+        else
+        {
+            job->chunk.capacity = SEARCH_CHUNK_SIZE * 2;
+            job->chunk.text = (char *)malloc(job->chunk.capacity);
+            job->chunk.nodes = (Node **)malloc(sizeof(Node *) * job->chunk.capacity);
+        }
+        if (!fillTextChunk(&job->chunk, &from, &line, endLine))
+        {
+            spares[spareCount++] = job->chunk;
+            free(job);
+            if (!isIndexUsed)
+                break;
+            isBlockNeeded = true;
+            continue;
+        }
+        if (newBits != NULL)
+            hashTrigrams(job->chunk.text, job->chunk.length, newBits);
+        job->results = createResultList();
+        job->isDone = false;
+        job->word = foldedWord != NULL ? foldedWord : word;
+        job->regexes = regexes;
+        job->isCaseInsensitive = searchInfo->isCaseInsensitive;
+        job->isWholeWord = searchInfo->isWholeWord;
+
+        if (jobCount == jobCapacity)
+        {
+            jobCapacity *= 2;
+            jobs = (SearchJob **)realloc(jobs, sizeof(SearchJob *) * jobCapacity);
+        }
+        jobs[jobCount++] = job;
+        submitTask(runSearchJob, job);
+
+        // 한 번에 들고 있는 청크 수를 제한함 (메모리)
+        while (finishedCount < jobCount)
+        {
+            if (jobCount - finishedCount > maxPending)
+                waitTask(&jobs[finishedCount]->isDone);
+            else if (!isTaskDone(&jobs[finishedCount]->isDone))
+                break;
+
+            SearchJob *finished = jobs[finishedCount++];
+            spares[spareCount++] = finished->chunk;
+
+            // 첫 번째 결과가 있는 청크까지 끝났으면 나머지를 기다리지 않고 먼저 보여줌
+            if (!isFirstReported && finished->results->next->next != NULL)
+            {
+                onFirstResult(finished->results->next, word);
+                isFirstReported = true;
+            }
+        }
+    }
+
+    for (int i = 0; i < jobCount; i++)
+    {
+        waitTask(&jobs[i]->isDone);
+        if (i >= finishedCount)
+            spares[spareCount++] = jobs[i]->chunk;
+
+        // 청크의 결과를 전체 결과 뒤에 붙임
+        PNode *jobHead = jobs[i]->results;
+        PNode *jobTail = jobHead->prev;
+        if (jobHead->next != jobTail)
+        {
+            PNode *wordListTail = wordListHead->prev;
+            jobHead->next->prev = wordListTail->prev;
+            wordListTail->prev->next = jobHead->next;
+            jobTail->prev->next = wordListTail;
+            wordListTail->prev = jobTail->prev;
+        }
+        free(jobHead);
+        free(jobTail);
+        free(jobs[i]);
+    }
+    free(jobs);
+    for (int i = 0; i < spareCount; i++)
+    {
+        free(spares[i].text);
+        free(spares[i].nodes);
+    }
+    free(spares);
+    free(foldedWord);
+
+    if (regexes != NULL)
+    {
+        for (int i = 0; i < threadPool->threadCount; i++)
+            freeRegex(regexes[i]);
+        free(regexes);
+    }
+    return wordListHead;
+}
+
+#ifndef VITE_LIBRARY
+void showFirstResult(PNode *result, char *word)
+{ // 큰 문서에서 나머지 청크를 검색하는 동안 첫 번째 결과를 먼저 보여줌
+    highlight(result, word, strlen(word) + 1);
+    printFindMessageBar(word, 1, -1);
+    refresh();
+}
+#endif
+
+void runSearchJob(void *arg, int worker)
+{
+    SearchJob *job = (SearchJob *)arg;
+    if (job->regexes != NULL)
+        searchRegexChunk(job, job->regexes[worker]);
+    else
+        searchLiteralChunk(job, job->word, strlen(job->word));
+    markTaskDone(&job->isDone);
+}
+
+void searchLiteralChunk(SearchJob *job, char *word, int wordLength)
+{
+    TextChunk *chunk = &job->chunk;
+    int line = chunk->firstLine;
+    char *lineStart = chunk->text;
+    char *counted = chunk->text; // 여기까지는 줄 수를 셌음
+    char *end = chunk->text + chunk->length;
+
+    char *found = chunk->text;
+    while ((found = job->isCaseInsensitive ? findBytesFolded(found, end - found, word, wordLength)
+                                           : findBytes(found, end - found, word, wordLength)) != NULL)
+    {
+        if (job->isWholeWord && !isWholeWordAt(chunk->text, chunk->length, found - chunk->text, found - chunk->text + wordLength))
+        { // 후보 단계에서 앞뒤 글자만 보고 거름, 청크는 줄 단위로 잘리므로 청크 경계는 단어 경계임
+            found++;
+            continue;
+        }
+        char *newline;
+        while ((newline = memchr(counted, ENTER, found - counted)) != NULL)
+        {
+            line++;
+            lineStart = newline + 1;
+            counted = newline + 1;
+        }
+        counted = found;
+        appendResult(job->results, chunk->nodes[found - chunk->text], found - lineStart, line, wordLength);
+        found++;
+    }
+}
+
+void searchRegexChunk(SearchJob *job, Regex *regex)
+{
+    TextChunk *chunk = &job->chunk;
+    char *isStart = (char *)malloc(chunk->length + 1);
+    int offset = 0;
+    int line = chunk->firstLine;
+    while (offset < chunk->length)
+    {
+        if (regex->prefixLength > 0)
+        { // 사전 필터: 고정 접두 문자열이 없는 줄은 DFA를 돌리지 않고 건너뜀
+            char *candidate = regex->isCaseInsensitive
+                                  ? findBytesFolded(chunk->text + offset, chunk->length - offset, regex->prefix, regex->prefixLength)
+                                  : findBytes(chunk->text + offset, chunk->length - offset, regex->prefix, regex->prefixLength);
+            if (candidate == NULL)
+                break;
+            char *lineStart = chunk->text + offset;
+            char *newline;
+            while ((newline = memchr(lineStart, ENTER, candidate - lineStart)) != NULL)
+            {
+                line++;
+                lineStart = newline + 1;
+            }
+            offset = lineStart - chunk->text;
+        }
+
+        char *newline = memchr(chunk->text + offset, ENTER, chunk->length - offset);
+        int lineLength = newline ? newline - (chunk->text + offset) : chunk->length - offset;
+        searchRegexLine(regex, chunk->text + offset, lineLength, isStart, job->results, chunk->nodes + offset, line,
+                        job->isWholeWord);
+        offset += lineLength + 1;
+        line++;
+    }
+    free(isStart);
+}
+
+bool fillTextChunk(TextChunk *chunk, Node **from, int *line, int endLine)
+{ // from 다음 노드부터 endLine 전까지 줄 단위로 청크를 채움, 더 이상 복사할 글자가 없으면 false
+    if ((*from)->next == tail || *line >= endLine)
+        return false;
+
+    chunk->firstLine = *line;
+    chunk->length = 0;
+
+    Node *p = (*from)->next;
+    while (p != tail)
+    {
+        if (chunk->length == chunk->capacity)
+        { // 청크보다 긴 줄은 청크를 늘려서 한 번에 담음
+            chunk->capacity *= 2;
+            chunk->text = (char *)realloc(chunk->text, chunk->capacity);
+            chunk->nodes = (Node **)realloc(chunk->nodes, sizeof(Node *) * chunk->capacity);
+        }
+        chunk->nodes[chunk->length] = p;
+        chunk->text[chunk->length++] = (char)p->data;
+        *from = p;
+        p = p->next;
+        if ((*from)->data == ENTER)
+        {
+            (*line)++;
+            if (chunk->length >= SEARCH_CHUNK_SIZE || *line >= endLine)
+                break;
+        }
+    }
+    return true;
+}
+
+char *findBytes(char *text, int length, char *word, int wordLength)
+{ // 첫 글자는 memchr로 건너뛰고 나머지만 비교함
+    if (wordLength == 0 || wordLength > length)
+        return NULL;
+    char *end = text + length - wordLength + 1;
+    while (text < end)
+    {
+        text = memchr(text, word[0], end - text);
+        if (text == NULL)
+            return NULL;
+        if (memcmp(text + 1, word + 1, wordLength - 1) == 0)
+            return text;
+        text++;
+    }
+    return NULL;
+}
+
+int foldCase(int ch)
+{ // ASCII 대문자만 소문자로 바꿈
+    return ch >= 'A' && ch <= 'Z' ? ch + ('a' - 'A') : ch;
+}
+
+bool equalsFolded(char *text, char *word, int length)
+{ // text를 소문자로 바꿔서 word(소문자)와 비교함, SSE2가 있으면 16글자씩 한 번에 바꿈
+    int i = 0;
+#ifdef __SSE2__
+    __m128i beforeA = _mm_set1_epi8('A' - 1);
+    __m128i afterZ = _mm_set1_epi8('Z' + 1);
+    __m128i caseBit = _mm_set1_epi8('a' - 'A');
+    for (; i + 16 <= length; i += 16)
+    { // 0x80 이상은 부호 있는 비교에서 음수라서 대문자로 잡히지 않음
+        __m128i block = _mm_loadu_si128((__m128i *)(text + i));
+        __m128i isUpper = _mm_and_si128(_mm_cmpgt_epi8(block, beforeA), _mm_cmplt_epi8(block, afterZ));
+        __m128i folded = _mm_or_si128(block, _mm_and_si128(isUpper, caseBit));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(folded, _mm_loadu_si128((__m128i *)(word + i)))) != 0xFFFF)
+            return false;
+    }
+#endif
+    for (; i < length; i++)
+    {
+        if (foldCase((unsigned char)text[i]) != (unsigned char)word[i])
+            return false;
+    }
+    return true;
+}
+
+char *findBytesFolded(char *text, int length, char *word, int wordLength)
+{ // 대소문자를 무시하는 findBytes, word는 미리 소문자로 바꿔서 넘김
+    if (wordLength == 0 || wordLength > length)
+        return NULL;
+    int last = length - wordLength; // 단어가 시작할 수 있는 마지막 위치
+    unsigned char lower = word[0];
+    unsigned char upper = lower >= 'a' && lower <= 'z' ? lower - ('a' - 'A') : lower;
+    int i = 0;
+#ifdef __SSE2__
+    // 첫 두 글자를 대소문자 둘 다와 16글자씩 비교해서 후보 위치를 비트마스크로 얻음
+    unsigned char secondLower = wordLength > 1 ? word[1] : lower;
+    unsigned char secondUpper = secondLower >= 'a' && secondLower <= 'z' ? secondLower - ('a' - 'A') : secondLower;
+    int secondOffset = wordLength > 1 ? 1 : 0; // 한 글자 단어는 첫 글자만 봄
+    __m128i lowerVector = _mm_set1_epi8((char)lower);
+    __m128i upperVector = _mm_set1_epi8((char)upper);
+    __m128i secondLowerVector = _mm_set1_epi8((char)secondLower);
+    __m128i secondUpperVector = _mm_set1_epi8((char)secondUpper);
+    for (; i + 16 <= last + 1; i += 16)
+    { // i + 15 <= last 이므로 두 번째 글자를 읽어도 text를 넘지 않음
+        __m128i block = _mm_loadu_si128((__m128i *)(text + i));
+        __m128i second = _mm_loadu_si128((__m128i *)(text + i + secondOffset));
+        __m128i isFirst = _mm_or_si128(_mm_cmpeq_epi8(block, lowerVector), _mm_cmpeq_epi8(block, upperVector));
+        __m128i isSecond = _mm_or_si128(_mm_cmpeq_epi8(second, secondLowerVector), _mm_cmpeq_epi8(second, secondUpperVector));
+        int mask = _mm_movemask_epi8(_mm_and_si128(isFirst, isSecond));
+        while (mask != 0)
+        {
+            int bit = __builtin_ctz(mask);
+            if (equalsFolded(text + i + bit + 1, word + 1, wordLength - 1))
+                return text + i + bit;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i <= last; i++)
+    {
+        unsigned char ch = text[i];
+        if ((ch == lower || ch == upper) && equalsFolded(text + i + 1, word + 1, wordLength - 1))
+            return text + i;
+    }
+    return NULL;
+}
+
+bool isWordCharacter(int ch)
+{ // 0x80 이상은 멀티바이트 글자의 일부이므로 단어 글자로 취급함
+    return isalnum(ch) || ch == '_' || ch >= 0x80;
+}
+
+bool isWholeWordAt(char *text, int length, int start, int end)
+{ // text[start, end)의 앞뒤가 단어 경계인지 확인함
+    if (start > 0 && isWordCharacter((unsigned char)text[start - 1]) && isWordCharacter((unsigned char)text[start]))
+        return false;
+    if (end < length && isWordCharacter((unsigned char)text[end]) && isWordCharacter((unsigned char)text[end - 1]))
+        return false;
+    return true;
+}
+
+RegexNode *newRegexNode(int type, RegexNode *left, RegexNode *right)
+{
+    RegexNode *node = (RegexNode *)malloc(sizeof(RegexNode));
+    node->type = type;
+    memset(node->set, 0, sizeof(node->set));
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+void freeRegexNode(RegexNode *node)
+{
+    if (node == NULL)
+        return;
+    freeRegexNode(node->left);
+    freeRegexNode(node->right);
+    free(node);
+}
+
+RegexNode *parseRegexAlternate(char **pattern, bool *isValid)
+{ // alternate := concat ('|' concat)*
+    RegexNode *node = parseRegexConcat(pattern, isValid);
+    while (**pattern == '|' && *isValid)
+    {
+        (*pattern)++;
+        node = newRegexNode(REGEX_ALTERNATE, node, parseRegexConcat(pattern, isValid));
+    }
+    return node;
+}
+
+RegexNode *parseRegexConcat(char **pattern, bool *isValid)
+{ // concat := repeat*
+    RegexNode *node = NULL;
+    while (**pattern != '\0' && **pattern != '|' && **pattern != ')' && *isValid)
+    {
+        RegexNode *next = parseRegexRepeat(pattern, isValid);
+        node = node == NULL ? next : newRegexNode(REGEX_CONCAT, node, next);
+    }
+    return node == NULL ? newRegexNode(REGEX_EMPTY, NULL, NULL) : node;
+}
+
+RegexNode *parseRegexRepeat(char **pattern, bool *isValid)
+{ // repeat := atom ('*' | '+' | '?')*
+    RegexNode *node = parseRegexAtom(pattern, isValid);
+    while (**pattern == '*' || **pattern == '+' || **pattern == '?')
+    {
+        int type = **pattern == '*' ? REGEX_STAR : **pattern == '+' ? REGEX_PLUS : REGEX_QUESTION;
+        (*pattern)++;
+        node = newRegexNode(type, node, NULL);
+    }
+    return node;
+}
+
+bool addRegexEscape(unsigned char *set, char c)
+{ // \d, \w, \s 등을 set에 추가함, 잘못된 이스케이프는 false
+    bool isNegated = isupper((unsigned char)c) && strchr("DWS", c) != NULL;
+    char lower = tolower((unsigned char)c);
+    if (c == '\0')
+        return false;
+
+    if (lower == 'd' || lower == 'w' || lower == 's')
+    {
+        for (int ch = 0; ch < 256; ch++)
+        {
+            bool isMember = lower == 'd' ? isdigit(ch)
+                          : lower == 'w' ? (isalnum(ch) || ch == '_')
+                                         : (ch == ' ' || (ch >= '\t' && ch <= '\r'));
+            if (isMember != isNegated && ch != ENTER)
+                set[ch >> 3] |= 1 << (ch & 7);
+        }
+    }
+    else if (c == 't')
+        set['\t' >> 3] |= 1 << ('\t' & 7);
+    else
+        set[(unsigned char)c >> 3] |= 1 << ((unsigned char)c & 7);
+    return true;
+}
+
+RegexNode *parseRegexAtom(char **pattern, bool *isValid)
+{ // atom := '(' alternate ')' | '[' class ']' | '.' | '\' escape | literal
+    char c = **pattern;
+    if (c == '(')
+    {
+        (*pattern)++;
+        RegexNode *node = parseRegexAlternate(pattern, isValid);
+        if (**pattern != ')')
+            *isValid = false;
+        else
+            (*pattern)++;
+        return node;
+    }
+    if (c == '*' || c == '+' || c == '?')
+    { // 반복할 대상이 없음
+        *isValid = false;
+        return newRegexNode(REGEX_EMPTY, NULL, NULL);
+    }
+
+    RegexNode *node = newRegexNode(REGEX_SET, NULL, NULL);
+    (*pattern)++;
+    if (c == '.')
+    {
+        memset(node->set, 0xff, sizeof(node->set));
+        node->set[ENTER >> 3] &= ~(1 << (ENTER & 7));
+    }
+    else if (c == '\\')
+    {
+        if (!addRegexEscape(node->set, **pattern))
+            *isValid = false;
+        else
+            (*pattern)++;
+    }
+    else if (c == '[')
+    {
+        bool isNegated = **pattern == '^';
+        if (isNegated)
+            (*pattern)++;
+        bool isFirst = true;
+        while (**pattern != '\0' && (**pattern != ']' || isFirst))
+        {
+            unsigned char from = **pattern;
+            (*pattern)++;
+            isFirst = false;
+            if (from == '\\')
+            {
+                if (!addRegexEscape(node->set, **pattern))
+                    break;
+                (*pattern)++;
+                continue;
+            }
+            unsigned char to = from;
+            if (**pattern == '-' && (*pattern)[1] != ']' && (*pattern)[1] != '\0')
+            {
+                to = (*pattern)[1];
+                *pattern += 2;
+            }
+            for (int ch = from; ch <= to; ch++)
+                node->set[ch >> 3] |= 1 << (ch & 7);
+        }
+        if (**pattern != ']')
+            *isValid = false;
+        else
+            (*pattern)++;
+        if (isNegated)
+        {
+            for (int i = 0; i < 32; i++)
+                node->set[i] = ~node->set[i];
+            node->set[ENTER >> 3] &= ~(1 << (ENTER & 7));
+        }
+    }
+    else
+        node->set[(unsigned char)c >> 3] |= 1 << ((unsigned char)c & 7);
+    return node;
+}
+
+void regexPrefix(RegexNode *node, Regex *regex, bool *isDone)
+{ // 매칭이 항상 시작하는 고정 문자열을 구함
+    if (*isDone)
+        return;
+    if (node->type == REGEX_CONCAT)
+    {
+        regexPrefix(node->left, regex, isDone);
+        regexPrefix(node->right, regex, isDone);
+    }
+    else if (node->type == REGEX_PLUS)
+    {
+        regexPrefix(node->left, regex, isDone);
+        *isDone = true;
+    }
+    else if (node->type == REGEX_SET)
+    {
+        int count = 0;
+        int last = 0;
+        for (int ch = 0; ch < 256 && count < 2; ch++)
+        {
+            if (node->set[ch >> 3] & (1 << (ch & 7)))
+            {
+                count++;
+                last = ch;
+            }
+        }
+        if (count != 1 || regex->prefixLength == (int)sizeof(regex->prefix) - 1)
+            *isDone = true;
+        else
+            regex->prefix[regex->prefixLength++] = (char)last;
+    }
+    else if (node->type != REGEX_EMPTY)
+        *isDone = true;
+}
+
+int addNfaState(Regex *regex, int type, int set, int out, int out1)
+{
+    if (regex->nfaCount == regex->nfaCapacity)
+    {
+        regex->nfaCapacity = regex->nfaCapacity ? regex->nfaCapacity * 2 : 64;
+        regex->nfa = (NfaState *)realloc(regex->nfa, sizeof(NfaState) * regex->nfaCapacity);
+    }
+    NfaState *state = &regex->nfa[regex->nfaCount];
+    state->type = type;
+    state->set = set;
+    state->out = out;
+    state->out1 = out1;
+    return regex->nfaCount++;
+}
+
+int compileRegexNode(Regex *regex, RegexNode *node, bool isReversed, int *end)
+{ // Thompson 방식: 조각의 시작 상태를 반환하고, 다음 조각과 이을 EPSILON 상태를 end에 넣음
+    int start, end1, end2;
+    if (node->type == REGEX_SET)
+    {
+        regex->sets = realloc(regex->sets, sizeof(regex->sets[0]) * (regex->setCount + 1));
+        memcpy(regex->sets[regex->setCount], node->set, sizeof(node->set));
+        *end = addNfaState(regex, NFA_EPSILON, 0, -1, -1);
+        return addNfaState(regex, NFA_SET, regex->setCount++, *end, -1);
+    }
+    if (node->type == REGEX_CONCAT)
+    { // 거꾸로 된 NFA는 이어붙이는 순서만 반대임
+        start = compileRegexNode(regex, isReversed ? node->right : node->left, isReversed, &end1);
+        int second = compileRegexNode(regex, isReversed ? node->left : node->right, isReversed, &end2);
+        regex->nfa[end1].out = second;
+        *end = end2;
+        return start;
+    }
+    if (node->type == REGEX_ALTERNATE)
+    {
+        int first = compileRegexNode(regex, node->left, isReversed, &end1);
+        int second = compileRegexNode(regex, node->right, isReversed, &end2);
+        *end = addNfaState(regex, NFA_EPSILON, 0, -1, -1);
+        regex->nfa[end1].out = *end;
+        regex->nfa[end2].out = *end;
+        return addNfaState(regex, NFA_SPLIT, 0, first, second);
+    }
+    if (node->type == REGEX_STAR || node->type == REGEX_PLUS || node->type == REGEX_QUESTION)
+    {
+        int first = compileRegexNode(regex, node->left, isReversed, &end1);
+        *end = addNfaState(regex, NFA_EPSILON, 0, -1, -1);
+        int split = addNfaState(regex, NFA_SPLIT, 0, first, *end);
+        regex->nfa[end1].out = node->type == REGEX_QUESTION ? *end : split;
+        return node->type == REGEX_PLUS ? first : split;
+    }
+    *end = addNfaState(regex, NFA_EPSILON, 0, -1, -1);
+    return *end;
+}
+
+Regex *compileRegex(char *pattern, bool isCaseInsensitive)
+{ // 잘못된 정규식이면 NULL
+    Regex *regex = (Regex *)calloc(1, sizeof(Regex));
+    char body[100];
+    strncpy(body, pattern, sizeof(body) - 1);
+    body[sizeof(body) - 1] = '\0';
+
+    // ^와 $는 패턴의 처음과 끝에서만 앵커로 취급함
+    char *p = body;
+    if (*p == '^')
+    {
+        regex->isStartAnchored = true;
+        p++;
+    }
+    int length = strlen(p);
+    int backslashCount = 0;
+    for (int i = length - 2; i >= 0 && p[i] == '\\'; i--)
+        backslashCount++;
+    if (length > 0 && p[length - 1] == '$' && backslashCount % 2 == 0)
+    {
+        regex->isEndAnchored = true;
+        p[length - 1] = '\0';
+    }
+
+    bool isValid = true;
+    RegexNode *root = parseRegexAlternate(&p, &isValid);
+    if (!isValid || *p != '\0')
+    {
+        freeRegexNode(root);
+        free(regex);
+        return NULL;
+    }
+
+    bool isDone = false;
+    regexPrefix(root, regex, &isDone);
+    regex->prefix[regex->prefixLength] = '\0';
+
+    int end;
+    int match = addNfaState(regex, NFA_MATCH, 0, -1, -1);
+    regex->forwardStart = compileRegexNode(regex, root, false, &end);
+    regex->nfa[end].out = match;
+    regex->reverseStart = compileRegexNode(regex, root, true, &end);
+    regex->nfa[end].out = match;
+    freeRegexNode(root);
+
+    if (isCaseInsensitive)
+    { // 모든 집합에서 대소문자 중 하나가 있으면 둘 다 받아들이게 해서 DFA는 그대로 씀
+        regex->isCaseInsensitive = true;
+        for (int i = 0; i < regex->setCount; i++)
+        {
+            for (int ch = 'a'; ch <= 'z'; ch++)
+            {
+                int upper = ch - ('a' - 'A');
+                if ((regex->sets[i][ch >> 3] & (1 << (ch & 7))) || (regex->sets[i][upper >> 3] & (1 << (upper & 7))))
+                {
+                    regex->sets[i][ch >> 3] |= 1 << (ch & 7);
+                    regex->sets[i][upper >> 3] |= 1 << (upper & 7);
+                }
+            }
+        }
+        for (int i = 0; i < regex->prefixLength; i++)
+            regex->prefix[i] = foldCase((unsigned char)regex->prefix[i]);
+    }
+
+    initDfa(&regex->forward, regex, regex->forwardStart, false);
+    initDfa(&regex->reverse, regex, regex->reverseStart, !regex->isEndAnchored);
+    return regex;
+}
+
+void freeRegex(Regex *regex)
+{
+    freeDfa(&regex->forward);
+    freeDfa(&regex->reverse);
+    free(regex->scanStates);
+    free(regex->scanEnds);
+    free(regex->scanPath);
+    free(regex->nfa);
+    free(regex->sets);
+    free(regex);
+}
+
+void initDfa(Dfa *dfa, Regex *regex, int start, bool isUnanchored)
+{
+    dfa->nfa = regex->nfa;
+    dfa->sets = regex->sets;
+    dfa->nfaStart = start;
+    dfa->isUnanchored = isUnanchored;
+    dfa->states = (DfaState *)malloc(sizeof(DfaState) * DFA_MAX_STATES);
+    dfa->stateCount = 0;
+    dfa->start = DFA_UNKNOWN;
+    dfa->table = (int *)malloc(sizeof(int) * DFA_MAX_STATES * 2);
+    for (int i = 0; i < DFA_MAX_STATES * 2; i++)
+        dfa->table[i] = -1;
+    dfa->stack = (int *)malloc(sizeof(int) * (regex->nfaCount * 2 + 1));
+    dfa->scratch = (int *)malloc(sizeof(int) * regex->nfaCount);
+    dfa->marks = (int *)calloc(regex->nfaCount, sizeof(int));
+    dfa->mark = 0;
+    dfa->flushCount = 0;
+}
+
+void flushDfa(Dfa *dfa)
+{ // 상태가 너무 많아지면 캐시를 비우고 처음부터 다시 만듦 (메모리 사용량 제한)
+    for (int i = 0; i < dfa->stateCount; i++)
+        free(dfa->states[i].nfaStates);
+    dfa->stateCount = 0;
+    dfa->start = DFA_UNKNOWN;
+    dfa->flushCount++;
+    for (int i = 0; i < DFA_MAX_STATES * 2; i++)
+        dfa->table[i] = -1;
+}
+
+void freeDfa(Dfa *dfa)
+{
+    flushDfa(dfa);
+    free(dfa->states);
+    free(dfa->table);
+    free(dfa->stack);
+    free(dfa->scratch);
+    free(dfa->marks);
+}
+
+int compareInt(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+int addDfaState(Dfa *dfa, int *nfaStates, int count)
+{ // 같은 NFA 상태 집합이 이미 있으면 그 DFA 상태를 반환함
+    qsort(nfaStates, count, sizeof(int), compareInt);
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < count; i++)
+        hash = (hash ^ (unsigned int)nfaStates[i]) * 16777619u;
+
+    int index = hash & (DFA_MAX_STATES * 2 - 1);
+    while (dfa->table[index] != -1)
+    {
+        DfaState *state = &dfa->states[dfa->table[index]];
+        if (state->count == count && memcmp(state->nfaStates, nfaStates, sizeof(int) * count) == 0)
+            return dfa->table[index];
+        index = (index + 1) & (DFA_MAX_STATES * 2 - 1);
+    }
+
+    if (dfa->stateCount == DFA_MAX_STATES)
+    {
+        flushDfa(dfa);
+        return addDfaState(dfa, nfaStates, count);
+    }
+
+    DfaState *state = &dfa->states[dfa->stateCount];
+    state->nfaStates = (int *)malloc(sizeof(int) * count);
+    memcpy(state->nfaStates, nfaStates, sizeof(int) * count);
+    state->count = count;
+    state->isMatch = false;
+    for (int i = 0; i < count; i++)
+    {
+        if (dfa->nfa[nfaStates[i]].type == NFA_MATCH)
+            state->isMatch = true;
+    }
+    for (int i = 0; i < 256; i++)
+        state->next[i] = DFA_UNKNOWN;
+    dfa->table[index] = dfa->stateCount;
+    return dfa->stateCount++;
+}
+
+void addNfaClosure(Dfa *dfa, int state, int *nfaStates, int *count)
+{ // EPSILON, SPLIT을 따라가서 도달할 수 있는 SET, MATCH 상태를 모두 추가함
+    int top = 0;
+    dfa->stack[top++] = state;
+    while (top > 0)
+    {
+        int s = dfa->stack[--top];
+        if (s < 0 || dfa->marks[s] == dfa->mark)
+            continue;
+        dfa->marks[s] = dfa->mark;
+
+        NfaState *nfaState = &dfa->nfa[s];
+        if (nfaState->type == NFA_SET || nfaState->type == NFA_MATCH)
+            nfaStates[(*count)++] = s;
+        else
+        {
+            dfa->stack[top++] = nfaState->out;
+            if (nfaState->type == NFA_SPLIT)
+                dfa->stack[top++] = nfaState->out1;
+        }
+    }
+}
+
+int dfaStart(Dfa *dfa)
+{
+    if (dfa->start == DFA_UNKNOWN)
+    {
+        int count = 0;
+        dfa->mark++;
+        addNfaClosure(dfa, dfa->nfaStart, dfa->scratch, &count);
+        dfa->start = addDfaState(dfa, dfa->scratch, count);
+    }
+    return dfa->start;
+}
+
+int dfaStep(Dfa *dfa, int state, unsigned char ch)
+{ // 아직 만들지 않은 전이만 NFA로 계산함
+    DfaState *from = &dfa->states[state];
+    if (from->next[ch] != DFA_UNKNOWN)
+        return from->next[ch];
+
+    int count = 0;
+    dfa->mark++;
+    for (int i = 0; i < from->count; i++)
+    {
+        NfaState *nfaState = &dfa->nfa[from->nfaStates[i]];
+        if (nfaState->type == NFA_SET && (dfa->sets[nfaState->set][ch >> 3] & (1 << (ch & 7))))
+            addNfaClosure(dfa, nfaState->out, dfa->scratch, &count);
+    }
+    if (dfa->isUnanchored)
+        addNfaClosure(dfa, dfa->nfaStart, dfa->scratch, &count);
+    if (count == 0)
+    {
+        from->next[ch] = DFA_DEAD;
+        return DFA_DEAD;
+    }
+
+    int flushCount = dfa->flushCount;
+    int next = addDfaState(dfa, dfa->scratch, count);
+    if (flushCount == dfa->flushCount) // 캐시를 비운 경우 state는 더 이상 유효하지 않음
+        dfa->states[state].next[ch] = next;
+    return next;
+}
+
+int regexLongestMatch(Regex *regex, char *text, int start, int length)
+{ // start에서 시작하는 가장 긴 매칭의 끝, 없으면 -1
+    // 앞선 시작 위치가 같은 위치에 같은 상태로 온 적이 있으면 그 뒤는 똑같으므로 기록한 끝을 씀
+    Dfa *dfa = &regex->forward;
+    int state = dfaStart(dfa);
+    int laterEnd = -1;
+    int i = start;
+    while (true)
+    {
+        int *states = regex->scanStates + i * REGEX_SCAN_WAYS;
+        int slot = -1;
+        for (int way = 0; way < REGEX_SCAN_WAYS && dfa->flushCount == regex->scanFlushCount; way++)
+        {
+            if (states[way] == state)
+                slot = way;
+        }
+        if (slot >= 0)
+        {
+            laterEnd = regex->scanEnds[i * REGEX_SCAN_WAYS + slot];
+            break;
+        }
+        slot = state % REGEX_SCAN_WAYS; // 빈 칸이 없으면 상태 번호로 고른 칸을 덮어씀
+        for (int way = REGEX_SCAN_WAYS - 1; way >= 0; way--)
+        {
+            if (states[way] < 0)
+                slot = way;
+        }
+        states[slot] = state;
+        regex->scanEnds[i * REGEX_SCAN_WAYS + slot] = dfa->states[state].isMatch ? i : -1;
+        regex->scanPath[i] = i * REGEX_SCAN_WAYS + slot;
+        i++;
+        if (i > length)
+            break;
+        state = dfaStep(dfa, state, (unsigned char)text[i - 1]);
+        if (state == DFA_DEAD)
+            break;
+    }
+
+    // 거꾸로 가며 이번에 기록한 칸을 그 뒤에서 찾은 가장 긴 끝으로 바꿈
+    int end = laterEnd;
+    for (int j = i - 1; j >= start; j--)
+    {
+        if (end < 0)
+            end = regex->scanEnds[regex->scanPath[j]];
+        else
+            regex->scanEnds[regex->scanPath[j]] = end;
+    }
+    if (dfa->flushCount != regex->scanFlushCount)
+    { // 캐시를 비우기 전에 기록한 상태 번호는 다른 상태를 가리킬 수 있음
+        memset(regex->scanStates, -1, sizeof(int) * (length + 1) * REGEX_SCAN_WAYS);
+        regex->scanFlushCount = dfa->flushCount;
+    }
+    if (regex->isEndAnchored && end != length)
+        return -1;
+    return end;
+}
+
+bool searchRegexLine(Regex *regex, char *text, int length, char *isStart, PNode *listHead, Node **nodes, int line, bool isWholeWord)
+{ // 한 줄에서 겹치지 않는 가장 왼쪽-가장 긴 매칭을 모두 찾음, listHead가 NULL이면 매칭이 있는지만 봄
+    // 시작 위치마다 forward를 돌리지만 앞선 스캔과 같은 위치에서 같은 상태가 되면 멈추므로,
+    // 한 위치에 오는 상태가 REGEX_SCAN_WAYS개 이하인 패턴은 줄 길이에 선형임 (그보다 많으면 제곱까지 걸릴 수 있음)
+    if (length + 1 > regex->scanCapacity)
+    {
+        regex->scanCapacity = length + 1 > regex->scanCapacity * 2 ? length + 1 : regex->scanCapacity * 2;
+        regex->scanStates = (int *)realloc(regex->scanStates, sizeof(int) * regex->scanCapacity * REGEX_SCAN_WAYS);
+        regex->scanEnds = (int *)realloc(regex->scanEnds, sizeof(int) * regex->scanCapacity * REGEX_SCAN_WAYS);
+        regex->scanPath = (int *)realloc(regex->scanPath, sizeof(int) * regex->scanCapacity);
+    }
+    bool isScanReset = false;
+
+    // 줄 끝에서부터 거꾸로 된 DFA를 돌려서 매칭이 시작할 수 있는 위치를 표시함
+    Dfa *reverse = &regex->reverse;
+    int state = dfaStart(reverse);
+    isStart[length] = reverse->states[state].isMatch;
+    for (int i = length - 1; i >= 0; i--)
+    {
+        if (state != DFA_DEAD)
+            state = dfaStep(reverse, state, (unsigned char)text[i]);
+        isStart[i] = state != DFA_DEAD && reverse->states[state].isMatch;
+    }
+
+    for (int start = 0; start < length; start++)
+    {
+        if (regex->isStartAnchored && start > 0)
+            break;
+        if (!isStart[start])
+            continue;
+        if (!isScanReset)
+        { // 매칭이 시작할 수 있는 줄에서만 기록을 비움
+            memset(regex->scanStates, -1, sizeof(int) * (length + 1) * REGEX_SCAN_WAYS);
+            regex->scanFlushCount = regex->forward.flushCount;
+            isScanReset = true;
+        }
+
+        int end = regexLongestMatch(regex, text, start, length);
+        if (end <= start) // 빈 매칭은 결과로 보여주지 않음
+            continue;
+        if (isWholeWord && !isWholeWordAt(text, length, start, end)) // 단어 중간에서 시작하거나 끝나는 매칭은 버림
+            continue;
+        if (listHead == NULL)
+            return true;
+
+        appendResult(listHead, nodes[start], start, line, end - start);
+        start = end - 1;
+    }
+    return false;
+}
+
+#ifndef VITE_LIBRARY
+void highlight(PNode *p, char *word, int wordLength)
+{
+    // 찾은 위치는 바이트 단위이므로 화면상의 칸으로 바꿈
+    int startColumn = p->position->x;
+    int endColumn = startColumn + p->length;
+    if (!layoutIsPlainLine(p->position->y))
+    {
+        Node *lineStart = lineStartOf(p->position->current->prev);
+        startColumn = displayOfColumn(p->position->y, lineStart, p->position->x);
+        endColumn = displayOfColumn(p->position->y, lineStart, p->position->x + p->length);
+    }
+
+    if (documentInfo->isWrapMode)
+    { // 찾은 단어가 화면 가운데에 오도록 함
+        updateLayout();
+        int rowWidth = wrapWidth();
+        int height = windowSize->y - 2;
+        int wordRow = layoutRowOfLine(p->position->y);
+        int row = wordRow + startColumn / rowWidth;
+        wrapSetFrameTop(row > height / 2 ? row - height / 2 : 0);
+        wordRow -= layoutRowOfLine(documentInfo->frameY) + documentInfo->frameRow;
+
+        print();
+        Node *node = p->position->current;
+        int column = startColumn;
+        for (int i = 0; i < p->length;)
+        {
+            int width;
+            int length = nodeCharLength(node, column, &width);
+            for (int j = 0; node->data == TAB && j < width; j++)
+                mvaddch(wordRow + (column + j) / rowWidth, (column + j) % rowWidth, ' ' | COLOR_PAIR(1));
+            if (width > 0 && node->data != TAB)
+                printChar(wordRow + column / rowWidth, column % rowWidth, node, length, COLOR_PAIR(1));
+            column += width;
+            i += length;
+            for (int j = 0; j < length; j++)
+                node = node->next;
+        }
+        move(windowSize->y - 1, textWidth(word, wordLength - 1));
+        return;
+    }
+
+    if (endColumn + 1 < windowSize->x - 1)
+    {
+        documentInfo->frameX = 0;
+    }
+    else
+    {
+        documentInfo->frameX = endColumn + 1 - (windowSize->x - 1);
+    }
+
+    int paddingY = (int)(windowSize->y - 2) / 2; // 페이지 내에서 출력될 단어의 y 위치
+    if (p->position->y < windowSize->y - 2)
+    {
+        documentInfo->frameY = 0;
+        documentInfo->frameFirstNode = head;
+        documentInfo->frameLastNode = head;
+        for (int i = 0; i < windowSize->y - 2; i++)
+        {
+            moveLastFrameRight();
+        }
+        paddingY = p->position->y;
+    }
+    else
+    {
+        documentInfo->frameY = p->position->y - paddingY;
+        documentInfo->frameFirstNode = p->position->current;
+        documentInfo->frameLastNode = p->position->current;
+
+        for (int i = 0; i < paddingY + 1; i++)
+        {
+            moveFirstFrameLeft();
+        }
+        for (int i = 0; i < windowSize->y - 2 - paddingY; i++)
+        {
+            moveLastFrameRight();
+        }
+    }
+
+    print();
+    Node *node = p->position->current; // 정규식은 패턴이 아닌 찾은 글자를 그려야 함
+    int column = startColumn;
+    for (int i = 0; i < p->length;)
+    {
+        int width;
+        int length = nodeCharLength(node, column, &width);
+        if (width > 0 && column >= documentInfo->frameX && column + width <= documentInfo->frameX + windowSize->x - 1)
+        {
+            for (int j = 0; node->data == TAB && j < width; j++)
+                mvaddch(paddingY, column - documentInfo->frameX + j, ' ' | COLOR_PAIR(1));
+            if (node->data != TAB)
+                printChar(paddingY, column - documentInfo->frameX, node, length, COLOR_PAIR(1));
+        }
+        column += width;
+        i += length;
+        for (int j = 0; j < length; j++)
+            node = node->next;
+    }
+    move(windowSize->y - 1, textWidth(word, wordLength - 1));
+}
+
+void printFindMessageBar(char *word, int currentResultIndex, int resultCount)
+{
+    for (int i = 0; i < windowSize->x; i++)
+    {
+        mvaddch(windowSize->y - 1, i, ' ');
+    }
+    char rightMessage[120];
+    char countMessage[30];
+    if (resultCount < 0) // 아직 검색 중인 경우
+        sprintf(countMessage, "[%d/...]", currentResultIndex);
+    else
+        sprintf(countMessage, "[%d/%d]", currentResultIndex, resultCount);
+    sprintf(rightMessage, "%s%s%s%s | Arrows = move | Enter = edit | Esc = cancel | ^R regex ^T case ^W word",
+            countMessage, searchInfo->isRegex ? " regex" : "", searchInfo->isCaseInsensitive ? " nocase" : "",
+            searchInfo->isWholeWord ? " word" : "");
+
+    mvprintw(windowSize->y - 1, 0, "%s", word);
+    mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+    move(windowSize->y - 1, textWidth(word, strlen(word)));
+}
+
+int countFindResult(PNode *wordListHead)
+{
+    PNode *p = wordListHead;
+    int count = 0;
+    while (p->next != NULL) // 위의 원형 리스트에서 tail에서는 head로의 연결을 해놓지 않았기 때문에 null로 리스트의 끝을 알수 있음
+    {
+        count++;
+        p = p->next;
+    }
+    return count - 1;
+}
+
+void find(void)
+{
+    if(head->next == tail) {
+        for (int i = 0; i < windowSize->x; i++)
+        {
+            mvaddch(windowSize->y - 1, i, ' ');
+        }
+        mvprintw(windowSize->y - 1, 0, "There is no characters.");
+        move(position->y, position->x);
+        return;
+    }
+    char word[100];
+    for(int i=0;i<100;i++) {
+        word[i] = '\0';
+    }
+
+    printFindMessageBar(word, 0, 0);
+
+    // 포기시 원래위치
+    Position *tempPosition = position;
+    Node *tempFFN = documentInfo->frameFirstNode;
+    Node *tempFLN = documentInfo->frameLastNode;
+    int tempFX = documentInfo->frameX;
+    int tempFY = documentInfo->frameY;
+    int tempFR = documentInfo->frameRow;
+
+    PNode *wordListHead = (PNode *)malloc(sizeof(PNode));
+    PNode *highlightedWord;
+    int resultCount = 0;
+    int currentResultIndex = 0;
+    int wordIndex = 0;
+    int recentIndex = -1; // 위/아래 화살표로 불러온 최근 검색어
+
+
+    while (true)
+    {
+        int ch = getch();
+        if (ch == ENTER)
+        { // 현재 하이라이트되어있는 위치로 이동
+            if (resultCount == 0)
+                continue;
+            addRecentWord(word);
+            moveCursorTo(highlightedWord->position->y, highlightedWord->position->x + highlightedWord->length);
+            print();
+            break;
+        }
+        else if (ch == BACKSPACE || ch == KEY_BACKSPACE)
+        {
+            if(wordIndex == 0) continue;
+            wordIndex -= prevTextCharLength(word, wordIndex); // 여러 바이트짜리 글자는 한 번에 지움
+            word[wordIndex] = '\0';
+            wordListHead = searchDocument(word, showFirstResult);
+            resultCount = countFindResult(wordListHead);
+
+            if (wordIndex == 0 || resultCount == 0)
+            {
+                position = tempPosition;
+                documentInfo->frameFirstNode = tempFFN;
+                documentInfo->frameLastNode = tempFLN;
+                documentInfo->frameX = tempFX;
+                documentInfo->frameY = tempFY;
+                documentInfo->frameRow = tempFR;
+                print();
+                printFindMessageBar(word, 0, 0);
+            }
+            else
+            {
+                highlightedWord = wordListHead->next;
+                highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
+                printFindMessageBar(word, currentResultIndex, resultCount);
+            }
+        }
+        else if (ch == KEY_RIGHT)
+        {
+            if (resultCount == 0)
+                continue;
+            if (currentResultIndex == resultCount)
+            {
+                currentResultIndex = 1;
+                highlightedWord = wordListHead->next;
+            }
+            else
+            {
+                currentResultIndex++;
+                highlightedWord = highlightedWord->next;
+            }
+
+            highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
+            printFindMessageBar(word, currentResultIndex, resultCount);
+        }
+        else if (ch == KEY_LEFT)
+        {
+            if (resultCount == 0)
+                continue;
+            if (currentResultIndex == 1)
+            {
+                currentResultIndex = resultCount;
+                highlightedWord = wordListHead->prev->prev; // 위에서 언급한 반 원형 연결 리스트? 의 활용
+            }
+            else
+            {
+                currentResultIndex--;
+                highlightedWord = highlightedWord->prev;
+            }
+
+            highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
+            printFindMessageBar(word, currentResultIndex, resultCount);
+        }
+        else if (ch == CTRL('r') || ch == CTRL('t') || ch == CTRL('w') || ch == KEY_UP || ch == KEY_DOWN)
+        { // 정규식 / 대소문자 무시 / 단어 단위 모드 전환, 최근 검색어 불러오기
+            if (ch == KEY_UP || ch == KEY_DOWN)
+            {
+                int index = recentIndex + (ch == KEY_UP ? 1 : -1);
+                if (index < 0 || index >= searchInfo->recentCount)
+                    continue;
+                recentIndex = index;
+                strncpy(word, searchInfo->recentWords[index], 99);
+                wordIndex = strlen(word);
+            }
+            else if (ch == CTRL('r'))
+                searchInfo->isRegex = !searchInfo->isRegex;
+            else if (ch == CTRL('t'))
+                searchInfo->isCaseInsensitive = !searchInfo->isCaseInsensitive;
+            else
+                searchInfo->isWholeWord = !searchInfo->isWholeWord;
+            wordListHead = searchDocument(word, showFirstResult);
+            resultCount = countFindResult(wordListHead);
+            if (wordIndex == 0 || resultCount == 0)
+            {
+                currentResultIndex = 0;
+                position = tempPosition;
+                documentInfo->frameFirstNode = tempFFN;
+                documentInfo->frameLastNode = tempFLN;
+                documentInfo->frameX = tempFX;
+                documentInfo->frameY = tempFY;
+                documentInfo->frameRow = tempFR;
+                print();
+                printFindMessageBar(word, 0, 0);
+            }
+            else
+            {
+                currentResultIndex = 1;
+                highlightedWord = wordListHead->next;
+                highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
+                printFindMessageBar(word, 1, resultCount);
+            }
+        }
+        else if(ch == ESC) {
+            if (documentInfo->isWrapMode)
+                wrapScrollToCursor();
+            print();
+            break;
+        }
+        else
+        {
+            word[wordIndex] = ch;
+            wordIndex++;
+
+            wordListHead = searchDocument(word, showFirstResult);
+
+            resultCount = countFindResult(wordListHead);
+            if (wordIndex == 0 || resultCount == 0)
+            {
+                position = tempPosition;
+                documentInfo->frameFirstNode = tempFFN;
+                documentInfo->frameLastNode = tempFLN;
+                documentInfo->frameX = tempFX;
+                documentInfo->frameY = tempFY;
+                documentInfo->frameRow = tempFR;
+                print();
+                printFindMessageBar(word, 0, 0);
+            }
+            else
+            {
+                currentResultIndex = 1;
+                highlightedWord = wordListHead->next;
+                highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
+                printFindMessageBar(word, 1, resultCount);
+            }
+        }
+    }
+    free(wordListHead);
+}
+#endif
+
+EditBatch *createEditBatch(void)
+{
+    EditBatch *batch = (EditBatch *)malloc(sizeof(EditBatch));
+    batch->capacity = 4;
+    batch->edits = (Edit *)malloc(sizeof(Edit) * batch->capacity);
+    batch->count = 0;
+    batch->isTyping = false;
+    return batch;
+}
+
+void addEdit(EditBatch *batch, int line, int column, int oldLength, char *text, int length)
+{ // text는 복사해서 가지고 있음
+    if (batch->count == batch->capacity)
+    {
+        batch->capacity *= 2;
+        batch->edits = (Edit *)realloc(batch->edits, sizeof(Edit) * batch->capacity);
+    }
+    Edit *edit = &batch->edits[batch->count++];
+    edit->line = line;
+    edit->column = column;
+    edit->oldLength = oldLength;
+    edit->length = length;
+    edit->text = (char *)malloc(length + 1);
+    memcpy(edit->text, text, length);
+}
+
+void freeEditBatch(EditBatch *batch)
+{
+    for (int i = 0; i < batch->count; i++)
+        free(batch->edits[i].text);
+    free(batch->edits);
+    free(batch);
+}
+
+EditBatch *applyEdits(EditBatch *batch)
+{ // 문서를 한 번만 따라가면서 모든 편집을 적용하고, 되돌리기 위한 반대 편집 묶음을 돌려줌
+    EditBatch *inverse = createEditBatch();
+    if (batch->count == 0)
+        return inverse;
+    noteEdit(); // 블록 편집은 beforeEdit를 거치지 않음
+
+    // 첫 편집이 화면 아래에 있으면 화면의 시작부터 따라감 (frameFirstNode는 지워지지 않음)
+    bool isFromFrame = batch->edits[0].line >= documentInfo->frameY;
+    Node *p = isFromFrame ? documentInfo->frameFirstNode : head;
+    int oldLine = isFromFrame ? documentInfo->frameY : 0; // 편집 전 문서에서의 위치
+    int oldColumn = 0;
+    int newLine = oldLine; // 편집 후 문서에서의 위치
+    int newColumn = 0;
+    int delta = 0;         // newLine에 아직 알리지 않은 길이 변화
+    bool isEdited = false; // newLine을 고쳤는데 아직 알리지 않음 (길이가 같게 바꾼 경우도 있음)
+    int lineEdits = 0;     // 줄이 나뉘거나 합쳐진 횟수, 많으면 줄마다 캐시를 옮기는 대신 마지막에 한 번에 다시 만듦
+    bool isRebuildNeeded = false;
+    bool isWidthStale = false; // newLine의 칸 수를 줄 끝에서 다시 세야 하는지 (탭이나 아스키가 아닌 글자를 고친 경우)
+
+    for (int i = 0; i < batch->count; i++)
+    {
+        Edit *edit = &batch->edits[i];
+        while ((oldLine < edit->line || oldColumn < edit->column) && p->next != tail)
+        {
+            if (oldLine == edit->line && p->next->data == ENTER)
+                break; // 줄 끝을 넘는 칸은 줄 끝으로 봄
+            if (!isRebuildNeeded && (isEdited || isWidthStale) && p->next->data == ENTER)
+            {
+                if (isEdited)
+                    lineChanged(newLine, delta);
+                if (isWidthStale)
+                    layoutMeasureLine(newLine, lineStartOf(p));
+                delta = 0;
+                isEdited = false;
+                isWidthStale = false;
+            }
+            p = p->next;
+            if (p->data == ENTER)
+            {
+                oldLine++;
+                newLine++;
+                oldColumn = 0;
+                newColumn = 0;
+            }
+            else
+            {
+                oldColumn++;
+                newColumn++;
+            }
+        }
+
+        // 지울 글자들을 반대 편집에 넣어둠
+        char *deleted = (char *)malloc(edit->oldLength + 1);
+        int deletedCount = 0;
+        int editLine = newLine;
+        int editColumn = newColumn;
+        if (!isRebuildNeeded && !layoutIsPlainLine(newLine))
+            isWidthStale = true;
+        for (int j = 0; j < edit->oldLength && p->next != tail; j++)
+        {
+            Node *node = p->next;
+            detachClipboardAt(newLine, newLine);
+            deleted[deletedCount++] = (char)node->data;
+            if (node->data >= 0x80 || node->data == TAB)
+                isWidthStale = true;
+            p->next = node->next;
+            node->next->prev = p;
+            if (node->data == ENTER)
+            { // 다음 줄이 지금 줄에 합쳐짐
+                if (!isRebuildNeeded)
+                {
+                    lineChanged(newLine, delta);
+                    delta = 0;
+                    isEdited = false;
+                    lineJoined(newLine + 1);
+                    if (!layoutIsPlainLine(newLine))
+                        isWidthStale = true; // 아랫줄에 탭이나 아스키가 아닌 글자가 있었음
+                }
+                documentInfo->lineCount--;
+                if (++lineEdits > LINE_EDITS_BEFORE_REBUILD && !isRebuildNeeded)
+                { // 한 편집이 여러 줄에 걸쳐도 줄마다 캐시를 옮기지 않음, 아래쪽 클립보드의 줄 번호도 더는 옮기지 못함
+                    isRebuildNeeded = true;
+                    detachClipboardAt(newLine, INT_MAX);
+                }
+                oldLine++;
+                oldColumn = 0;
+            }
+            else
+            {
+                delta--;
+                isEdited = true;
+                oldColumn++;
+            }
+            freeNode(node);
+        }
+
+        for (int j = 0; j < edit->length; j++)
+        {
+            detachClipboardAt(newLine, newLine);
+            Node *node = newNode(edit->text[j]);
+            node->prev = p;
+            node->next = p->next;
+            p->next->prev = node;
+            p->next = node;
+            p = node;
+            if (node->data >= 0x80 || node->data == TAB)
+                isWidthStale = true;
+            if (node->data == ENTER)
+            {
+                if (!isRebuildNeeded)
+                {
+                    lineChanged(newLine, delta);
+                    delta = 0;
+                    isEdited = false;
+                    bool isPlain = !isWidthStale && layoutIsPlainLine(newLine);
+                    lineSplit(newLine, newColumn);
+                    if (!isPlain)
+                    { // 나뉜 윗줄은 끝났으므로 바로 세고, 아랫줄은 줄 끝에서 셈
+                        layoutMeasureLine(newLine, lineStartOf(node->prev));
+                        isWidthStale = true;
+                    }
+                }
+                documentInfo->lineCount++;
+                if (++lineEdits > LINE_EDITS_BEFORE_REBUILD && !isRebuildNeeded)
+                {
+                    isRebuildNeeded = true;
+                    detachClipboardAt(newLine, INT_MAX);
+                }
+                newLine++;
+                newColumn = 0;
+            }
+            else
+            {
+                delta++;
+                isEdited = true;
+                newColumn++;
+            }
+        }
+        addEdit(inverse, editLine, editColumn, edit->length, deleted, deletedCount);
+        free(deleted);
+    }
+    if (isRebuildNeeded)
+    {
+        markLineResized(batch->edits[0].line); // 줄마다 알리지 않은 편집이 있음
+        rebuildLineCaches();
+    }
+    else
+    {
+        if (isEdited)
+            lineChanged(newLine, delta);
+        if (isWidthStale)
+            layoutMeasureLine(newLine, lineStartOf(p));
+    }
+
+    if (!isFromFrame)
+    { // 화면의 시작 노드가 지워졌을 수 있으므로 다시 찾음
+        if (documentInfo->frameY > documentInfo->lineCount - 1)
+            documentInfo->frameY = documentInfo->lineCount - 1;
+        documentInfo->frameFirstNode = head;
+        for (int i = 0; i < documentInfo->frameY; i++)
+            moveFirstFrameRight();
+        documentInfo->frameRow = 0;
+    }
+    moveCursorTo(newLine, newColumn);
+    fileInfo->isUpdated = true;
+    return inverse;
+}
+
+void rebuildLineCaches(void)
+{ // 문서 전체를 한 번 따라가면서 줄 길이를 다시 세고 문법 강조 상태를 처음부터 계산하게 함
+    for (int i = 0; i < layoutInfo->lineCount; i++)
+        layoutFreeColumnMap(i);
+    layoutInfo->lineCount = 0;
+    layoutAppendLine();
+    if (trigramInfo->isEnabled)
+        resetTrigramBlocks();
+    resetBracketIndex();
+    int hashCapacity = diffInfo->isEnabled ? documentInfo->lineCount + 1 : 0; // 디스크와 다시 비교할 줄 해시도 같이 구함
+    unsigned long long *hashes = diffInfo->isEnabled ? (unsigned long long *)malloc(sizeof(unsigned long long) * hashCapacity) : NULL;
+    unsigned long long hash = DIFF_HASH_START;
+    for (Node *p = head->next; p != tail; p = p->next)
+    {
+        if (p->data == ENTER)
+        {
+            if (trigramInfo->isEnabled)
+                trigramAppendLine(p, layoutInfo->lineLengths[layoutInfo->lineCount - 1]);
+            if (hashes != NULL)
+            {
+                if (layoutInfo->lineCount == hashCapacity)
+                {
+                    hashCapacity *= 2;
+                    hashes = (unsigned long long *)realloc(hashes, sizeof(unsigned long long) * hashCapacity);
+                }
+                hashes[layoutInfo->lineCount - 1] = hash;
+                hash = DIFF_HASH_START;
             }
-            else if (ch == BACKSPACE)
-            { // 파일 이름 backspace
-                for (int i = 0; i < index; i++)
+            layoutAppendLine();
+        }
+        else
+        {
+            hash = (hash ^ p->data) * DIFF_HASH_PRIME;
+            int line = layoutInfo->lineCount - 1;
+            layoutInfo->lineLengths[line]++;
+            layoutInfo->lineWidths[line] += feedUtf8(&layoutInfo->decoder, p->data, layoutInfo->lineWidths[line]);
+            if (p->data >= 0x80 || p->data == TAB)
+                layoutInfo->columnMaps[line] = &unmeasuredColumnMap;
+        }
+        if (p->next == tail || p->next->data == ENTER)
+            layoutInfo->lineWidths[layoutInfo->lineCount - 1] += flushUtf8(&layoutInfo->decoder);
+    }
+    if (trigramInfo->isEnabled)
+        trigramInfo->blocks[trigramInfo->blockCount - 1]->lineCount++; // 마지막 줄
+    documentInfo->lineCount = layoutInfo->lineCount;
+    resetSyntaxStates();
+    if (hashes != NULL)
+    { // 줄의 짝을 하나씩 옮기지 않고 디스크의 해시와 다시 비교함
+        if (layoutInfo->lineCount > hashCapacity)
+            hashes = (unsigned long long *)realloc(hashes, sizeof(unsigned long long) * layoutInfo->lineCount);
+        hashes[layoutInfo->lineCount - 1] = hash;
+        runDiff(hashes);
+    }
+}
+
+Node *findLineStart(int line)
+{ // line 앞의 줄바꿈(또는 head), frameFirstNode부터 따라감
+    Node *lineStart = documentInfo->frameFirstNode;
+    for (int i = documentInfo->frameY; i < line; i++)
+    {
+        lineStart = lineStart->next;
+        while (lineStart->data != ENTER)
+            lineStart = lineStart->next;
+    }
+    for (int i = documentInfo->frameY; i > line; i--)
+    {
+        lineStart = lineStart->prev;
+        while (lineStart->data != ENTER && lineStart != head)
+            lineStart = lineStart->prev;
+    }
+    return lineStart;
+}
+
+void moveCursorTo(int line, int column)
+{ // 커서를 (line, column)으로 옮기고 커서가 보이도록 frame을 맞춤
+    moveCursorToLine(line, findLineStart(line), column);
+}
+
+void moveCursorToLine(int line, Node *lineStart, int column)
+{ // 줄의 시작 노드를 이미 아는 경우 frame에서부터 줄을 따라가지 않음
+    int height = windowSize->y - 2;
+    position->current = lineStart;
+    for (int i = 0; i < column; i++)
+        position->current = position->current->next;
+    int display = displayOfColumn(line, lineStart, column);
+
+    if (documentInfo->isWrapMode)
+    {
+        documentInfo->cursorLine = line;
+        documentInfo->cursorColumn = column;
+        documentInfo->cursorDisplayColumn = display;
+        updateLayout();
+        if (documentInfo->frameRow >= layoutLineRows(documentInfo->frameY))
+            documentInfo->frameRow = 0;
+        wrapScrollToCursor();
+        resetFrameLastNode();
+        return;
+    }
+
+    if (line < documentInfo->frameY || line >= documentInfo->frameY + height)
+    { // 커서가 화면 밖이면 커서의 줄이 화면 가운데에 오도록 함
+        int top = line > height / 2 ? line - height / 2 : 0;
+        documentInfo->frameFirstNode = lineStart;
+        for (int i = line; i > top; i--)
+            moveFirstFrameLeft();
+        documentInfo->frameY = top;
+    }
+    resetFrameLastNode();
+
+    if (display < documentInfo->frameX || display > documentInfo->frameX + windowSize->x - 2)
+        documentInfo->frameX = display > windowSize->x - 2 ? display - (windowSize->x - 2) : 0;
+    position->x = display - documentInfo->frameX;
+    position->y = line - documentInfo->frameY;
+}
+
+void pushUndo(EditBatch *batch)
+{
+    if (undoInfo->count == undoInfo->capacity)
+    {
+        undoInfo->capacity *= 2;
+        undoInfo->batches = (EditBatch **)realloc(undoInfo->batches, sizeof(EditBatch *) * undoInfo->capacity);
+    }
+    undoInfo->batches[undoInfo->count++] = batch;
+}
+
+void recordInsert(int key)
+{ // 글자를 넣기 전에 되돌리기 위한 편집(넣은 글자를 지움)을 기록함
+    int line = currentLineIndex();
+    int column = currentColumn();
+    if (undoInfo->count > 0 && key != ENTER)
+    {
+        EditBatch *top = undoInfo->batches[undoInfo->count - 1];
+        Edit *edit = &top->edits[0];
+        if (top->isTyping && edit->length == 0 && edit->line == line && edit->column + edit->oldLength == column)
+        { // 바로 앞에 친 글자에 이어서 침
+            edit->oldLength++;
+            return;
+        }
+    }
+    EditBatch *batch = createEditBatch();
+    addEdit(batch, line, column, 1, "", 0);
+    batch->isTyping = key != ENTER;
+    pushUndo(batch);
+}
+
+void recordBackspace(void)
+{ // 글자를 지우기 전에 되돌리기 위한 편집(지운 글자를 다시 넣음)을 기록함
+    if (position->current == head)
+        return;
+    char deleted = (char)position->current->data;
+    int line = currentLineIndex();
+    int column = currentColumn() - 1;
+    if (deleted == ENTER)
+    { // 윗줄의 끝에 있는 줄바꿈을 지움
+        line--;
+        column = layoutInfo->lineLengths[line];
+    }
+    if (undoInfo->count > 0 && deleted != ENTER)
+    {
+        EditBatch *top = undoInfo->batches[undoInfo->count - 1];
+        Edit *edit = &top->edits[0];
+        if (top->isTyping && edit->oldLength == 0 && edit->line == line && edit->column == column + 1)
+        { // 바로 앞에서 지운 글자의 앞 글자를 지움
+            edit->text = (char *)realloc(edit->text, edit->length + 2);
+            memmove(edit->text + 1, edit->text, edit->length);
+            edit->text[0] = deleted;
+            edit->length++;
+            edit->column--;
+            return;
+        }
+    }
+    EditBatch *batch = createEditBatch();
+    addEdit(batch, line, column, 0, &deleted, 1);
+    batch->isTyping = deleted != ENTER;
+    pushUndo(batch);
+}
+
+bool undoEdits(void)
+{ // 마지막 편집 묶음을 되돌림 (화면은 그리지 않음), 되돌릴 것이 없으면 false
+    if (undoInfo->count == 0)
+        return false;
+    beforeEdit();
+    EditBatch *batch = undoInfo->batches[--undoInfo->count];
+    freeEditBatch(applyEdits(batch));
+    freeEditBatch(batch);
+    return true;
+}
+
+#ifndef VITE_LIBRARY
+void undo(void)
+{
+    if (!undoEdits())
+    {
+        printMessage("Nothing to undo.");
+        return;
+    }
+    print();
+}
+
+void toggleSelection(bool isBlock)
+{ // 커서 위치에 선택 시작점을 찍거나 선택을 취소함
+    selectionInfo->isSelecting = !selectionInfo->isSelecting;
+    selectionInfo->isBlock = selectionInfo->isSelecting && isBlock;
+    if (selectionInfo->isSelecting)
+    {
+        int line = currentLineIndex();
+        selectionInfo->markLine = line;
+        selectionInfo->markColumn = currentColumn();
+        selectionInfo->markDisplay = currentDisplayColumn(line);
+        selectionInfo->markNode = position->current;
+        selectionInfo->pendingLength = 0;
+    }
+    print();
+}
+#endif
+
+void updateSelectionRange(void)
+{ // 시작점과 커서 중 앞쪽을 start로 둠, 선택 중이 아니면 빈 영역
+    if (!selectionInfo->isSelecting)
+    {
+        selectionInfo->startLine = selectionInfo->endLine = -1;
+        selectionInfo->startColumn = selectionInfo->endColumn = 0;
+        return;
+    }
+    int line = currentLineIndex();
+    int column = currentColumn();
+    if (selectionInfo->markLine < line || (selectionInfo->markLine == line && selectionInfo->markColumn < column))
+    {
+        selectionInfo->startLine = selectionInfo->markLine;
+        selectionInfo->startColumn = selectionInfo->markColumn;
+        selectionInfo->endLine = line;
+        selectionInfo->endColumn = column;
+    }
+    else
+    {
+        selectionInfo->startLine = line;
+        selectionInfo->startColumn = column;
+        selectionInfo->endLine = selectionInfo->markLine;
+        selectionInfo->endColumn = selectionInfo->markColumn;
+    }
+    if (selectionInfo->isBlock)
+    { // 사각형 선택은 줄 범위와 화면상의 칸 범위로 봄
+        int display = currentDisplayColumn(line);
+        selectionInfo->leftDisplay = display < selectionInfo->markDisplay ? display : selectionInfo->markDisplay;
+        selectionInfo->rightDisplay = display < selectionInfo->markDisplay ? selectionInfo->markDisplay : display;
+    }
+}
+
+bool isSelected(int line, int column, int display)
+{
+    if (selectionInfo->isBlock)
+    { // 폭이 0인 블록은 줄마다 커서 위치의 칸을 칠해서 보여줌
+        int right = selectionInfo->rightDisplay > selectionInfo->leftDisplay ? selectionInfo->rightDisplay : selectionInfo->leftDisplay + 1;
+        return line >= selectionInfo->startLine && line <= selectionInfo->endLine &&
+               display >= selectionInfo->leftDisplay && display < right;
+    }
+    if (line < selectionInfo->startLine || line > selectionInfo->endLine)
+        return false;
+    if (line == selectionInfo->startLine && column < selectionInfo->startColumn)
+        return false;
+    if (line == selectionInfo->endLine && column >= selectionInfo->endColumn)
+        return false;
+    return true;
+}
+
+int selectionLength(void)
+{ // 선택 영역의 바이트 수, 줄 길이 캐시로 세므로 노드를 따라가지 않음
+    if (selectionInfo->startLine == selectionInfo->endLine)
+        return selectionInfo->endColumn - selectionInfo->startColumn;
+    int length = layoutInfo->lineLengths[selectionInfo->startLine] - selectionInfo->startColumn + 1;
+    for (int line = selectionInfo->startLine + 1; line < selectionInfo->endLine; line++)
+        length += layoutInfo->lineLengths[line] + 1;
+    return length + selectionInfo->endColumn;
+}
+
+#ifndef VITE_LIBRARY
+void copySelection(void)
+{ // 선택 영역의 첫 노드와 길이만 기억하므로 선택 영역의 크기와 상관없이 바로 끝남
+    if (!selectionInfo->isSelecting)
+        return;
+    updateSelectionRange();
+    if (selectionInfo->isBlock)
+    { // 사각형 선택은 줄마다 떨어져 있으므로 바이트로 복사함
+        free(selectionInfo->clipboardText);
+        selectionInfo->clipboardFirst = NULL;
+        selectionInfo->clipboardText = blockText(&selectionInfo->clipboardLength);
+        selectionInfo->isSelecting = false;
+        selectionInfo->isBlock = false;
+        print();
+        printMessage("Copied.");
+        return;
+    }
+    Node *start = selectionInfo->startLine == selectionInfo->markLine && selectionInfo->startColumn == selectionInfo->markColumn
+                      ? selectionInfo->markNode
+                      : position->current;
+    free(selectionInfo->clipboardText);
+    selectionInfo->clipboardText = NULL;
+    selectionInfo->clipboardFirst = start->next;
+    selectionInfo->clipboardLength = selectionLength();
+    selectionInfo->clipboardFirstLine = selectionInfo->startLine;
+    selectionInfo->clipboardLastLine = selectionInfo->endLine;
+    selectionInfo->isSelecting = false;
+    print();
+    printMessage("Copied.");
+}
+
+void cutSelection(void)
+{ // 선택 영역을 한 번의 편집으로 지우고, 지운 내용을 클립보드에 넣음
+    if (!selectionInfo->isSelecting)
+        return;
+    updateSelectionRange();
+    if (selectionInfo->isBlock)
+    {
+        free(selectionInfo->clipboardText);
+        selectionInfo->clipboardFirst = NULL;
+        selectionInfo->clipboardText = blockText(&selectionInfo->clipboardLength);
+        applyBlockEdits("", 0, false);
+        beforeEdit();
+        print();
+        return;
+    }
+    int length = selectionLength();
+    beforeEdit();
+    if (length == 0)
+    {
+        print();
+        return;
+    }
+    EditBatch *batch = createEditBatch();
+    addEdit(batch, selectionInfo->startLine, selectionInfo->startColumn, length, "", 0);
+    EditBatch *inverse = applyEdits(batch);
+    freeEditBatch(batch);
+    free(selectionInfo->clipboardText);
+    selectionInfo->clipboardFirst = NULL;
+    selectionInfo->clipboardText = (char *)malloc(length + 1);
+    memcpy(selectionInfo->clipboardText, inverse->edits[0].text, inverse->edits[0].length);
+    selectionInfo->clipboardLength = inverse->edits[0].length;
+    pushUndo(inverse);
+    print();
+}
+
+void paste(void)
+{ // 클립보드 내용을 커서 위치에 한 번의 편집으로 넣음 (되돌리기는 넣은 만큼 지우기만 함)
+    if (selectionInfo->clipboardFirst == NULL && selectionInfo->clipboardText == NULL)
+        return;
+    beforeEdit();
+    if (selectionInfo->clipboardFirst != NULL)
+    { // 문서를 가리키는 클립보드는 넣는 동안만 바이트로 복사함
+        // 노드가 한 바이트씩이므로 넣을 때는 어차피 바이트마다 노드를 만듦 (청크로 된 노드는 readme의 할 일)
+        char *text = clipboardBytes();
+        spliceText(currentLineIndex(), currentColumn(), 0, text, selectionInfo->clipboardLength);
+        free(text);
+    }
+    else
+        spliceText(currentLineIndex(), currentColumn(), 0, selectionInfo->clipboardText, selectionInfo->clipboardLength);
+    print();
+}
+#endif
+
+void spliceText(int line, int column, int oldLength, char *text, int length)
+{ // (line, column)부터 oldLength 바이트를 text로 바꾸는 편집 하나를 적용하고 되돌리기에 넣음
+    EditBatch *batch = createEditBatch();
+    addEdit(batch, line, column, oldLength, text, length);
+    pushUndo(applyEdits(batch));
+    freeEditBatch(batch);
+}
+
+int documentLineCount(void)
+{
+    return documentInfo->lineCount;
+}
+
+int copyLine(int line, char *text, int capacity)
+{ // 줄의 바이트를 최대 capacity만큼 복사함 (줄바꿈은 빼고), 줄의 전체 길이를 돌려줌
+    int length = layoutInfo->lineLengths[line];
+    Node *p = findLineStart(line)->next;
+    for (int i = 0; i < length && i < capacity; i++)
+    {
+        text[i] = (char)p->data;
+        p = p->next;
+    }
+    return length;
+}
+
+char *clipboardBytes(void)
+{ // 클립보드가 가리키는 구간의 바이트를 복사함
+    char *text = (char *)malloc(selectionInfo->clipboardLength + 1);
+    Node *p = selectionInfo->clipboardFirst;
+    for (int i = 0; i < selectionInfo->clipboardLength; i++)
+    {
+        text[i] = (char)p->data;
+        p = p->next;
+    }
+    return text;
+}
+
+void detachClipboard(void)
+{ // 클립보드가 가리키는 구간이 바뀌기 전에 바이트로 복사해둠
+    if (selectionInfo->clipboardFirst == NULL)
+        return;
+    selectionInfo->clipboardText = clipboardBytes();
+    selectionInfo->clipboardFirst = NULL;
+}
+
+void detachClipboardAt(int first, int last)
+{ // [first, last] 줄을 고치기 전에 부름, 클립보드 구간이 걸친 줄과 겹칠 때만 복사해둠
+    if (selectionInfo->clipboardFirst != NULL && first <= selectionInfo->clipboardLastLine &&
+        last >= selectionInfo->clipboardFirstLine)
+        detachClipboard();
+}
+
+void clipboardLineSplit(int line)
+{ // 클립보드 구간 위에서 줄이 나뉘면 구간의 줄 번호만 옮김 (구간의 줄을 고치는 편집은 그 전에 복사해둠)
+    if (line < selectionInfo->clipboardFirstLine)
+    {
+        selectionInfo->clipboardFirstLine++;
+        selectionInfo->clipboardLastLine++;
+    }
+}
+
+void clipboardLineJoined(int line)
+{
+    if (line <= selectionInfo->clipboardFirstLine)
+    {
+        selectionInfo->clipboardFirstLine--;
+        selectionInfo->clipboardLastLine--;
+    }
+}
+
+void beforeEdit(void)
+{ // 문서를 바꾸는 키는 선택을 끝냄, 커서에서 바로 넣고 지우는 키는 커서 줄(백스페이스는 윗줄까지)이 클립보드와 겹칠 때만 복사해둠
+    selectionInfo->isSelecting = false;
+    selectionInfo->isBlock = false;
+    int line = currentLineIndex();
+    detachClipboardAt(line - 1, line);
+    noteEdit();
+}
+
+#ifndef VITE_LIBRARY
+void printMessage(char *message)
+{ // 메세지 줄에 알림을 띄움, 다음에 화면을 그릴 때 지워짐
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 1, i, ' ');
+    mvprintw(windowSize->y - 1, 0, "%s", message);
+    move(position->y, position->x);
+}
+
+char *blockText(int *length)
+{ // 사각형 선택의 줄마다 [left, right) 칸의 글자를 줄바꿈으로 이어 붙임
+    int capacity = 64;
+    char *text = (char *)malloc(capacity);
+    *length = 0;
+    Node *p = findLineStart(selectionInfo->startLine);
+    for (int line = selectionInfo->startLine; line <= selectionInfo->endLine; line++)
+    {
+        int reached;
+        int column = columnOfDisplay(line, p, selectionInfo->leftDisplay, &reached);
+        int end = columnOfDisplay(line, p, selectionInfo->rightDisplay, &reached);
+        while (*length + end - column + 1 > capacity)
+        {
+            capacity *= 2;
+            text = (char *)realloc(text, capacity);
+        }
+        for (int i = 0; i < column; i++)
+            p = p->next;
+        for (int i = column; i < end; i++)
+        {
+            p = p->next;
+            text[(*length)++] = (char)p->data;
+        }
+        if (line < selectionInfo->endLine)
+            text[(*length)++] = '\n';
+        for (int i = end; i <= layoutInfo->lineLengths[line]; i++) // 다음 줄의 앞 줄바꿈까지 감
+            p = p->next;
+    }
+    return text;
+}
+
+void applyBlockEdits(char *text, int length, bool isBackspace)
+{ // 블록의 줄마다 [left, right) 칸을 text로 바꾸는 편집을 모아서 한 번에 적용함, 폭이 0이고 isBackspace면 왼쪽 글자를 지움
+    updateSelectionRange();
+    int cursorLine = currentLineIndex();
+    int cursorColumn = -1; // 커서가 있는 줄의 편집 뒤 바이트 위치
+    Node *cursorLineStart = NULL;
+    EditBatch *batch = createEditBatch();
+    Node *lineStart = findLineStart(selectionInfo->startLine);
+    for (int line = selectionInfo->startLine; line <= selectionInfo->endLine; line++)
+    {
+        if (layoutInfo->lineWidths[line] >= selectionInfo->leftDisplay)
+        { // 블록 왼쪽까지 닿지 않는 짧은 줄은 건너뜀
+            int reached;
+            int column = columnOfDisplay(line, lineStart, selectionInfo->leftDisplay, &reached);
+            int end = columnOfDisplay(line, lineStart, selectionInfo->rightDisplay, &reached);
+            if (isBackspace && end == column && column > 0)
+                column -= charLengthBefore(line, lineStart, column);
+            if (end > column || length > 0)
+            {
+                addEdit(batch, line, column, end - column, text, length);
+                if (line == cursorLine)
                 {
-                    mvprintw(windowSize->y - 1, i, " ");
+                    cursorColumn = column + length;
+                    cursorLineStart = lineStart;
                 }
-                index--;
-                newFilename[index] = '\0';
-                mvprintw(windowSize->y - 1, 0, newFilename);
             }
-            else if (ch == ESC) {
+        }
+        if (line < selectionInfo->endLine)
+        {
+            for (int i = 0; i <= layoutInfo->lineLengths[line]; i++)
+                lineStart = lineStart->next;
+        }
+    }
+    if (batch->count == 0)
+    {
+        freeEditBatch(batch);
+        return;
+    }
+    pushUndo(applyEdits(batch));
+    freeEditBatch(batch);
+
+    // 블록의 폭을 0으로 하고 커서 줄의 편집한 곳 뒤로 옮김 (줄바꿈은 지우지 않으므로 cursorLineStart는 그대로 있음)
+    int cursorDisplay = selectionInfo->leftDisplay;
+    if (cursorColumn >= 0)
+    {
+        cursorDisplay = displayOfColumn(cursorLine, cursorLineStart, cursorColumn);
+        moveCursorTo(cursorLine, cursorColumn);
+    }
+    selectionInfo->markDisplay = cursorDisplay;
+}
+
+bool blockKey(int key)
+{ // 사각형 선택 중에 친 글자와 백스페이스를 블록의 모든 줄에 적용함, 처리하지 않는 키는 false
+    if (key == BACKSPACE || key == KEY_BACKSPACE)
+    {
+        applyBlockEdits("", 0, true);
+        print();
+        return true;
+    }
+    if (key > UCHAR_MAX || key == ENTER || key == ESC || (key < ' ' && key != TAB))
+        return false;
+    // 여러 바이트짜리 글자는 바이트가 다 모인 뒤에 넣음
+    selectionInfo->pending[selectionInfo->pendingLength++] = (char)key;
+    int length = utf8Length((unsigned char)selectionInfo->pending[0]);
+    if (selectionInfo->pendingLength < length)
+        return true;
+    applyBlockEdits(selectionInfo->pending, selectionInfo->pendingLength, false);
+    selectionInfo->pendingLength = 0;
+    print();
+    return true;
+}
+
+void insertFile(void)
+{ // 파일을 청크로 읽어서(압축된 파일은 풀면서) 모은 뒤 커서 위치에 한 번에 넣음
+    char filename[256] = "";
+    if (!readPrompt("Insert file: ", filename, sizeof(filename)) || filename[0] == '\0')
+    {
+        print();
+        return;
+    }
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        print();
+        printMessage("Cannot open file.");
+        return;
+    }
+    int length;
+    bool isFailed;
+    char *text = readWholeFile(file, filename, &length, &isFailed);
+
+    beforeEdit();
+    spliceText(currentLineIndex(), currentColumn(), 0, text, length);
+    free(text);
+    print();
+    char message[100];
+    sprintf(message, isFailed ? "Cannot read file completely. (%d bytes inserted)" : "Inserted %d bytes.", length);
+    printMessage(message);
+}
+#endif
+
+char *readWholeFile(FILE *file, char *filename, int *length, bool *isFailed)
+{ // 파일을 청크로 읽어서(압축된 파일은 풀면서) 모으고 파일을 닫음, int에 들어가지 않는 부분은 버림
+    FileReader *reader = openFileReader(file, filename, detectCompression(file));
+    int capacity = READ_CHUNK_SIZE;
+    char *text = (char *)malloc(capacity);
+    bool isTooLong = false;
+    *length = 0;
+    ReadChunk *chunk;
+    while ((chunk = nextReadChunk(reader)) != NULL)
+    {
+        while (!isTooLong && *length + chunk->length > capacity)
+        {
+            if (capacity > INT_MAX / 2)
+                isTooLong = true; // 압축 해제 쓰레드가 멈추지 않도록 나머지는 읽어서 버림
+            else
+            {
+                capacity *= 2;
+                text = (char *)realloc(text, capacity);
+            }
+        }
+        if (!isTooLong)
+        {
+            memcpy(text + *length, chunk->data, chunk->length);
+            *length += chunk->length;
+        }
+        releaseReadChunk(reader);
+    }
+    *isFailed = closeFileReader(reader) || isTooLong;
+    return text;
+}
+
+void *writeFilterInput(void *arg)
+{ // 외부 명령이 출력을 다 읽히기 전에 입력이 막히지 않도록 다른 쓰레드에서 씀
+    FilterInput *input = (FilterInput *)arg;
+    int written = 0;
+    while (written < input->length)
+    {
+        ssize_t result = write(input->fd, input->text + written, input->length - written);
+        if (result <= 0)
+            break; // 명령이 입력을 다 읽지 않고 끝난 경우
+        written += result;
+    }
+    close(input->fd);
+    return NULL;
+}
+
+#ifndef VITE_LIBRARY
+void filterLines(void)
+{ // 선택한 줄들(선택이 없으면 문서 전체)을 외부 명령에 넣고 출력으로 바꿈, 출력을 받는 동안에도 Esc로 취소할 수 있음
+#ifdef WINDOWS
+    printMessage("Filter is not supported on this platform.");
+#else
+    char command[256] = "";
+    if (!readPrompt("Filter through: ", command, sizeof(command)) || command[0] == '\0')
+    {
+        print();
+        return;
+    }
+    int startLine = 0;
+    int endLine = documentInfo->lineCount - 1;
+    if (endLine > 0 && layoutInfo->lineLengths[endLine] == 0)
+        endLine--; // 파일 끝의 줄바꿈 뒤 빈 줄은 넣지 않음
+    if (selectionInfo->isSelecting)
+    {
+        updateSelectionRange();
+        startLine = selectionInfo->startLine;
+        endLine = selectionInfo->endLine;
+    }
+    beforeEdit();
+
+    // 줄들을 입력으로 복사함 (마지막 줄에도 줄바꿈을 붙임)
+    int length = endLine - startLine;
+    for (int line = startLine; line <= endLine; line++)
+        length += layoutInfo->lineLengths[line];
+    FilterInput input;
+    input.text = (char *)malloc(length + 1);
+    input.length = length + 1;
+    Node *p = findLineStart(startLine);
+    for (int i = 0; i < length; i++)
+    {
+        p = p->next;
+        input.text[i] = (char)p->data;
+    }
+    input.text[length] = '\n';
+
+    int inputPipe[2];
+    int outputPipe[2];
+    if (pipe(inputPipe) != 0 || pipe(outputPipe) != 0)
+    {
+        free(input.text);
+        print();
+        printMessage("Cannot run command.");
+        return;
+    }
+    signal(SIGPIPE, SIG_IGN); // 명령이 입력을 다 읽지 않고 끝나도 편집기는 죽지 않음
+    pid_t child = fork();
+    if (child == 0)
+    {
+        dup2(inputPipe[0], STDIN_FILENO);
+        dup2(outputPipe[1], STDOUT_FILENO);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        close(inputPipe[0]);
+        close(inputPipe[1]);
+        close(outputPipe[0]);
+        close(outputPipe[1]);
+        execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+        _exit(127);
+    }
+    close(inputPipe[0]);
+    close(outputPipe[1]);
+    input.fd = inputPipe[1];
+    pthread_t writer;
+    bool isWriterStarted = child > 0 && pthread_create(&writer, NULL, writeFilterInput, &input) == 0;
+    if (!isWriterStarted)
+        close(inputPipe[1]);
+
+    // 출력과 키 입력을 함께 기다림
+    int capacity = READ_CHUNK_SIZE;
+    int outputLength = 0;
+    char *output = (char *)malloc(capacity);
+    bool isCanceled = child < 0;
+    double lastMessageTime = 0;
+    while (!isCanceled)
+    {
+        struct pollfd fds[2] = {{outputPipe[0], POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        poll(fds, 2, 100);
+        if (fds[1].revents & POLLIN)
+        {
+            nodelay(stdscr, TRUE);
+            int key = getch();
+            nodelay(stdscr, FALSE);
+            if (key == ESC)
+            {
+                kill(child, SIGTERM);
+                isCanceled = true;
+                break;
+            }
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP))
+        {
+            if (outputLength + READ_CHUNK_SIZE > capacity)
+            {
+                capacity *= 2;
+                output = (char *)realloc(output, capacity);
+            }
+            ssize_t result = read(outputPipe[0], output + outputLength, capacity - outputLength);
+            if (result <= 0)
+                break;
+            outputLength += result;
+        }
+        if (currentTimeMs() - lastMessageTime > 100)
+        {
+            char message[100];
+            snprintf(message, sizeof(message), "Filtering through %.40s: %d bytes | Esc = cancel", command, outputLength);
+            printMessage(message);
+            refresh();
+            lastMessageTime = currentTimeMs();
+        }
+    }
+    close(outputPipe[0]);
+    if (isWriterStarted)
+        pthread_join(writer, NULL);
+    int status = 0;
+    if (child > 0)
+        waitpid(child, &status, 0);
+    free(input.text);
+
+    if (!isCanceled && WIFEXITED(status) && WEXITSTATUS(status) == 0)
+    { // 마지막 줄바꿈은 입력에 붙인 것이므로 뺌
+        if (outputLength > 0 && output[outputLength - 1] == '\n')
+            outputLength--;
+        spliceText(startLine, 0, length, output, outputLength);
+        print();
+    }
+    else
+    {
+        print();
+        char message[100];
+        if (isCanceled)
+            sprintf(message, "Filter canceled.");
+        else
+            sprintf(message, "Command failed. (status %d)", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+        printMessage(message);
+    }
+    free(output);
+#endif
+}
+
+void lineOperationMenu(void)
+{ // Ctrl-L 다음에 누른 키로 줄 연산을 고름, 선택한 줄들(선택이 없으면 문서 전체)에 적용함
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 1, i, ' ');
+    mvprintw(windowSize->y - 1, 0, "Lines: S = sort | U = unique | K = keep matching | D = drop matching | Esc = cancel");
+    int ch = getch();
+    if (ch == 's' || ch == 'S')
+        runLineOperation(LINE_SORT, NULL);
+    else if (ch == 'u' || ch == 'U')
+        runLineOperation(LINE_UNIQUE, NULL);
+    else if (ch == 'k' || ch == 'K' || ch == 'd' || ch == 'D')
+    {
+        bool isKeep = ch == 'k' || ch == 'K';
+        char word[100] = "";
+        char *message = isKeep ? (searchInfo->isRegex ? "Keep lines matching regex: " : "Keep lines containing: ")
+                               : (searchInfo->isRegex ? "Drop lines matching regex: " : "Drop lines containing: ");
+        if (readPrompt(message, word, sizeof(word)) && word[0] != '\0')
+            runLineOperation(isKeep ? LINE_KEEP : LINE_DROP, word);
+        else
+            print();
+    }
+    else
+        print();
+}
+
+void runLineOperation(int type, char *word)
+{ // 줄들을 한 번 따라가면서 노드 구간을 기록하고, 남는 줄들의 노드를 새 순서로 다시 이어서 결과 문서를 만듦
+    int startLine = 0;
+    int endLine = documentInfo->lineCount - 1;
+    if (endLine > 0 && layoutInfo->lineLengths[endLine] == 0)
+        endLine--; // 파일 끝의 줄바꿈 뒤 빈 줄은 넣지 않음
+    if (selectionInfo->isSelecting)
+    {
+        updateSelectionRange();
+        startLine = selectionInfo->startLine;
+        endLine = selectionInfo->endLine;
+    }
+    long long totalLength = endLine - startLine;
+    for (int line = startLine; line <= endLine; line++)
+        totalLength += layoutInfo->lineLengths[line];
+    if (totalLength >= INT_MAX)
+    { // 되돌리기 편집의 길이는 int임
+        printMessage("Too many lines.");
+        return;
+    }
+
+    LineOperation operation;
+    operation.type = type;
+    operation.count = endLine - startLine + 1;
+    operation.isCaseInsensitive = searchInfo->isCaseInsensitive;
+    operation.isWholeWord = searchInfo->isWholeWord;
+    operation.word = NULL;
+    operation.regexes = NULL;
+    if (word != NULL && searchInfo->isRegex)
+    {
+        operation.regexes = (Regex **)malloc(sizeof(Regex *) * threadPool->threadCount);
+        for (int i = 0; i < threadPool->threadCount; i++)
+        {
+            operation.regexes[i] = compileRegex(word, operation.isCaseInsensitive);
+            if (operation.regexes[i] == NULL)
+            {
+                for (int j = 0; j < i; j++)
+                    freeRegex(operation.regexes[j]);
+                free(operation.regexes);
                 print();
+                printMessage("Invalid regex.");
                 return;
             }
-            else
-            { // 파일 이름 쓰기
-                newFilename[index] = ch;
-                mvprintw(windowSize->y - 1, 0, newFilename);
-                index++;
-            }
         }
+    }
+    else if (word != NULL)
+    {
+        operation.word = strdup(word);
+        for (int i = 0; operation.isCaseInsensitive && operation.word[i] != '\0'; i++)
+            operation.word[i] = foldCase((unsigned char)operation.word[i]);
+    }
+    beforeEdit();
+    detachClipboardAt(startLine, INT_MAX); // 줄을 다시 잇고 캐시를 통째로 다시 만드므로 아래쪽 클립보드의 줄 번호는 옮기지 못함
+    double startTime = currentTimeMs();
+
+    // 줄마다 노드 구간을 기록하면서 비교용 바이트를 복사함
+    operation.spans = (LineSpan *)malloc(sizeof(LineSpan) * operation.count);
+    operation.text = (char *)malloc(totalLength + 1);
+    operation.textLength = 0;
+    Node **separators = (Node **)malloc(sizeof(Node *) * operation.count); // 줄 사이의 줄바꿈 노드
+    Node *before = findLineStart(startLine);
+    Node *p = before;
+    for (int i = 0; i < operation.count; i++)
+    {
+        LineSpan *span = &operation.spans[i];
+        span->offset = operation.textLength;
+        span->length = layoutInfo->lineLengths[startLine + i];
+        span->first = span->length > 0 ? p->next : NULL;
+        for (int j = 0; j < span->length; j++)
+        {
+            p = p->next;
+            operation.text[operation.textLength++] = (char)p->data;
+        }
+        span->last = span->length > 0 ? p : NULL;
+        if (i < operation.count - 1)
+        {
+            p = p->next;
+            separators[i] = p;
+            operation.text[operation.textLength++] = '\n';
+        }
+    }
+    Node *after = p->next;
 
+    // 남길 줄들의 순서를 구함
+    int *result;
+    int resultCount = 0;
+    if (type == LINE_SORT)
+    {
+        result = sortLines(&operation);
+        resultCount = operation.count;
     }
     else
-    { // 기존에 있던 파일을 연 경우
-        if (fileInfo->isUpdated)
-        { // 변경사항이 있는 경우
-            saveFileAsFilename(fileInfo->filename);
+    {
+        result = (int *)malloc(sizeof(int) * operation.count);
+        if (type == LINE_UNIQUE)
+        {
+            runLineJobs(&operation, runLineHashJob);
+            resultCount = uniqueLines(&operation, result);
         }
         else
         {
-            for (int i = 0; i < windowSize->x; i++)
+            operation.isKept = (bool *)malloc(sizeof(bool) * operation.count);
+            runLineJobs(&operation, runLineFilterJob);
+            for (int i = 0; i < operation.count; i++)
             {
-                mvprintw(windowSize->y - 1, i, " ");
+                if (operation.isKept[i])
+                    result[resultCount++] = i;
             }
-            mvprintw(windowSize->y - 1, 0, "There are no changes to the file.");
+            free(operation.isKept);
         }
     }
-    fileInfo->isUpdated = false;
-    fileInfo->isFileSaving = false;
-    move(position->y, position->x);
-}
-
-void commonKey(int key)
-{
 
-    if (position->x == windowSize->x - 1)
+    // 남는 줄들을 새 순서로 잇고, 쓰지 않는 줄바꿈 노드와 지운 줄의 노드는 돌려줌 (남는 줄의 바이트는 복사하지 않음)
+    int resultLength = resultCount > 0 ? resultCount - 1 : 0;
+    p = before;
+    for (int k = 0; k < resultCount; k++)
     {
-        documentInfo->frameX++;
-        // move(++position->y, 1);
-        // position->x = 1;
-        //    enter();
+        LineSpan *span = &operation.spans[result[k]];
+        if (span->first != NULL)
+        {
+            p->next = span->first;
+            span->first->prev = p;
+            p = span->last;
+        }
+        if (k < resultCount - 1)
+        {
+            p->next = separators[k];
+            separators[k]->prev = p;
+            p = separators[k];
+        }
+        resultLength += span->length;
     }
-    else
+    p->next = after;
+    after->prev = p;
+    if (type != LINE_SORT)
     {
-        move(position->y, ++position->x);
+        for (int i = 0, k = 0; i < operation.count; i++)
+        {
+            if (k < resultCount && result[k] == i)
+            {
+                k++;
+                continue;
+            }
+            for (Node *node = operation.spans[i].first; node != NULL;)
+            {
+                Node *next = node == operation.spans[i].last ? NULL : node->next;
+                freeNode(node);
+                node = next;
+            }
+        }
     }
-    insert(key);
+    for (int k = resultCount > 0 ? resultCount - 1 : 0; k < operation.count - 1; k++)
+        freeNode(separators[k]);
+
+    // 되돌리기는 원래 줄들로 바꾸는 편집 하나임, 복사해둔 바이트를 그대로 넘겨줌
+    EditBatch *inverse = createEditBatch();
+    addEdit(inverse, startLine, 0, resultLength, "", 0);
+    free(inverse->edits[0].text);
+    inverse->edits[0].text = operation.text;
+    inverse->edits[0].length = operation.textLength;
+    pushUndo(inverse);
+
+    free(result);
+    free(separators);
+    free(operation.spans);
+    free(operation.word);
+    if (operation.regexes != NULL)
+    {
+        for (int i = 0; i < threadPool->threadCount; i++)
+            freeRegex(operation.regexes[i]);
+        free(operation.regexes);
+    }
+
+    // 화면의 시작 노드가 지워졌을 수 있으므로 처음부터 다시 찾음
+    documentInfo->frameFirstNode = head;
+    documentInfo->frameY = 0;
+    documentInfo->frameRow = 0;
+    documentInfo->frameX = 0;
+    position->current = head;
+    if (type == LINE_SORT)
+        markLinesDirty(startLine, startLine + operation.count - 1); // 정렬은 바이트 수가 그대로임
+    else
+        markLineResized(startLine);
+    rebuildLineCaches();
+    fileInfo->isUpdated = true;
+    moveCursorTo(startLine, 0);
     print();
+
+    char message[100];
+    double elapsed = currentTimeMs() - startTime;
+    if (type == LINE_SORT)
+        sprintf(message, "Sorted %d lines in %.1f ms.", operation.count, elapsed);
+    else
+        sprintf(message, "Removed %d of %d lines in %.1f ms.", operation.count - resultCount, operation.count, elapsed);
+    printMessage(message);
 }
+#endif
 
-void readFile(char *filename)
-{
-    fileInfo->isFileReading = true;
-    fileInfo->isNewFile = false;
-    // 파일의 확장자 가져오기
-    char *dot = strrchr(filename, '.');
-    if (dot)
-        fileInfo->filetype = dot + 1;
-    fileInfo->filename = filename;
-    FILE *pFile = fopen(filename, "r");
+int compareLines(LineOperation *operation, int a, int b)
+{ // 바이트 순서로 비교하고, 같은 줄은 원래 순서를 유지함
+    LineSpan *left = &operation->spans[a];
+    LineSpan *right = &operation->spans[b];
+    int length = left->length < right->length ? left->length : right->length;
+    int result = memcmp(operation->text + left->offset, operation->text + right->offset, length);
+    if (result != 0)
+        return result;
+    if (left->length != right->length)
+        return left->length - right->length;
+    return a - b;
+}
+
+void sortLineRange(LineOperation *operation, int *order, int *temp, int start, int end)
+{ // order의 [start, end)를 합병 정렬함
+    if (end - start < 2)
+        return;
+    int middle = (start + end) / 2;
+    sortLineRange(operation, order, temp, start, middle);
+    sortLineRange(operation, order, temp, middle, end);
+    mergeLineRanges(operation, order, temp, start, middle, end);
+    memcpy(order + start, temp + start, sizeof(int) * (end - start));
+}
+
+void mergeLineRanges(LineOperation *operation, int *from, int *to, int start, int middle, int end)
+{ // 정렬된 from의 [start, middle)과 [middle, end)를 to의 [start, end)에 합침
+    int i = start;
+    int j = middle;
+    for (int k = start; k < end; k++)
+    {
+        if (j >= end || (i < middle && compareLines(operation, from[i], from[j]) < 0))
+            to[k] = from[i++];
+        else
+            to[k] = from[j++];
+    }
+}
 
-    int ch;
+int *sortLines(LineOperation *operation)
+{ // 줄 번호를 쓰레드 수만큼의 구간으로 나눠서 동시에 정렬하고, 구간들을 두 개씩 동시에 합쳐 나감
+    int count = operation->count;
+    int *order = (int *)malloc(sizeof(int) * count);
+    int *temp = (int *)malloc(sizeof(int) * count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+
+    int parts = 1; // 두 개씩 합치므로 2의 거듭제곱
+    while (parts < threadPool->threadCount && parts * 2 <= count)
+        parts *= 2;
+    LineJob *jobs = (LineJob *)malloc(sizeof(LineJob) * parts);
+    for (int k = 0; k < parts; k++)
+    {
+        jobs[k].operation = operation;
+        jobs[k].start = (long long)count * k / parts;
+        jobs[k].end = (long long)count * (k + 1) / parts;
+        jobs[k].order = order;
+        jobs[k].merged = temp;
+        jobs[k].isDone = false;
+        submitTask(runLineSortJob, &jobs[k]);
+    }
+    for (int k = 0; k < parts; k++)
+        waitTask(&jobs[k].isDone);
 
-    bool flag = true;
-    do
+    int *from = order;
+    int *to = temp;
+    for (int width = 1; width < parts; width *= 2)
     {
-        ch = fgetc(pFile);
-        if (ch == '\n')
+        int jobCount = 0;
+        for (int k = 0; k < parts; k += 2 * width)
         {
-            enter();
+            LineJob *job = &jobs[jobCount++];
+            job->start = (long long)count * k / parts;
+            job->middle = (long long)count * (k + width) / parts;
+            job->end = (long long)count * (k + 2 * width) / parts;
+            job->order = from;
+            job->merged = to;
+            job->isDone = false;
+            submitTask(runLineMergeJob, job);
         }
-        else
-            commonKey(ch);
+        for (int k = 0; k < jobCount; k++)
+            waitTask(&jobs[k].isDone);
+        int *swap = from;
+        from = to;
+        to = swap;
+    }
+    free(jobs);
+    free(to);
+    return from;
+}
 
-        if (flag && documentInfo->lineCount == windowSize->y)
+int uniqueLines(LineOperation *operation, int *result)
+{ // 처음 나온 줄만 result에 순서대로 넣음, 줄의 해시는 쓰레드 풀에서 미리 구해둠
+    int capacity = 1;
+    while (capacity < operation->count * 2)
+        capacity *= 2;
+    int *table = (int *)malloc(sizeof(int) * capacity); // 열린 주소법, -1은 빈 칸
+    memset(table, 0xFF, sizeof(int) * capacity);
+    int resultCount = 0;
+    for (int i = 0; i < operation->count; i++)
+    {
+        LineSpan *span = &operation->spans[i];
+        unsigned int slot = span->hash & (capacity - 1);
+        bool isDuplicate = false;
+        while (table[slot] >= 0)
+        {
+            LineSpan *other = &operation->spans[table[slot]];
+            if (other->hash == span->hash && other->length == span->length &&
+                memcmp(operation->text + other->offset, operation->text + span->offset, span->length) == 0)
+            {
+                isDuplicate = true;
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (!isDuplicate)
         {
-            Node *p = position->current->prev;
-            documentInfo->frameLastNode = p;
-            flag = false;
+            table[slot] = i;
+            result[resultCount++] = i;
         }
-    } while (ch != EOF);
+    }
+    free(table);
+    return resultCount;
+}
 
-    fclose(pFile);
-    move(0, 0);
-    position->x = 0;
-    position->y = 0;
-    documentInfo->frameX = 0;
-    documentInfo->frameY = 0;
-    position->current = head;
-    fileInfo->isFileReading = false;
-    print();
+bool lineContains(LineOperation *operation, char *text, int length, Regex *regex, char *isStart)
+{ // 찾기와 같은 규칙(정규식, 대소문자 무시, 단어 단위)으로 줄에 단어가 있는지 봄
+    if (regex != NULL)
+        return searchRegexLine(regex, text, length, isStart, NULL, NULL, 0, operation->isWholeWord);
+    int wordLength = strlen(operation->word);
+    char *end = text + length;
+    char *found = text;
+    while ((found = operation->isCaseInsensitive ? findBytesFolded(found, end - found, operation->word, wordLength)
+                                                 : findBytes(found, end - found, operation->word, wordLength)) != NULL)
+    {
+        if (!operation->isWholeWord || isWholeWordAt(text, length, found - text, found - text + wordLength))
+            return true;
+        found++;
+    }
+    return false;
 }
 
-PNode *findWordsInDocument(char *word)
+void runLineSortJob(void *arg, int worker)
 {
-    Node *p = head->next;
-    PNode *wordListHead = (PNode *)malloc(sizeof(PNode));
-    PNode *wordListTail = (PNode *)malloc(sizeof(PNode));
+    LineJob *job = (LineJob *)arg;
+    sortLineRange(job->operation, job->order, job->merged, job->start, job->end);
+    markTaskDone(&job->isDone);
+}
 
-    wordListHead->next = wordListTail;
-    wordListHead->prev = wordListTail; // 한 방향으로만 접근 가능하도록 함 (반 원형 연결 리스트?)
+void runLineMergeJob(void *arg, int worker)
+{
+    LineJob *job = (LineJob *)arg;
+    mergeLineRanges(job->operation, job->order, job->merged, job->start, job->middle, job->end);
+    markTaskDone(&job->isDone);
+}
 
-    wordListTail->prev = wordListHead;
+void runLineHashJob(void *arg, int worker)
+{ // FNV-1a
+    LineJob *job = (LineJob *)arg;
+    LineOperation *operation = job->operation;
+    for (int i = job->start; i < job->end; i++)
+    {
+        LineSpan *span = &operation->spans[i];
+        unsigned int hash = 2166136261u;
+        for (int j = 0; j < span->length; j++)
+            hash = (hash ^ (unsigned char)operation->text[span->offset + j]) * 16777619u;
+        span->hash = hash;
+    }
+    markTaskDone(&job->isDone);
+}
 
-    int x = 0;
-    int y = 0;
-    while (p != tail)
+void runLineFilterJob(void *arg, int worker)
+{
+    LineJob *job = (LineJob *)arg;
+    LineOperation *operation = job->operation;
+    Regex *regex = operation->regexes != NULL ? operation->regexes[worker] : NULL;
+    int maxLength = 0;
+    for (int i = job->start; i < job->end; i++)
     {
-        bool valid = true;
-        if (p->data == ENTER)
+        if (operation->spans[i].length > maxLength)
+            maxLength = operation->spans[i].length;
+    }
+    char *isStart = (char *)malloc(maxLength + 1);
+    for (int i = job->start; i < job->end; i++)
+    {
+        LineSpan *span = &operation->spans[i];
+        bool isFound = lineContains(operation, operation->text + span->offset, span->length, regex, isStart);
+        operation->isKept[i] = isFound == (operation->type == LINE_KEEP);
+    }
+    free(isStart);
+    markTaskDone(&job->isDone);
+}
+
+void runLineJobs(LineOperation *operation, void (*function)(void *arg, int worker))
+{ // 줄들을 LINE_JOB_SIZE 줄씩 나눠서 쓰레드 풀에서 처리하고 모두 끝날 때까지 기다림
+    int jobCount = (operation->count + LINE_JOB_SIZE - 1) / LINE_JOB_SIZE;
+    LineJob *jobs = (LineJob *)malloc(sizeof(LineJob) * jobCount);
+    for (int k = 0; k < jobCount; k++)
+    {
+        jobs[k].operation = operation;
+        jobs[k].start = k * LINE_JOB_SIZE;
+        jobs[k].end = k == jobCount - 1 ? operation->count : (k + 1) * LINE_JOB_SIZE;
+        jobs[k].isDone = false;
+        submitTask(function, &jobs[k]);
+    }
+    for (int k = 0; k < jobCount; k++)
+        waitTask(&jobs[k].isDone);
+    free(jobs);
+}
+
+#ifndef VITE_LIBRARY
+bool readPrompt(char *message, char *buffer, int size)
+{ // 메세지 줄에서 문자열을 입력받음, Esc를 누르면 false
+    int length = strlen(buffer);
+    while (true)
+    {
+        for (int i = 0; i < windowSize->x; i++)
+            mvaddch(windowSize->y - 1, i, ' ');
+        char rightMessage[] = "Enter = ok | Esc = cancel";
+        mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+        mvprintw(windowSize->y - 1, 0, "%s%s", message, buffer);
+
+        int ch = getch();
+        if (ch == ENTER)
+            return true;
+        else if (ch == ESC)
+            return false;
+        else if (ch == BACKSPACE || ch == KEY_BACKSPACE)
         {
-            x = 0;
-            y++;
+            if (length > 0)
+            {
+                length -= prevTextCharLength(buffer, length);
+                buffer[length] = '\0';
+            }
         }
-        else
+        else if (ch < 256 && length < size - 1)
         {
-            Node *t = p;
-            for (int i = 0; i < strlen(word); i++)
+            buffer[length++] = ch;
+            buffer[length] = '\0';
+        }
+    }
+}
+
+void printReplaceMessageBar(int currentResultIndex, int resultCount)
+{
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 1, i, ' ');
+    char rightMessage[120];
+    sprintf(rightMessage, "[%d/%d] Enter = replace | A = replace all | Arrows = prev/next | Esc = done",
+            currentResultIndex, resultCount);
+    mvprintw(windowSize->y - 1, 0, "Replace?");
+    mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+    move(windowSize->y - 1, 8);
+}
+
+void replace(void)
+{
+    beforeEdit();
+    char word[100] = "";
+    char replacement[100] = "";
+    if (!readPrompt(searchInfo->isRegex ? "Replace regex: " : "Replace: ", word, sizeof(word)) || word[0] == '\0' ||
+        !readPrompt("With: ", replacement, sizeof(replacement)))
+    {
+        print();
+        return;
+    }
+    int replacementLength = strlen(replacement);
+
+    PNode *wordListHead = searchDocument(word, NULL);
+    int resultCount = countFindResult(wordListHead);
+    if (resultCount == 0)
+    {
+        print();
+        for (int i = 0; i < windowSize->x; i++)
+            mvaddch(windowSize->y - 1, i, ' ');
+        mvprintw(windowSize->y - 1, 0, "No matches.");
+        move(position->y, position->x);
+        return;
+    }
+
+    // 포기시 원래위치
+    Node *tempFFN = documentInfo->frameFirstNode;
+    Node *tempFLN = documentInfo->frameLastNode;
+    int tempFX = documentInfo->frameX;
+    int tempFY = documentInfo->frameY;
+    int tempFR = documentInfo->frameRow;
+    int replacedCount = 0;
+    int cursorLine = 0; // 마지막으로 바꾼 곳
+    int cursorColumn = 0;
+
+    PNode *highlightedWord = wordListHead->next;
+    int currentResultIndex = 1;
+    while (highlightedWord->next != NULL)
+    {
+        highlight(highlightedWord, word, 9);
+        printReplaceMessageBar(currentResultIndex, resultCount);
+
+        int ch = getch();
+        if (ch == ENTER)
+        { // 하나만 바꿈
+            EditBatch *batch = createEditBatch();
+            addEdit(batch, highlightedWord->position->y, highlightedWord->position->x,
+                    highlightedWord->length, replacement, replacementLength);
+            pushUndo(applyEdits(batch));
+            freeEditBatch(batch);
+            replacedCount++;
+            cursorLine = currentLineIndex();
+            cursorColumn = currentColumn();
+
+            // 같은 줄의 뒤쪽 결과들은 칸을 옮기고, 바뀐 부분과 겹치는 결과는 버림
+            int line = highlightedWord->position->y;
+            int end = highlightedWord->position->x + highlightedWord->length;
+            int shift = replacementLength - highlightedWord->length;
+            PNode *next = highlightedWord->next;
+            while (next->next != NULL && next->position->y == line && next->position->x < end)
             {
-                if (t->data != word[i])
-                {
-                    valid = false;
-                    break;
-                }
-                t = t->next;
+                PNode *overlapped = next;
+                next = next->next;
+                overlapped->prev->next = next;
+                next->prev = overlapped->prev;
+                free(overlapped->position);
+                free(overlapped);
+                resultCount--;
+            }
+            for (PNode *p = next; p->next != NULL && p->position->y == line; p = p->next)
+                p->position->x += shift;
+
+            highlightedWord->prev->next = next;
+            next->prev = highlightedWord->prev;
+            free(highlightedWord->position);
+            free(highlightedWord);
+            highlightedWord = next;
+            resultCount--;
+        }
+        else if (ch == 'a' || ch == 'A')
+        { // 남은 결과들을 한 번의 선형 탐색으로 모두 바꾸고 하나의 편집으로 되돌림
+            EditBatch *batch = createEditBatch();
+            int lastLine = -1;
+            int lastEnd = 0;
+            for (PNode *p = highlightedWord; p->next != NULL; p = p->next)
+            {
+                if (p->position->y == lastLine && p->position->x < lastEnd)
+                    continue; // 앞의 결과와 겹침
+                addEdit(batch, p->position->y, p->position->x, p->length, replacement, replacementLength);
+                lastLine = p->position->y;
+                lastEnd = p->position->x + p->length;
             }
-            if (valid)
+            pushUndo(applyEdits(batch));
+            replacedCount += batch->count;
+            freeEditBatch(batch);
+            cursorLine = currentLineIndex();
+            cursorColumn = currentColumn();
+            break;
+        }
+        else if (ch == KEY_RIGHT)
+        {
+            highlightedWord = highlightedWord->next;
+            currentResultIndex++;
+        }
+        else if (ch == KEY_LEFT)
+        {
+            if (currentResultIndex > 1)
             {
-                PNode *new = (PNode *)malloc(sizeof(PNode));
-                new->position = (Position *)malloc(sizeof(Position));
-                new->position->current = p;
-                new->position->x = x;
-                new->position->y = y;
+                highlightedWord = highlightedWord->prev;
+                currentResultIndex--;
+            }
+        }
+        else if (ch == ESC)
+            break;
+    }
 
-                new->next = wordListTail;
-                new->prev = wordListTail->prev;
+    PNode *p = wordListHead;
+    while (p != NULL)
+    {
+        PNode *next = p->next;
+        if (p->position != NULL)
+            free(p->position);
+        free(p);
+        p = next;
+    }
 
-                wordListTail->prev->next = new;
-                wordListTail->prev = new;
-            }
-            x++;
+    if (replacedCount == 0)
+    {
+        documentInfo->frameFirstNode = tempFFN;
+        documentInfo->frameLastNode = tempFLN;
+        documentInfo->frameX = tempFX;
+        documentInfo->frameY = tempFY;
+        documentInfo->frameRow = tempFR;
+        if (documentInfo->isWrapMode)
+            wrapScrollToCursor();
+    }
+    else
+    { // 결과를 보여주느라 frame이 옮겨졌으므로 커서를 다시 놓음
+        moveCursorTo(cursorLine, cursorColumn);
+    }
+    print();
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 1, i, ' ');
+    mvprintw(windowSize->y - 1, 0, "Replaced %d occurrence%s.", replacedCount, replacedCount == 1 ? "" : "s");
+    move(position->y, position->x);
+}
+#endif
+
+void initBufferInfo(void)
+{ // 처음 만든 문서가 첫 번째 버퍼가 됨
+    bufferInfo = (BufferInfo *)malloc(sizeof(BufferInfo));
+    bufferInfo->capacity = 4;
+    bufferInfo->buffers = (Buffer *)malloc(sizeof(Buffer) * bufferInfo->capacity);
+    bufferInfo->count = 0;
+    bufferInfo->clock = 0;
+    bufferInfo->current = addBuffer(currentEditor);
+}
+
+int addBuffer(Editor *editor)
+{
+    if (bufferInfo->count == bufferInfo->capacity)
+    {
+        bufferInfo->capacity *= 2;
+        bufferInfo->buffers = (Buffer *)realloc(bufferInfo->buffers, sizeof(Buffer) * bufferInfo->capacity);
+    }
+    Buffer *buffer = &bufferInfo->buffers[bufferInfo->count];
+    buffer->editor = editor;
+    buffer->windowY = windowSize->y;
+    buffer->lastUsed = bufferInfo->clock;
+    buffer->isCacheReleased = false;
+    return bufferInfo->count++;
+}
+
+int findBuffer(char *filename)
+{ // 같은 파일(링크나 다른 경로로 연 경우도)을 연 버퍼, 없으면 -1
+    struct stat fileStat;
+    bool isExisting = stat(filename, &fileStat) == 0;
+    for (int i = 0; i < bufferInfo->count; i++)
+    {
+        FileInfo *other = bufferInfo->buffers[i].editor->fileInfo;
+        struct stat otherStat;
+        if (other->isNewFile)
+            continue; // 이름 없는 문서
+        if (isExisting ? stat(other->filename, &otherStat) == 0 && otherStat.st_dev == fileStat.st_dev && otherStat.st_ino == fileStat.st_ino
+                       : strcmp(other->filename, filename) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void leaveBuffer(char **clipboardText, int *clipboardLength)
+{ // 지금 버퍼의 화면 높이를 기록하고 클립보드를 바이트로 떼어 옴, 클립보드는 버퍼를 따라감
+    Buffer *buffer = &bufferInfo->buffers[bufferInfo->current];
+    buffer->windowY = windowSize->y;
+    buffer->lastUsed = ++bufferInfo->clock;
+    detachClipboard(); // 떠나는 문서의 노드를 가리키지 않게 함
+    *clipboardText = selectionInfo->clipboardText;
+    *clipboardLength = selectionInfo->clipboardLength;
+    selectionInfo->clipboardText = NULL;
+    selectionInfo->clipboardLength = 0;
+}
+
+void enterBuffer(int index, char *clipboardText, int clipboardLength)
+{ // 포인터만 바꿔서 고르므로 문서 크기와 상관없이 바로 끝남
+    bufferInfo->current = index;
+    Buffer *buffer = &bufferInfo->buffers[index];
+    useEditor(buffer->editor);
+    free(selectionInfo->clipboardText);
+    selectionInfo->clipboardText = clipboardText;
+    selectionInfo->clipboardLength = clipboardLength;
+    buffer->isCacheReleased = false;
+    releaseIdleCaches();
+}
+
+#ifndef VITE_LIBRARY
+void switchBuffer(int index)
+{
+    if (index == bufferInfo->current)
+        return;
+    char *clipboardText;
+    int clipboardLength;
+    leaveBuffer(&clipboardText, &clipboardLength);
+    enterBuffer(index, clipboardText, clipboardLength);
+    int windowY = bufferInfo->buffers[index].windowY;
+    if (windowY != windowSize->y && !hexInfo->isEnabled)
+        fitFrameToWindow(windowY); // 그리기까지 함
+    else
+        print();
+}
+#endif
+
+void releaseIdleCaches(void)
+{ // 보이지 않는 버퍼 중 오래 쓰지 않은 것부터 캐시를 버림, 메모리가 모자라면 모두 버림
+    bool isLow = isMemoryLow();
+    while (true)
+    {
+        int cachedCount = 0;
+        Buffer *oldest = NULL;
+        for (int i = 0; i < bufferInfo->count; i++)
+        {
+            Buffer *buffer = &bufferInfo->buffers[i];
+            if (i == bufferInfo->current || buffer->isCacheReleased)
+                continue;
+            cachedCount++;
+            if (oldest == NULL || buffer->lastUsed < oldest->lastUsed)
+                oldest = buffer;
+        }
+        if (cachedCount == 0 || (!isLow && cachedCount <= BUFFER_CACHED_MAX))
+            return;
+        releaseBufferCaches(oldest);
+    }
+}
+
+void releaseBufferCaches(Buffer *buffer)
+{ // 문서에서 다시 셀 수 있는 것만 버림: 특수 글자 위치, 줄 수 트리, 렉서 버퍼, 괄호 색인
+    Editor *editor = currentEditor;
+    useEditor(buffer->editor);
+    for (int i = 0; i < layoutInfo->lineCount; i++)
+    {
+        if (layoutInfo->columnMaps[i] != NULL && layoutInfo->columnMaps[i] != &unmeasuredColumnMap)
+        {
+            layoutFreeColumnMap(i);
+            layoutInfo->columnMaps[i] = &unmeasuredColumnMap;
         }
+    }
+    free(layoutInfo->rowTree);
+    layoutInfo->rowTree = NULL;
+    layoutInfo->isRowTreeDirty = true;
+    free(syntaxInfo->text);
+    free(syntaxInfo->colors);
+    syntaxInfo->text = NULL;
+    syntaxInfo->colors = NULL;
+    syntaxInfo->textCapacity = 0;
+    resetBracketIndex();
+    free(bracketInfo->treeDepths);
+    free(bracketInfo->treeMinDepths);
+    bracketInfo->treeDepths = NULL;
+    bracketInfo->treeMinDepths = NULL;
+    bracketInfo->treeSize = 0;
+    bracketInfo->isTreeDirty = true;
+    useEditor(editor);
+    buffer->isCacheReleased = true;
+}
 
-        p = p->next;
+bool isMemoryLow(void)
+{ // 리눅스에서만 봄, 페이지 캐시는 돌려받을 수 있으므로 MemFree가 아니라 MemAvailable과 비교함
+#ifdef LINUX
+    FILE *file = fopen("/proc/meminfo", "r");
+    if (file == NULL)
+        return false;
+    long long total = -1, available = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        sscanf(line, "MemTotal: %lld", &total);
+        sscanf(line, "MemAvailable: %lld", &available);
     }
-    // PNode* p2 = wordListHead->next;
-    // while(p2->next != NULL) {
-    //     printw("x%d y%d", p2->position->x, p2->position->y);
-    //     p2 = p2->next;
-    // }
-    return wordListHead;
+    fclose(file);
+    return total > 0 && available >= 0 && available < total / BUFFER_LOW_MEMORY_RATIO;
+#else
+    return false;
+#endif
+}
+
+#ifndef VITE_LIBRARY
+void openBuffer(void)
+{ // Ctrl-E: 파일을 새 버퍼로 엶, 이미 연 파일이면 그 버퍼로 바꿈
+    char filename[256] = "";
+    if (!readPrompt("Open file: ", filename, sizeof(filename)) || filename[0] == '\0')
+    {
+        print();
+        return;
+    }
+    if (openBufferFile(filename))
+        printMessage("Already open, switched to the buffer.");
+}
+
+bool openBufferFile(char *filename)
+{ // 이미 연 파일이면 그 버퍼로 바꾸고 true, 아니면 새 버퍼에 읽음
+    int index = findBuffer(filename);
+    if (index >= 0)
+    {
+        switchBuffer(index);
+        return true;
+    }
+    int tabSize = layoutInfo->tabSize; // 옵션은 지금 버퍼를 따름
+    bool isSessionSkipped = sessionInfo->isSkipped;
+    int autosaveIdleMs = autosaveInfo->idleMs;
+    int autosaveEditLimit = autosaveInfo->editLimit;
+    char *clipboardText;
+    int clipboardLength;
+    leaveBuffer(&clipboardText, &clipboardLength);
+    enterBuffer(addBuffer(newEditor()), clipboardText, clipboardLength);
+    layoutInfo->tabSize = tabSize;
+    sessionInfo->isSkipped = isSessionSkipped;
+    autosaveInfo->idleMs = autosaveIdleMs;
+    autosaveInfo->editLimit = autosaveEditLimit;
+    readFile(strdup(filename)); // 파일 이름을 계속 가리키므로 복사함
+    return false;
+}
+
+void bufferMenu(void)
+{ // Ctrl-N: 버퍼 목록을 띄움, 숫자로 고르거나 Ctrl-N을 한 번 더 누르면 다음 버퍼로 감
+    if (bufferInfo->count == 1)
+    {
+        printMessage("Only one buffer is open. Ctrl-E = open file");
+        return;
+    }
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 1, i, ' ');
+    move(windowSize->y - 1, 0);
+    printw("Buffers:");
+    for (int i = 0; i < bufferInfo->count && i < 9; i++)
+    {
+        FileInfo *other = bufferInfo->buffers[i].editor->fileInfo;
+        char *name = strrchr(other->filename, '/') ? strrchr(other->filename, '/') + 1 : other->filename;
+        printw(" %s%d:%s%s", i == bufferInfo->current ? "[" : "", i + 1, other->isUpdated ? "*" : "", name);
+        if (i == bufferInfo->current)
+            printw("]");
+    }
+    printw(" | 1-9 = pick | Ctrl-N = next | Esc = cancel");
+    int ch = getch();
+    if (ch >= '1' && ch <= '9' && ch - '1' < bufferInfo->count && ch - '1' != bufferInfo->current)
+        switchBuffer(ch - '1');
+    else if (ch == CTRL('n'))
+        switchBuffer((bufferInfo->current + 1) % bufferInfo->count);
+    else
+        print();
 }
 
-void highlight(PNode *p, char *word, int wordLength)
-{
-    if (p->position->x + wordLength < windowSize->x - 1)
+void searchProject(void)
+{ // Ctrl-G: 디렉터리 아래의 파일들에서 단어를 찾음, 지난번과 같은 단어와 디렉터리면 결과 목록을 다시 엶
+    char word[100] = "";
+    char directory[256] = ".";
+    if (projectInfo != NULL)
     {
-        documentInfo->frameX = 0;
+        snprintf(word, sizeof(word), "%s", projectInfo->typedWord);
+        snprintf(directory, sizeof(directory), "%s", projectInfo->directory);
     }
-    else
+    else if (!fileInfo->isNewFile && strrchr(fileInfo->filename, '/') != NULL)
+        snprintf(directory, sizeof(directory), "%.*s", (int)(strrchr(fileInfo->filename, '/') - fileInfo->filename), fileInfo->filename);
+    char *message = searchInfo->isCaseInsensitive ? (searchInfo->isWholeWord ? "Search files for (case, word): " : "Search files for (case): ")
+                                                  : (searchInfo->isWholeWord ? "Search files for (word): " : "Search files for: ");
+    if (!readPrompt(message, word, sizeof(word)) || word[0] == '\0' || !readPrompt("In directory: ", directory, sizeof(directory)) ||
+        directory[0] == '\0')
     {
-        documentInfo->frameX = p->position->x + wordLength - (windowSize->x - 1);
+        print();
+        return;
     }
+    if (projectInfo == NULL || projectInfo->isCanceled || strcmp(word, projectInfo->typedWord) != 0 ||
+        strcmp(directory, projectInfo->directory) != 0 || projectInfo->isCaseInsensitive != searchInfo->isCaseInsensitive ||
+        projectInfo->isWholeWord != searchInfo->isWholeWord)
+        startProjectSearch(directory, word);
+    showProjectResults();
+}
+#endif
 
-    int paddingY = (int)(windowSize->y - 2) / 2; // 페이지 내에서 출력될 단어의 y 위치
-    if (p->position->y < windowSize->y - 2)
+void startProjectSearch(char *directory, char *word)
+{ // 디렉터리는 walkProjectDirectory로 조금씩 따라가면서 파일마다 작업을 바로 넣으므로 다 따라가기 전에도 찾기 시작함
+    directory = strdup(directory); // 지난 검색의 문자열일 수 있음
+    word = strdup(word);
+    freeProjectInfo();
+    projectInfo = (ProjectInfo *)malloc(sizeof(ProjectInfo));
+    projectInfo->directory = directory;
+    projectInfo->typedWord = word;
+    projectInfo->wordLength = strlen(word);
+    projectInfo->isCaseInsensitive = searchInfo->isCaseInsensitive;
+    projectInfo->isWholeWord = searchInfo->isWholeWord;
+    projectInfo->word = strdup(word);
+    for (int i = 0; projectInfo->isCaseInsensitive && i < projectInfo->wordLength; i++)
+        projectInfo->word[i] = foldCase((unsigned char)word[i]);
+    projectInfo->isCanceled = false;
+    projectInfo->walkCount = 0;
+    projectInfo->pathCapacity = 64;
+    projectInfo->paths = (char **)malloc(sizeof(char *) * projectInfo->pathCapacity);
+    projectInfo->pathCount = 0;
+    projectInfo->jobCapacity = 64;
+    projectInfo->jobs = (ProjectJob **)malloc(sizeof(ProjectJob *) * projectInfo->jobCapacity);
+    projectInfo->jobCount = 0;
+    projectInfo->mergedJobs = 0;
+    projectInfo->lineBase = 0;
+    projectInfo->hitCapacity = 64;
+    projectInfo->hits = (ProjectHit *)malloc(sizeof(ProjectHit) * projectInfo->hitCapacity);
+    projectInfo->hitCount = 0;
+    projectInfo->searchedBytes = 0;
+    projectInfo->elapsed = -1;
+    projectInfo->selected = 0;
+    projectInfo->top = 0;
+    projectInfo->startTime = currentTimeMs();
+
+    struct stat fileStat;
+    if (stat(directory, &fileStat) == 0 && S_ISREG(fileStat.st_mode))
+        addProjectFile(projectInfo, strdup(directory), fileStat.st_size); // 파일 하나만 찾을 수도 있음
+    else
+        openProjectDirectory(projectInfo, strdup(directory), 0);
+}
+
+int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+void openProjectDirectory(ProjectInfo *search, char *path, int depth)
+{ // 디렉터리의 이름들을 읽어서 따라갈 목록에 올림 (app.log, app.log.1, ... 이름 순서), 숨긴 파일과 디렉터리(.git, 사이드카)는 건너뜀
+    DIR *dir = opendir(path);
+    if (dir == NULL)
     {
-        documentInfo->frameY = 0;
-        documentInfo->frameFirstNode = head;
-        documentInfo->frameLastNode = head;
-        for (int i = 0; i < windowSize->y - 2; i++)
-        {
-            moveLastFrameRight();
-        }
-        paddingY = p->position->y;
+        free(path);
+        return;
     }
-    else
+    int capacity = 16;
+    int count = 0;
+    char **names = (char **)malloc(sizeof(char *) * capacity);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
     {
-        documentInfo->frameY = p->position->y - paddingY;
-        documentInfo->frameFirstNode = p->position->current;
-        documentInfo->frameLastNode = p->position->current;
-
-        for (int i = 0; i < paddingY + 1; i++)
-        {
-            moveFirstFrameLeft();
-        }
-        for (int i = 0; i < windowSize->y - 2 - paddingY; i++)
+        if (entry->d_name[0] == '.')
+            continue;
+        if (count == capacity)
         {
-            moveLastFrameRight();
+            capacity *= 2;
+            names = (char **)realloc(names, sizeof(char *) * capacity);
         }
+        names[count++] = strdup(entry->d_name);
     }
-
-    print();
-    attron(COLOR_PAIR(1));
-    mvprintw(paddingY, p->position->x - documentInfo->frameX, "%s", word);
-    attroff(COLOR_PAIR(1));
-    move(windowSize->y - 1, wordLength - 1);
+    closedir(dir);
+    qsort(names, count, sizeof(char *), compareNames);
+
+    ProjectDirectory *directory = &search->walk[search->walkCount++];
+    directory->path = path;
+    directory->names = names;
+    directory->count = count;
+    directory->next = 0;
+    directory->depth = depth;
 }
 
-void printFindMessageBar(char *word, int currentResultIndex, int resultCount)
-{
-    for (int i = 0; i < windowSize->x; i++)
+bool walkProjectDirectory(ProjectInfo *search, double duration)
+{ // duration ms 동안 파일을 하나씩 꺼내서 작업을 넣음, 따라갈 곳이 남았으면 true (취소되면 남은 목록을 버림)
+    double startTime = currentTimeMs();
+    while (search->walkCount > 0)
     {
-        mvaddch(windowSize->y - 1, i, ' ');
+        ProjectDirectory *directory = &search->walk[search->walkCount - 1];
+        if (directory->next == directory->count || isTaskDone(&search->isCanceled))
+        {
+            for (int i = directory->next; i < directory->count; i++)
+                free(directory->names[i]);
+            free(directory->names);
+            free(directory->path);
+            search->walkCount--;
+            continue;
+        }
+        if (currentTimeMs() - startTime >= duration)
+            return true;
+
+        char *name = directory->names[directory->next++];
+        int directoryLength = strlen(directory->path);
+        bool hasSlash = directoryLength > 0 && directory->path[directoryLength - 1] == '/';
+        char *path = (char *)malloc(directoryLength + strlen(name) + 2);
+        sprintf(path, hasSlash ? "%s%s" : "%s/%s", directory->path, name);
+        free(name);
+        struct stat fileStat;
+        if (stat(path, &fileStat) != 0)
+            free(path);
+        else if (S_ISDIR(fileStat.st_mode) && directory->depth < PROJECT_MAX_DEPTH)
+            openProjectDirectory(search, path, directory->depth + 1);
+        else if (S_ISREG(fileStat.st_mode) && fileStat.st_size > 0 && search->pathCount < INT_MAX)
+            addProjectFile(search, path, fileStat.st_size);
+        else
+            free(path);
     }
-    char rightMessage[100];
-    sprintf(rightMessage, "[%d/%d] Arrows = prev/next | Enter = edit | Esc = cancel", currentResultIndex, resultCount);
-
-    mvprintw(windowSize->y - 1, 0, word);
-    mvprintw(windowSize->y - 1, windowSize->x - strlen(rightMessage), rightMessage);
-    move(windowSize->y - 1, strlen(word));
+    return false;
 }
 
-int countFindResult(PNode *wordListHead)
-{
-    PNode *p = wordListHead;
-    int count = 0;
-    while (p->next != NULL) // 위의 원형 리스트에서 tail에서는 head로의 연결을 해놓지 않았기 때문에 null로 리스트의 끝을 알수 있음
+void addProjectFile(ProjectInfo *search, char *path, long long size)
+{ // 큰 파일은 PROJECT_CHUNK_SIZE씩 나눠서 여러 쓰레드가 같이 찾음
+    if (search->pathCount == search->pathCapacity)
     {
-        count++;
-        p = p->next;
+        search->pathCapacity *= 2;
+        search->paths = (char **)realloc(search->paths, sizeof(char *) * search->pathCapacity);
+    }
+    search->paths[search->pathCount++] = path;
+#ifdef WINDOWS
+    int chunkCount = 1; // mmap이 없으므로 파일 전체를 읽음
+#else
+    int chunkCount = (size + PROJECT_CHUNK_SIZE - 1) / PROJECT_CHUNK_SIZE;
+#endif
+    for (int k = 0; k < chunkCount; k++)
+    {
+        ProjectJob *job = (ProjectJob *)malloc(sizeof(ProjectJob));
+        job->search = search;
+        job->path = path;
+        job->file = search->pathCount - 1;
+        job->offset = (long long)k * PROJECT_CHUNK_SIZE;
+        job->length = k == chunkCount - 1 ? -1 : PROJECT_CHUNK_SIZE; // 마지막 조각은 그 사이 늘어난 부분까지 찾음
+        job->hits = NULL;
+        job->hitCount = 0;
+        job->hitCapacity = 0;
+        job->lineCount = 0;
+        job->searchedBytes = 0;
+        job->isDone = false;
+        if (search->jobCount == search->jobCapacity)
+        {
+            search->jobCapacity *= 2;
+            search->jobs = (ProjectJob **)realloc(search->jobs, sizeof(ProjectJob *) * search->jobCapacity);
+        }
+        search->jobs[search->jobCount++] = job;
+        submitTask(runProjectJob, job);
     }
-    return count - 1;
 }
 
-void find(void)
-{
-    if(head->next == tail) {
-        for (int i = 0; i < windowSize->x; i++)
+void runProjectJob(void *arg, int worker)
+{ // 파일을 mmap해서 조각을 찾음, 압축된 파일은 첫 조각의 작업이 전체를 풀어서 찾음
+    ProjectJob *job = (ProjectJob *)arg;
+    FILE *file = isTaskDone(&job->search->isCanceled) ? NULL : fopen(job->path, "rb");
+    if (file != NULL && detectCompression(file) != COMPRESSION_NONE)
+    {
+        if (job->offset == 0)
         {
-            mvaddch(windowSize->y - 1, i, ' ');
+            int length;
+            bool isFailed;
+            char *text = readWholeFile(file, job->path, &length, &isFailed);
+            job->length = -1;
+            if (memchr(text, 0, length < HEX_DETECT_SIZE ? length : HEX_DETECT_SIZE) == NULL)
+                searchProjectText(job, text, length);
+            free(text);
         }
-        mvprintw(windowSize->y - 1, 0, "There is no characters.");
-        move(position->y, position->x);
-        return;
+        else
+            fclose(file);
     }
-    char word[100];
-    for(int i=0;i<100;i++) {
-        word[i] = '\0';
+    else if (file != NULL)
+    {
+#ifdef WINDOWS
+        int length;
+        bool isFailed;
+        char *text = readWholeFile(file, job->path, &length, &isFailed);
+        if (memchr(text, 0, length < HEX_DETECT_SIZE ? length : HEX_DETECT_SIZE) == NULL)
+            searchProjectText(job, text, length);
+        free(text);
+#else
+        struct stat fileStat;
+        char *data = MAP_FAILED;
+        if (fstat(fileno(file), &fileStat) == 0 && fileStat.st_size > job->offset)
+            data = (char *)mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        fclose(file); // 매핑은 파일을 닫아도 남음
+        if (data != MAP_FAILED)
+        { // 바이너리 파일은 조각마다 파일 앞부분을 보고 건너뜀
+            long long headLength = fileStat.st_size < HEX_DETECT_SIZE ? fileStat.st_size : HEX_DETECT_SIZE;
+            if (memchr(data, 0, headLength) == NULL)
+                searchProjectText(job, data, fileStat.st_size);
+            munmap(data, fileStat.st_size);
+        }
+#endif
     }
+    markTaskDone(&job->isDone);
+}
 
-    printFindMessageBar(word, 0, 0);
-
-    // 포기시 원래위치
-    Position *tempPosition = position;
-    Node *tempFFN = documentInfo->frameFirstNode;
-    Node *tempFLN = documentInfo->frameLastNode;
-    int tempFX = documentInfo->frameX;
-    int tempFY = documentInfo->frameY;
-
-    PNode *wordListHead = (PNode *)malloc(sizeof(PNode));
-    PNode *highlightedWord;
-    int resultCount = 0;
-    int currentResultIndex = 0;
-    int wordIndex = 0;
-
-
-    while (true)
+void searchProjectText(ProjectJob *job, char *text, long long size)
+{ // 조각에서 시작하는 단어만 찾음 (조각 끝에 걸친 단어도 이 조각에서 찾음), 줄 수는 찾은 곳까지만 셈
+    ProjectInfo *search = job->search;
+    long long start = job->offset;
+    long long end = job->length < 0 || start + job->length > size ? size : start + job->length;
+    long long searchEnd = end + search->wordLength - 1 < size ? end + search->wordLength - 1 : size;
+    long long lineStart = start; // 조각이 줄 중간에서 시작하면 앞 조각에서 줄의 시작을 찾음
+    while (lineStart > 0 && text[lineStart - 1] != ENTER)
+        lineStart--;
+    int line = 0;
+    char *counted = text + start; // 여기까지는 줄 수를 셌음
+    char *found = text + start;
+    char *limit = text + searchEnd;
+    while (job->hitCount < PROJECT_MAX_HITS && found < limit &&
+           (found = search->isCaseInsensitive ? findBytesFolded(found, limit - found, search->word, search->wordLength)
+                                              : findBytes(found, limit - found, search->word, search->wordLength)) != NULL)
     {
-        int ch = getch();
-        if (ch == ENTER)
-        { // 현재 하이라이트되어있는 위치로 이동
-            position->current = highlightedWord->position->current->prev;
-            for (int i = 0; i < strlen(word); i++)
+        if (search->isWholeWord)
+        { // 큰 파일은 int를 넘으므로 찾은 곳 주변만 넘겨서 봄
+            char *around = found > text ? found - 1 : found;
+            long long remaining = text + size - around;
+            int aroundLength = remaining < search->wordLength + 2 ? remaining : search->wordLength + 2;
+            if (!isWholeWordAt(around, aroundLength, found - around, found - around + search->wordLength))
             {
-                position->current = position->current->next;
+                found++;
+                continue;
             }
-
-            position->x = highlightedWord->position->x + wordIndex - documentInfo->frameX;
-            position->y = highlightedWord->position->y - documentInfo->frameY;
-            print();
-            break;
         }
-        else if (ch == BACKSPACE)
+        int newlines = countNewlines(counted, found - counted);
+        if (newlines > 0)
         {
-            if(wordIndex == 0) continue;
-            wordIndex--;
-            word[wordIndex] = '\0';
-            wordListHead = findWordsInDocument(word);
-            resultCount = countFindResult(wordListHead);
-
-            if (wordIndex == 0 || resultCount == 0)
-            {
-                position = tempPosition;
-                documentInfo->frameFirstNode = tempFFN;
-                documentInfo->frameLastNode = tempFLN;
-                documentInfo->frameX = tempFX;
-                documentInfo->frameY = tempFY;
-                print();
-                printFindMessageBar(word, 0, 0);
-            }
-            else
-            {
-                highlightedWord = wordListHead->next;
-                highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
-                printFindMessageBar(word, currentResultIndex, resultCount);
-            }
+            line += newlines;
+            char *newline = found - 1;
+            while (*newline != ENTER)
+                newline--;
+            lineStart = newline + 1 - text;
         }
-        else if (ch == KEY_RIGHT)
-        {
-            if (resultCount == 0)
-                continue;
-            if (currentResultIndex == resultCount)
-            {
-                currentResultIndex = 1;
-                highlightedWord = wordListHead->next;
-            }
-            else
-            {
-                currentResultIndex++;
-                highlightedWord = highlightedWord->next;
-            }
+        counted = found;
+        addProjectHit(job, text, size, lineStart, found, line);
+        found++;
+    }
+    job->lineCount = line + countNewlines(counted, text + end - counted);
+    job->searchedBytes = end - start;
+}
 
-            highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
-            printFindMessageBar(word, currentResultIndex, resultCount);
+void addProjectHit(ProjectJob *job, char *text, long long size, long long lineStart, char *found, int line)
+{ // 목록에 보여줄 줄 내용을 복사해둠, 파일은 작업이 끝나면 닫으므로 가리키지 않음
+    if (job->hitCount == job->hitCapacity)
+    {
+        job->hitCapacity = job->hitCapacity ? job->hitCapacity * 2 : 16;
+        job->hits = (ProjectHit *)realloc(job->hits, sizeof(ProjectHit) * job->hitCapacity);
+    }
+    ProjectHit *hit = &job->hits[job->hitCount++];
+    long long column = found - text - lineStart;
+    hit->file = job->file;
+    hit->line = line;
+    hit->column = column < INT_MAX ? column : INT_MAX;
+    hit->preview = (char *)malloc(PROJECT_PREVIEW_LENGTH + 1);
+
+    char *p = column > PROJECT_PREVIEW_CONTEXT ? found - PROJECT_PREVIEW_CONTEXT : text + lineStart;
+    while (p < found && ((unsigned char)*p & 0xC0) == 0x80)
+        p++; // 글자 중간에서 시작하지 않음
+    char *end = text + size;
+    int length = 0;
+    while (p < end && *p != ENTER && length < PROJECT_PREVIEW_LENGTH)
+    {
+        unsigned char ch = *p;
+        int charLength = ch < 0x80 ? 1 : utf8Length(ch);
+        int codepoint;
+        if (ch < 0x80)
+            hit->preview[length++] = ch < ' ' || ch == 127 ? ' ' : ch;
+        else if (charLength > 0 && p + charLength <= end && length + charLength <= PROJECT_PREVIEW_LENGTH &&
+                 decodeUtf8((unsigned char *)p, charLength, &codepoint) == charLength)
+        {
+            memcpy(hit->preview + length, p, charLength);
+            length += charLength;
+            p += charLength;
+            continue;
         }
-        else if (ch == KEY_LEFT)
+        else
+            hit->preview[length++] = '?';
+        p++;
+    }
+    hit->preview[length] = '\0';
+}
+
+void mergeProjectJobs(void)
+{ // 앞에서부터 끝난 작업의 결과를 목록에 붙임, 조각의 줄 번호에는 앞 조각들의 줄 수를 더함
+    while (projectInfo->mergedJobs < projectInfo->jobCount)
+    {
+        ProjectJob *job = projectInfo->jobs[projectInfo->mergedJobs];
+        if (!isTaskDone(&job->isDone))
+            break;
+        if (job->offset == 0)
+            projectInfo->lineBase = 0;
+        for (int i = 0; i < job->hitCount; i++)
         {
-            if (resultCount == 0)
-                continue;
-            if (currentResultIndex == 1)
+            if (projectInfo->hitCount == PROJECT_MAX_HITS)
             {
-                currentResultIndex = resultCount;
-                highlightedWord = wordListHead->prev->prev; // 위에서 언급한 반 원형 연결 리스트? 의 활용
+                free(job->hits[i].preview);
+                continue;
             }
-            else
+            if (projectInfo->hitCount == projectInfo->hitCapacity)
             {
-                currentResultIndex--;
-                highlightedWord = highlightedWord->prev;
+                projectInfo->hitCapacity *= 2;
+                projectInfo->hits = (ProjectHit *)realloc(projectInfo->hits, sizeof(ProjectHit) * projectInfo->hitCapacity);
             }
+            ProjectHit *hit = &projectInfo->hits[projectInfo->hitCount++];
+            *hit = job->hits[i];
+            hit->line += projectInfo->lineBase;
+        }
+        free(job->hits);
+        job->hits = NULL;
+        projectInfo->lineBase += job->lineCount;
+        projectInfo->searchedBytes += job->searchedBytes;
+        projectInfo->mergedJobs++;
+    }
+    if (projectInfo->mergedJobs == projectInfo->jobCount && projectInfo->walkCount == 0 && projectInfo->elapsed < 0)
+        projectInfo->elapsed = currentTimeMs() - projectInfo->startTime;
+}
 
-            highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
-            printFindMessageBar(word, currentResultIndex, resultCount);
+void freeProjectInfo(void)
+{ // 남은 작업은 건너뛰게 하고 모두 끝날 때까지 기다린 뒤 해제함
+    if (projectInfo == NULL)
+        return;
+    markTaskDone(&projectInfo->isCanceled);
+    walkProjectDirectory(projectInfo, 0); // 취소했으므로 따라갈 목록만 버림
+    for (int i = 0; i < projectInfo->jobCount; i++)
+    {
+        ProjectJob *job = projectInfo->jobs[i];
+        waitTask(&job->isDone);
+        for (int j = 0; job->hits != NULL && j < job->hitCount; j++)
+            free(job->hits[j].preview);
+        free(job->hits);
+        free(job);
+    }
+    for (int i = 0; i < projectInfo->hitCount; i++)
+        free(projectInfo->hits[i].preview);
+    for (int i = 0; i < projectInfo->pathCount; i++)
+        free(projectInfo->paths[i]);
+    free(projectInfo->jobs);
+    free(projectInfo->hits);
+    free(projectInfo->paths);
+    free(projectInfo->directory);
+    free(projectInfo->typedWord);
+    free(projectInfo->word);
+    free(projectInfo);
+    projectInfo = NULL;
+}
+
+#ifndef VITE_LIBRARY
+void showProjectResults(void)
+{ // 작업이 끝나는 대로 결과를 붙이면서 목록을 그림, Enter로 고른 곳을 열고 Esc로 닫음 (찾는 중이면 멈춤)
+    while (true)
+    {
+        // 디렉터리는 다시 그리는 간격만큼씩 따라가므로 따라가는 동안에도 결과가 보이고 키를 받음
+        bool isWalking = walkProjectDirectory(projectInfo, PROJECT_POLL_MS);
+        mergeProjectJobs();
+        printProjectResults();
+        timeout(isWalking ? 0 : projectInfo->elapsed < 0 ? PROJECT_POLL_MS : -1);
+        int ch = getch();
+        timeout(-1);
+        int height = windowSize->y - 2;
+        int last = projectInfo->hitCount - 1;
+        if (ch == ERR)
+            continue;
+        else if (ch == KEY_UP && projectInfo->selected > 0)
+            projectInfo->selected--;
+        else if (ch == KEY_DOWN && projectInfo->selected < last)
+            projectInfo->selected++;
+        else if (ch == KEY_PPAGE)
+            projectInfo->selected = projectInfo->selected > height ? projectInfo->selected - height : 0;
+        else if (ch == KEY_NPAGE)
+            projectInfo->selected = projectInfo->selected + height < last ? projectInfo->selected + height : (last > 0 ? last : 0);
+        else if (ch == KEY_HOME)
+            projectInfo->selected = 0;
+        else if (ch == KEY_END)
+            projectInfo->selected = last > 0 ? last : 0;
+        else if (ch == KEY_RESIZE)
+            resize();
+        else if (ch == CTRL('g'))
+            startProjectSearch(projectInfo->directory, projectInfo->typedWord); // 파일이 바뀌었으면 다시 찾음
+        else if (ch == ENTER && projectInfo->hitCount > 0)
+        { // 찾는 중이면 Esc처럼 남은 작업을 건너뛰게 함 (쓰레드 풀이 비어야 다음 찾기가 바로 돌아감)
+            if (projectInfo->elapsed < 0)
+                markTaskDone(&projectInfo->isCanceled);
+            openProjectHit(&projectInfo->hits[projectInfo->selected]);
+            return;
         }
-        else if(ch == ESC) {
+        else if (ch == ESC)
+        {
+            if (projectInfo->elapsed < 0)
+                markTaskDone(&projectInfo->isCanceled);
             print();
-            break;
+            return;
         }
-        else
-        {
-            word[wordIndex] = ch;
-            wordIndex++;
+    }
+}
 
-            wordListHead = findWordsInDocument(word);
+void printProjectResults(void)
+{ // 파일:줄: 내용, 경로는 찾은 디렉터리 기준으로 보여줌
+    int height = windowSize->y - 2;
+    if (projectInfo->selected < projectInfo->top)
+        projectInfo->top = projectInfo->selected;
+    else if (projectInfo->selected >= projectInfo->top + height)
+        projectInfo->top = projectInfo->selected - height + 1;
+    clear();
 
-            resultCount = countFindResult(wordListHead);
-            if (wordIndex == 0 || resultCount == 0)
-            {
-                position = tempPosition;
-                documentInfo->frameFirstNode = tempFFN;
-                documentInfo->frameLastNode = tempFLN;
-                documentInfo->frameX = tempFX;
-                documentInfo->frameY = tempFY;
-                print();
-                printFindMessageBar(word, 0, 0);
-            }
-            else
-            {
-                currentResultIndex = 1;
-                highlightedWord = wordListHead->next;
-                highlight(highlightedWord, word, wordIndex + 1); // wordLength == wordIndex + 1
-                printFindMessageBar(word, 1, resultCount);
-            }
+    int directoryLength = strlen(projectInfo->directory);
+    for (int row = 0; row < height && projectInfo->top + row < projectInfo->hitCount; row++)
+    {
+        ProjectHit *hit = &projectInfo->hits[projectInfo->top + row];
+        char *path = projectInfo->paths[hit->file];
+        if (strncmp(path, projectInfo->directory, directoryLength) == 0 && path[directoryLength] == '/')
+            path += directoryLength + 1;
+        char text[PROJECT_PREVIEW_LENGTH + 300];
+        int length = snprintf(text, sizeof(text), "%.256s:%d: %s", path, hit->line + 1, hit->preview);
+        if (length >= (int)sizeof(text))
+            length = sizeof(text) - 1;
+        bool isSelected = projectInfo->top + row == projectInfo->selected;
+        if (isSelected)
+        {
+            attron(COLOR_PAIR(COLOR_HIGHLIGHT));
+            for (int i = 0; i < windowSize->x; i++)
+                mvaddch(row, i, ' ');
         }
+        mvaddnstr(row, 0, text, fitTextWidth(text, length, windowSize->x - 1));
+        if (isSelected)
+            attroff(COLOR_PAIR(COLOR_HIGHLIGHT));
     }
-    free(wordListHead);
+    for (int row = projectInfo->hitCount - projectInfo->top; row < height; row++)
+        mvprintw(row, 0, "~");
+
+    char leftMessage[100];
+    char rightMessage[100];
+    snprintf(leftMessage, sizeof(leftMessage), "[%.30s in %.30s] - %d hits%s", projectInfo->typedWord, projectInfo->directory,
+             projectInfo->hitCount, projectInfo->hitCount == PROJECT_MAX_HITS ? " (limit)" : "");
+    if (projectInfo->elapsed < 0)
+        snprintf(rightMessage, sizeof(rightMessage), "%s %d/%d files",
+                 projectInfo->isCanceled ? "canceled" : "searching", projectInfo->mergedJobs < projectInfo->jobCount
+                     ? projectInfo->jobs[projectInfo->mergedJobs]->file : projectInfo->pathCount, projectInfo->pathCount);
+    else
+        snprintf(rightMessage, sizeof(rightMessage), "%d files | %.1f ms, %.1f MB/s", projectInfo->pathCount, projectInfo->elapsed,
+                 projectInfo->elapsed > 0 ? projectInfo->searchedBytes / 1048576.0 / (projectInfo->elapsed / 1000.0) : 0.0);
+    attron(COLOR_PAIR(1));
+    for (int i = 0; i < windowSize->x; i++)
+        mvaddch(windowSize->y - 2, i, ' ');
+    mvprintw(windowSize->y - 2, 0, "%s", leftMessage);
+    mvprintw(windowSize->y - 2, windowSize->x - strlen(rightMessage), "%s", rightMessage);
+    attroff(COLOR_PAIR(1));
+    mvprintw(windowSize->y - 1, 0, "FILES: Arrows = move | Enter = open | Ctrl-G = search again | Esc = close");
+    move(projectInfo->selected - projectInfo->top, 0);
+    refresh();
+}
+
+void openProjectHit(ProjectHit *hit)
+{ // 고른 곳의 파일을 버퍼로 열고(이미 열려 있으면 그 버퍼로 바꿈) 찾기와 같이 highlight로 보여줌
+    openBufferFile(projectInfo->paths[hit->file]);
+    if (hexInfo->isEnabled || fileInfo->isFileReading)
+        return;
+    // 열려 있던 버퍼를 고쳤으면 줄과 칸이 어긋날 수 있으므로 문서 안으로 맞춤
+    int line = hit->line < documentInfo->lineCount ? hit->line : documentInfo->lineCount - 1;
+    int lineLength = layoutInfo->lineLengths[line];
+    int column = hit->column < lineLength ? hit->column : lineLength;
+    int length = column + projectInfo->wordLength <= lineLength ? projectInfo->wordLength : lineLength - column;
+    Node *lineStart = findLineStart(line);
+    Position found;
+    found.current = lineStart;
+    for (int i = 0; i <= column && found.current->next != tail; i++)
+        found.current = found.current->next;
+    found.x = column;
+    found.y = line;
+    PNode result;
+    result.position = &found;
+    result.length = length;
+    highlight(&result, projectInfo->typedWord, strlen(projectInfo->typedWord) + 1);
+    moveCursorToLine(line, lineStart, column + length);
+
+    char message[300];
+    snprintf(message, sizeof(message), "%.200s:%d | Ctrl-G = back to results", projectInfo->paths[hit->file], line + 1);
+    printMessage(message);
 }
 
 void quit(void)
 {
-    if (fileInfo->isUpdated)
+    int updatedCount = 0;
+    for (int i = 0; i < bufferInfo->count; i++)
+    {
+        if (bufferInfo->buffers[i].editor->fileInfo->isUpdated)
+        {
+            if (!fileInfo->isUpdated)
+                switchBuffer(i); // 저장하지 않은 버퍼를 보여주고 물어봄
+            updatedCount++;
+        }
+    }
+    if (updatedCount > 0)
     {
         for (int i = 0; i < windowSize->x; i++)
             mvprintw(windowSize->y - 1, i, " ");
-        mvprintw(windowSize->y - 1, 0, "Press Ctrl-q again to leave without saving. Or Press any key to continue editing.");
+        if (updatedCount > 1)
+            mvprintw(windowSize->y - 1, 0, "%d buffers are not saved. Press Ctrl-q again to leave without saving. Or Press any key to continue editing.", updatedCount);
+        else
+            mvprintw(windowSize->y - 1, 0, "Press Ctrl-q again to leave without saving. Or Press any key to continue editing.");
         int ch = getch();
         if (ch != CTRL('q'))
         {
@@ -1231,6 +10285,12 @@ void quit(void)
             return;
         }
     }
+    for (int i = 0; i < bufferInfo->count; i++)
+    {
+        useEditor(bufferInfo->buffers[i].editor);
+        saveSession();
+        finishAutosaveJob(true); // 임시 파일이 남지 않게 함
+    }
     endwin();
     exit(0);
 }
@@ -1262,6 +10322,18 @@ void resize(void) {
         windowSize->y = csbi.dwSize.Y;
     }
     #endif
+    fitFrameToWindow(tempY);
+}
+
+void fitFrameToWindow(int oldY)
+{ // 화면 높이가 oldY에서 바뀐 만큼 화면의 마지막 줄을 옮김
+    int tempY = oldY;
+    if (documentInfo->isWrapMode)
+    { // 줄 수 트리는 다음에 필요할 때 다시 만듦
+        wrapScrollToCursor();
+        print();
+        return;
+    }
 
     if(tempY < windowSize->y) {
         for(int i=0;i<windowSize->y - tempY;i++) {
@@ -1301,14 +10373,12 @@ void disableCtrlFunctions()
 
 int main(int argc, char *argv[])
 {
-    initLinkedList();
     initCurses();
     
     initWindowSize();
 
-
-    initDocumentInfo();
-    initFileInfo();
+    newEditor();
+    initBufferInfo();
     print();
 
     #ifdef LINUX
@@ -1319,21 +10389,81 @@ int main(int argc, char *argv[])
     disableCtrlFunctions();
     #endif
 
-    if (argv[1] != NULL)
-        readFile(argv[1]);
+    int argIndex = 1;
+    while (argIndex < argc - 1)
+    {
+        if (strcmp(argv[argIndex], "-t") == 0 && argIndex + 2 < argc)
+        { // vite -t 4 파일이름
+            int tabSize = atoi(argv[argIndex + 1]);
+            if (tabSize >= 1 && tabSize <= MAX_TAB_SIZE)
+                layoutInfo->tabSize = tabSize;
+            argIndex += 2;
+        }
+        else if (strcmp(argv[argIndex], "-x") == 0)
+        { // vite -x 파일이름, NUL 바이트가 없어도 헥스 보기로 엶
+            hexInfo->isForced = true;
+            argIndex++;
+        }
+        else if (strcmp(argv[argIndex], "-a") == 0 && argIndex + 2 < argc)
+        { // vite -a 5 파일이름 또는 vite -a 5,100 파일이름, 자동 저장할 때까지 기다릴 초와 편집 수 (0초면 끔)
+            int seconds = AUTOSAVE_IDLE_MS / 1000;
+            int editLimit = AUTOSAVE_EDIT_LIMIT;
+            sscanf(argv[argIndex + 1], "%d,%d", &seconds, &editLimit);
+            if (seconds >= 0 && seconds <= AUTOSAVE_MAX_DELAY_MS / 1000)
+                autosaveInfo->idleMs = seconds * 1000;
+            if (editLimit >= 1)
+                autosaveInfo->editLimit = editLimit;
+            argIndex += 2;
+        }
+        else if (strcmp(argv[argIndex], "-n") == 0)
+        { // vite -n 파일이름, 세션 사이드카를 쓰지 않음
+            sessionInfo->isSkipped = true;
+            argIndex++;
+        }
+        else
+            break;
+    }
+    char *fileName = argIndex < argc ? argv[argIndex] : NULL;
+    if (fileName != NULL)
+        readFile(fileName);
 
     while (true)
     {
+        if (renderInfo->isFramePending && !isInputPending())
+            print(); // 밀린 이동 키를 다 처리했으므로 마지막 위치를 그림
+        timeout(autosaveTimeout());
         int key = getch();
-        if (key == BACKSPACE)
-        {
+        timeout(-1);
+        if (key == ERR)
+        { // 입력이 없는 동안 자동 저장을 진행함
+            autosaveTick();
+            continue;
+        }
+        renderInfo->isDeferrable = key == KEY_UP || key == KEY_DOWN || key == KEY_RIGHT || key == KEY_LEFT ||
+                                   key == KEY_HOME || key == KEY_END || key == KEY_PPAGE || key == KEY_NPAGE;
+        if (!renderInfo->isDeferrable && renderInfo->isFramePending)
+            print(); // 다른 키는 메세지를 지금 화면 위에 그리므로 건너뛴 화면을 먼저 그림
+        if (hexInfo->isEnabled && hexKey(key))
+            continue;
+        if (selectionInfo->isBlock && blockKey(key))
+            continue;
+        if (key == BACKSPACE || key == KEY_BACKSPACE)
+        { // 여러 바이트짜리 글자는 바이트마다 지워서 한 번에 지움
+            beforeEdit();
             fileInfo->isUpdated = true;
-            backspace();
+            int count = prevCharLength(position->current);
+            for (int i = 0; i < count; i++)
+            {
+                recordBackspace();
+                backspace();
+            }
         }
 
         else if (key == ENTER)
         {
+            beforeEdit();
             fileInfo->isUpdated = true;
+            recordInsert(key);
             enter();
         }
         else if (key == KEY_UP)
@@ -1361,11 +10491,50 @@ int main(int argc, char *argv[])
             save();
         else if (key == CTRL('q'))
             quit();
-        else
-        {
+        else if (key == CTRL('w'))
+            toggleWrapMode();
+        else if (key == CTRL('r'))
+            replace();
+        else if (key == CTRL('z'))
+            undo();
+        else if (key == CTRL('b'))
+            toggleSelection(false);
+        else if (key == CTRL('k'))
+            toggleSelection(true);
+        else if (key == CTRL('c'))
+            copySelection();
+        else if (key == CTRL('x'))
+            cutSelection();
+        else if (key == CTRL('v'))
+            paste();
+        else if (key == CTRL('o'))
+            insertFile();
+        else if (key == CTRL('p'))
+            filterLines();
+        else if (key == CTRL('l'))
+            lineOperationMenu();
+        else if (key == CTRL('d'))
+            diffView();
+        else if (key == CTRL(']'))
+            jumpToMatchingBracket();
+        else if (key == CTRL('e'))
+            openBuffer();
+        else if (key == CTRL('n'))
+            bufferMenu();
+        else if (key == CTRL('g'))
+            searchProject();
+        else if (key == KEY_F(1))
+            showHelp();
+        else if (key == ESC && selectionInfo->isSelecting)
+            toggleSelection(false);
+        else if (key <= UCHAR_MAX)
+        { // 처리하지 않는 특수 키는 문서에 넣지 않음 (노드는 한 바이트만 가짐)
+            beforeEdit();
             fileInfo->isUpdated = true;
+            recordInsert(key);
             commonKey(key);
         }
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,33 @@
+// vite 편집기 코어 (make libvite.a)
+// 문서는 쓰레드마다 useEditor로 골라서 다룸, 한 문서는 한 번에 한 쓰레드만 골라야 함
+// 여기 있는 함수는 화면을 그리지 않음, 화면을 그리거나 키를 받는 함수는 ncurses 프런트엔드(vite)에만 있고
+// 프런트엔드의 쓰레드 하나에서만 부를 수 있음
+// 링크: -lvite -lz -lpthread (make ZSTD=1로 만들었으면 -lzstd)
+
+#ifndef VITE_H
+#define VITE_H
+
+#include <stdbool.h>
+
+typedef struct Editor Editor;
+
+// 빈 문서를 만들고 부른 쓰레드에서 고름
+Editor *newEditor(void);
+// 이 쓰레드에서 다룰 문서를 고름
+void useEditor(Editor *editor);
+
+// 파일을 고른 문서로 읽음 (gzip, zstd는 풀면서 읽음), 끝까지 읽었거나 없는 파일이면 true
+bool loadFile(char *filename);
+// 문서를 filename에 저장함, 고친 줄만 제자리에 덮어썼으면 isInPlace가 true
+bool saveDocument(char *filename, long long *writtenBytes, bool *isInPlace);
+
+// (line, column)부터 oldLength 바이트를 text로 바꿈 (줄과 칸은 0부터, 칸은 바이트 단위)
+void spliceText(int line, int column, int oldLength, char *text, int length);
+// 마지막 편집을 되돌림, 되돌릴 것이 없으면 false
+bool undoEdits(void);
+
+int documentLineCount(void);
+// line번째 줄을 (줄바꿈 없이) 최대 capacity 바이트만큼 text에 복사함, 줄의 전체 길이를 돌려줌
+int copyLine(int line, char *text, int capacity);
+
+#endif